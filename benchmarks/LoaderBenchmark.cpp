@@ -0,0 +1,195 @@
+// Compares Loader tokenizer with previous getline + boost::tokenizer implementation.
+//
+// Usage: loader_benchmark [lines]
+
+#include "loaders/Loader.h"
+
+#include <boost/algorithm/string.hpp>
+#include <boost/tokenizer.hpp>
+
+#include <spdlog/sinks/stdout_color_sinks.h>
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <sstream>
+
+namespace {
+
+// Loader as it was before string_view tokens
+class LegacyLoader
+{
+  public:
+    void load(std::istream& stream)
+    {
+        std::string tmp;
+
+        while (stream.good()) {
+            getline(stream, tmp);
+            boost::algorithm::trim(tmp);
+            parseLine(tmp);
+        }
+    }
+
+    std::size_t tokens = 0;
+    float sum          = 0.0f;
+
+  private:
+    void parseLine(const std::string& line)
+    {
+        using namespace boost;
+
+        if (line.empty() || algorithm::starts_with(line, "#")) return;
+
+        typedef tokenizer<char_separator<char>> tokenizer;
+
+        char_separator<char> sep(" ");
+        tokenizer tokens(line, sep);
+
+        tokenizer::iterator it = tokens.begin();
+        const std::string cmd  = *it;
+        ++it;
+
+        std::vector<std::string> args;
+        for (; it != tokens.end(); ++it) {
+            args.push_back(*it);
+        }
+
+        command(cmd, args);
+    }
+
+    void command(const std::string& cmd, const std::vector<std::string>& args)
+    {
+        tokens += args.size() + 1;
+        if (cmd == "v" || cmd == "Kd") {
+            for (const auto& arg : args)
+                sum += std::stof(arg);
+        }
+    }
+};
+
+class CountingLoader : public Loader
+{
+  public:
+    std::size_t tokens = 0;
+    float sum          = 0.0f;
+
+  protected:
+    void command(std::string_view cmd, Args args) override
+    {
+        tokens += args.size() + 1;
+        if (cmd == "v" || cmd == "Kd") {
+            for (const auto& arg : args)
+                sum += toFloat(arg);
+        }
+    }
+};
+
+std::string generateSource(std::size_t lines)
+{
+    std::string source;
+    source.reserve(lines * 48);
+
+    char line[128];
+    for (std::size_t i = 0; i < lines; ++i) {
+        switch (i % 4) {
+        case 0:
+            std::snprintf(line, sizeof(line), "v %f %f %f\n", i * 0.001f, i * -0.002f, 0.5f);
+            break;
+        case 1:
+            std::snprintf(line, sizeof(line), "Kd 0.%03zu 0.8 0.8\n", i % 1000);
+            break;
+        case 2:
+            std::snprintf(line, sizeof(line),
+                          "char id=%zu x=%zu y=0 width=12 height=18 xoffset=-1 yoffset=2 "
+                          "xadvance=11 page=0 chnl=15\n",
+                          i % 256, i % 512);
+            break;
+        default: std::snprintf(line, sizeof(line), "# comment %zu\n", i); break;
+        }
+        source += line;
+    }
+
+    return source;
+}
+
+// Best of runs in milliseconds
+double measure(int runs, const std::function<void()>& func)
+{
+    double best = 1e30;
+    for (int i = 0; i < runs; ++i) {
+        const auto start = std::chrono::steady_clock::now();
+        func();
+        const std::chrono::duration<double, std::milli> time =
+            std::chrono::steady_clock::now() - start;
+        best = std::min(best, time.count());
+    }
+    return best;
+}
+
+void report(const char* name, double ms, std::size_t bytes, std::size_t tokens, double baseline)
+{
+    std::printf("%-28s %9.2f ms %9.1f MB/s %10zu tokens %6.2fx\n", name, ms,
+                bytes / (ms * 1000.0), tokens, baseline / ms);
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    spdlog::stdout_color_mt("console");
+
+    const std::size_t lines = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+    const int runs          = 5;
+
+    const std::string source = generateSource(lines);
+
+    const auto file = std::filesystem::temp_directory_path() / "nbd-3dge-loader-benchmark.txt";
+    std::ofstream{file, std::ios::binary} << source;
+
+    std::size_t legacyTokens = 0;
+    const double legacy      = measure(runs, [&] {
+        std::istringstream ss{source};
+        LegacyLoader loader;
+        loader.load(ss);
+        legacyTokens = loader.tokens;
+    });
+
+    std::size_t streamTokens = 0;
+    const double stream      = measure(runs, [&] {
+        std::istringstream ss{source};
+        CountingLoader loader;
+        loader.load(ss);
+        streamTokens = loader.tokens;
+    });
+
+    std::size_t memoryTokens = 0;
+    const double memory      = measure(runs, [&] {
+        CountingLoader loader;
+        loader.loadFromMemory(source);
+        memoryTokens = loader.tokens;
+    });
+
+    std::size_t mappedTokens = 0;
+    const double mapped      = measure(runs, [&] {
+        CountingLoader loader;
+        loader.load(file);
+        mappedTokens = loader.tokens;
+    });
+
+    std::filesystem::remove(file);
+
+    std::printf("%zu lines, %.1f MB, best of %d runs\n", lines, source.size() / 1e6, runs);
+    report("getline + boost::tokenizer", legacy, source.size(), legacyTokens, legacy);
+    report("Loader (istream)", stream, source.size(), streamTokens, legacy);
+    report("Loader (memory)", memory, source.size(), memoryTokens, legacy);
+    report("Loader (mapped file)", mapped, source.size(), mappedTokens, legacy);
+
+    spdlog::drop_all();
+
+    return legacyTokens == memoryTokens ? 0 : 1;
+}
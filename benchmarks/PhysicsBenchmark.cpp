@@ -0,0 +1,101 @@
+// Compares single threaded Bullet world with the multithreaded one for growing number of bodies.
+//
+// Usage: PhysicsBenchmark [steps] [threads]
+//
+// Multithreaded world needs NBD_BULLET_MULTITHREADING, without it both columns are the same.
+
+#include "PhysicsWorld.h"
+#include "ThreadPool.h"
+
+#include <btBulletDynamicsCommon.h>
+
+#include <spdlog/sinks/stdout_color_sinks.h>
+#include <spdlog/spdlog.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+namespace {
+
+// Boxes dropped in 10 layers high stacks on a ground box
+void createScene(btDiscreteDynamicsWorld* world, btCollisionShape* ground, btCollisionShape* box,
+                 int bodies)
+{
+    btTransform groundTrans;
+    groundTrans.setIdentity();
+    groundTrans.setOrigin({0, -1, 0});
+
+    btRigidBody::btRigidBodyConstructionInfo groundInfo(0, nullptr, ground);
+    groundInfo.m_startWorldTransform = groundTrans;
+    world->addRigidBody(new btRigidBody(groundInfo));
+
+    const btScalar mass = 1;
+    btVector3 inertia;
+    box->calculateLocalInertia(mass, inertia);
+
+    const int layers = 10;
+    const int side   = static_cast<int>(std::ceil(std::sqrt(bodies / float(layers))));
+
+    for (int i = 0; i < bodies; ++i) {
+        const int layer = i / (side * side);
+        const int x     = i % side - side / 2;
+        const int z     = (i / side) % side - side / 2;
+
+        // Small offsets make stacks fall over instead of going to sleep at once
+        btTransform trans;
+        trans.setIdentity();
+        trans.setOrigin({x * 1.2f + (layer % 2) * 0.3f, 0.5f + layer * 1.05f, z * 1.2f});
+
+        btRigidBody::btRigidBodyConstructionInfo info(mass, nullptr, box, inertia);
+        info.m_startWorldTransform = trans;
+        world->addRigidBody(new btRigidBody(info));
+    }
+}
+
+// Average step time in milliseconds
+double measure(int bodies, int steps, int threads, int* usedThreads)
+{
+    btBoxShape ground{{500, 1, 500}};
+    btBoxShape box{{0.5f, 0.5f, 0.5f}};
+
+    PhysicsWorld::Config config;
+    config.threads = threads;
+
+    PhysicsWorld world{config};
+    createScene(world.dynamicsWorld(), &ground, &box, bodies);
+    *usedThreads = world.threads();
+
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < steps; ++i)
+        world.dynamicsWorld()->stepSimulation(1.0f / 60.0f, 0);
+    const std::chrono::duration<double, std::milli> time = std::chrono::steady_clock::now() - start;
+
+    return time.count() / steps;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    spdlog::stdout_color_mt("console");
+
+    const int steps   = argc > 1 ? std::atoi(argv[1]) : 120;
+    const int threads = argc > 2 ? std::atoi(argv[2]) : ThreadPool::global().threadCount() + 1;
+
+    std::printf("%d steps of 1/60 s, average step time\n", steps);
+    std::printf("%8s %14s %14s %8s %8s\n", "bodies", "single", "multi", "threads", "speedup");
+
+    for (int bodies : {1000, 5000, 10000, 25000, 50000}) {
+        int used        = 1;
+        const double st = measure(bodies, steps, 0, &used);
+        const double mt = measure(bodies, steps, threads, &used);
+
+        std::printf("%8d %11.2f ms %11.2f ms %8d %7.2fx\n", bodies, st, mt, used, st / mt);
+    }
+
+    spdlog::drop_all();
+
+    return 0;
+}
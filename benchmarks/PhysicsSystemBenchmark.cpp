@@ -0,0 +1,315 @@
+// Runs PhysicsSystem on synthetic scenes without window or GPU and reports tick time percentiles,
+// broadphase pairs, pairs rejected by collision layers (dbvt only), contact manifolds and time of
+// collision detection and constraint solving.
+//
+// Usage: PhysicsSystemBenchmark [--scene all|stacks|piles|ragdolls|terrain] [--bodies 2000]
+//                               [--ticks 600] [--broadphase dbvt|sweep] [--iterations 10]
+//                               [--threads 0] [--activeRadius 0] [--reducedRadius 0] [--debris]
+
+#include "Components.h"
+#include "PhysicsSystem.h"
+
+#include <CLI/CLI.hpp>
+
+#include <spdlog/sinks/stdout_color_sinks.h>
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <deque>
+#include <iterator>
+#include <random>
+
+namespace {
+
+struct Body
+{
+    TransformationComponent tr;
+    PhysicsComponent ph;
+};
+
+// Components must outlive PhysicsSystem actors, deque keeps them in place
+class Scene
+{
+  public:
+    Scene(PhysicsSystem& physics, int dynamicLayer)
+        : m_physics{physics}
+        , m_dynamicLayer{dynamicLayer}
+    {
+    }
+
+    int add(const std::string& shape, float mass, const glm::vec3& position)
+    {
+        m_bodies.emplace_back();
+        Body& body          = m_bodies.back();
+        body.tr.translation = position;
+        body.ph.shape       = shape;
+        body.ph.mass        = mass;
+        body.ph.layer       = mass != 0.0f ? m_dynamicLayer : 0;
+
+        const int id = static_cast<int>(m_bodies.size());
+        m_physics.addActor(id, &body.tr, &body.ph);
+        return id;
+    }
+
+    void addGround() { add("box:500:1:500", 0.0f, {0, -1, 0}); }
+
+    PhysicsSystem& physics() { return m_physics; }
+    int bodies() const { return static_cast<int>(m_bodies.size()); }
+
+  private:
+    PhysicsSystem& m_physics;
+    int m_dynamicLayer; //< 0 for default one
+    std::deque<Body> m_bodies;
+};
+
+//------------------------------------------------------------------------------
+
+// Boxes in 10 layers high stacks, every other layer shifted so stacks fall over
+void createStacks(Scene& scene, int bodies)
+{
+    scene.addGround();
+
+    const int layers = 10;
+    const int side   = static_cast<int>(std::ceil(std::sqrt(bodies / float(layers))));
+
+    for (int i = 0; i < bodies; ++i) {
+        const int layer = i / (side * side);
+        const int x     = i % side - side / 2;
+        const int z     = (i / side) % side - side / 2;
+
+        scene.add("box:0.5:0.5:0.5", 1.0f,
+                  {x * 1.2f + (layer % 2) * 0.3f, 0.5f + layer * 1.05f, z * 1.2f});
+    }
+}
+
+//------------------------------------------------------------------------------
+
+// Boxes and capsules dropped on a small area, many touching pairs
+void createPiles(Scene& scene, int bodies)
+{
+    scene.addGround();
+
+    std::mt19937 rng{1};
+    std::uniform_real_distribution<float> offset{-5.0f, 5.0f};
+
+    const int perLayer = 50;
+    for (int i = 0; i < bodies; ++i) {
+        const glm::vec3 position{offset(rng), 1.0f + (i / perLayer) * 1.2f, offset(rng)};
+        if (i % 3 == 0)
+            scene.add("capsule:0.25:0.5", 1.0f, position);
+        else
+            scene.add("box:0.4:0.4:0.4", 1.0f, position);
+    }
+}
+
+//------------------------------------------------------------------------------
+
+// Standing capsule ragdolls of 11 parts joined with 10 ball joints, they collapse on the ground
+void createRagdolls(Scene& scene, int bodies)
+{
+    scene.addGround();
+
+    struct Part
+    {
+        const char* shape;
+        glm::vec3 position;
+    };
+
+    static const Part parts[] = {
+        {"capsule:0.15:0.2", {0.0f, 1.0f, 0}},     {"capsule:0.15:0.3", {0.0f, 1.35f, 0}},
+        {"capsule:0.1:0.1", {0.0f, 1.75f, 0}},     {"capsule:0.07:0.35", {-0.12f, 0.7f, 0}},
+        {"capsule:0.05:0.35", {-0.12f, 0.25f, 0}}, {"capsule:0.07:0.35", {0.12f, 0.7f, 0}},
+        {"capsule:0.05:0.35", {0.12f, 0.25f, 0}},  {"capsule:0.05:0.3", {-0.35f, 1.35f, 0}},
+        {"capsule:0.04:0.3", {-0.35f, 0.95f, 0}},  {"capsule:0.05:0.3", {0.35f, 1.35f, 0}},
+        {"capsule:0.04:0.3", {0.35f, 0.95f, 0}},
+    };
+
+    struct Joint
+    {
+        int a;
+        int b;
+        glm::vec3 pivot;
+    };
+
+    static const Joint joints[] = {
+        {0, 1, {0.0f, 1.2f, 0}},    {1, 2, {0.0f, 1.6f, 0}},    {0, 3, {-0.12f, 0.9f, 0}},
+        {3, 4, {-0.12f, 0.47f, 0}}, {0, 5, {0.12f, 0.9f, 0}},   {5, 6, {0.12f, 0.47f, 0}},
+        {1, 7, {-0.3f, 1.55f, 0}},  {7, 8, {-0.35f, 1.15f, 0}}, {1, 9, {0.3f, 1.55f, 0}},
+        {9, 10, {0.35f, 1.15f, 0}},
+    };
+
+    const int partCount = static_cast<int>(std::size(parts));
+    const int ragdolls  = std::max(1, bodies / partCount);
+    const int side      = static_cast<int>(std::ceil(std::sqrt(float(ragdolls))));
+
+    for (int r = 0; r < ragdolls; ++r) {
+        const glm::vec3 origin{(r % side - side / 2) * 1.5f, 0.1f, (r / side - side / 2) * 1.5f};
+
+        int ids[std::size(parts)];
+        for (int p = 0; p < partCount; ++p)
+            ids[p] = scene.add(parts[p].shape, 1.0f, origin + parts[p].position);
+
+        for (const Joint& joint : joints)
+            scene.physics().addBallJoint(ids[joint.a], ids[joint.b], origin + joint.pivot);
+    }
+}
+
+//------------------------------------------------------------------------------
+
+// Small boxes dropped on a hilly heightfield
+void createTerrain(Scene& scene, int bodies)
+{
+    scene.add("heightfield:hills", 0.0f, {0, 0, 0});
+
+    std::mt19937 rng{1};
+    std::uniform_real_distribution<float> offset{-50.0f, 50.0f};
+
+    const int perLayer = 500;
+    for (int i = 0; i < bodies; ++i)
+        scene.add("box:0.3:0.3:0.3", 1.0f,
+                  {offset(rng), 12.0f + (i / perLayer) * 0.8f, offset(rng)});
+}
+
+std::shared_ptr<const Heightfield> createHills()
+{
+    auto hills       = std::make_shared<Heightfield>();
+    hills->w         = 129;
+    hills->h         = 129;
+    hills->amplitude = 10.0f;
+    hills->heights.resize(hills->w * hills->h);
+
+    for (int z = 0; z < hills->h; ++z)
+        for (int x = 0; x < hills->w; ++x)
+            hills->heights[z * hills->w + x] = 8.0f * std::sin(x * 0.1f) * std::cos(z * 0.13f);
+
+    return hills;
+}
+
+//------------------------------------------------------------------------------
+
+struct Config
+{
+    int bodies             = 2000;
+    int ticks              = 600;
+    std::string broadphase = "dbvt";
+    int iterations         = 10;
+    int threads            = 0;
+    float activeRadius     = 0.0f;
+    float reducedRadius    = 0.0f;
+    bool debris            = false;
+};
+
+// Nearest rank, sorted values
+double percentile(const std::vector<double>& values, double p)
+{
+    const std::size_t rank = static_cast<std::size_t>(std::ceil(p * values.size()));
+    return values[std::clamp<std::size_t>(rank, 1, values.size()) - 1];
+}
+
+void run(const std::string& name, void (*create)(Scene&, int), const Config& config)
+{
+    const bool sweep = config.broadphase == "sweep";
+
+    PhysicsSystem::Options options;
+    options.world.threads          = config.threads;
+    options.world.solverIterations = config.iterations;
+    options.world.broadphase =
+        sweep ? PhysicsWorld::Broadphase::AxisSweep : PhysicsWorld::Broadphase::Dbvt;
+    options.heightfields  = [hills = createHills()](const std::string&) { return hills; };
+    options.activeRadius  = config.activeRadius;
+    options.reducedRadius = config.reducedRadius;
+
+    PhysicsSystem physics{options};
+    Scene scene{physics, config.debris ? PhysicsComponent::Debris : 0};
+    create(scene, config.bodies);
+    // Regions around scene center, in the middle of all scenes
+    physics.setRegionCenters({glm::vec3{0.0f}});
+
+    using Clock = std::chrono::steady_clock;
+
+    std::vector<double> tickTimes;
+    tickTimes.reserve(config.ticks);
+    double pairs     = 0.0;
+    double manifolds = 0.0;
+
+    // One fixed tick per update
+    for (int i = 0; i < config.ticks; ++i) {
+        const auto start = Clock::now();
+        physics.update(physics.fixedTimeStep());
+        const std::chrono::duration<double, std::milli> time = Clock::now() - start;
+        tickTimes.push_back(time.count());
+
+        pairs += physics.world().overlappingPairs();
+        manifolds += physics.world().contactManifolds();
+    }
+
+    std::sort(tickTimes.begin(), tickTimes.end());
+
+    const double ticks       = config.ticks;
+    const auto& stats        = physics.world().stats();
+    const double toMsPerTick = 1000.0 / ticks;
+
+    // Sweep calls filter only when an overlap starts, its count is not comparable
+    char filtered[16] = "-";
+    if (!sweep) std::snprintf(filtered, sizeof(filtered), "%.0f", stats.filteredPairs / ticks);
+
+    std::printf("%-9s %7d %8.2f %8.2f %8.2f %8.2f %9.0f %9s %9.0f %9.2f %9.2f\n", name.c_str(),
+                scene.bodies(), percentile(tickTimes, 0.5), percentile(tickTimes, 0.9),
+                percentile(tickTimes, 0.99), tickTimes.back(), pairs / ticks, filtered,
+                manifolds / ticks, stats.collisionTime * toMsPerTick,
+                stats.solverTime * toMsPerTick);
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    CLI::App app{"Headless PhysicsSystem benchmark"};
+
+    Config config;
+    std::string scene = "all";
+    app.add_set("--scene", scene, {"all", "stacks", "piles", "ragdolls", "terrain"}, "Scene", true);
+    app.add_option("--bodies", config.bodies, "Dynamic bodies per scene", true)
+        ->check(CLI::Range(1, 1000000));
+    app.add_option("--ticks", config.ticks, "Simulated ticks", true)
+        ->check(CLI::Range(1, 1000000));
+    app.add_set("--broadphase", config.broadphase, {"dbvt", "sweep"}, "Broadphase type", true);
+    app.add_option("--iterations", config.iterations, "Solver iterations", true)
+        ->check(CLI::Range(1, 1000));
+    app.add_option("--threads", config.threads, "Physics threads, 0 for single threaded world",
+                   true)
+        ->check(CLI::Range(0, 64));
+    app.add_option("--activeRadius", config.activeRadius, "Full rate region, 0 disables regions",
+                   true);
+    app.add_option("--reducedRadius", config.reducedRadius, "Reduced rate region", true);
+    app.add_flag("--debris", config.debris, "Dynamic bodies do not collide with each other");
+
+    CLI11_PARSE(app, argc, argv);
+
+    auto console = spdlog::stdout_color_mt("console");
+    console->set_level(spdlog::level::warn);
+
+    std::printf("%d ticks, %s broadphase, %d solver iterations, times in ms per tick\n",
+                config.ticks, config.broadphase.c_str(), config.iterations);
+    std::printf("filtered: overlaps of moving bodies rejected by layers, dbvt broadphase only\n");
+    std::printf("%-9s %7s %8s %8s %8s %8s %9s %9s %9s %9s %9s\n", "scene", "bodies", "p50",
+                "p90", "p99", "max", "pairs", "filtered", "manifolds", "collision", "solver");
+
+    const std::pair<const char*, void (*)(Scene&, int)> scenes[] = {
+        {"stacks", createStacks},
+        {"piles", createPiles},
+        {"ragdolls", createRagdolls},
+        {"terrain", createTerrain},
+    };
+
+    for (const auto& [name, create] : scenes) {
+        if (scene == "all" || scene == name) run(name, create, config);
+    }
+
+    spdlog::drop_all();
+
+    return 0;
+}
@@ -64,8 +64,10 @@ void main()
     vec3 N = normalize(TBN[2]);
 
     if (length(TBN[0]) > 0.0) {
-        N = texture(normalSampler, texCoord_0).rgb;
-        N = (2.0 * N - 1.0) * vec3(material.normalScale, material.normalScale, 1.0);
+        // Z is reconstructed, so two channel (BC5) normal maps work too
+        N.xy = 2.0 * texture(normalSampler, texCoord_0).rg - 1.0;
+        N.z  = sqrt(max(1.0 - dot(N.xy, N.xy), 0.0));
+        N.xy *= material.normalScale;
         N = normalize(TBN * N);
     }
     //fragColor = vec4(N, 1.0); return;
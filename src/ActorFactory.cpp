@@ -1,5 +1,6 @@
 #include "ActorFactory.h"
 
+#include "AssetRefs.h"
 #include "Logger.h"
 
 #include <nlohmann/json.hpp>
@@ -8,6 +9,8 @@
 #include <boost/algorithm/string/split.hpp>
 #include <boost/algorithm/string/trim.hpp>
 
+#include <map>
+
 static glm::vec4 stringToVector(std::string str)
 {
     glm::vec4 retval{1.0f};
@@ -25,6 +28,33 @@ static glm::vec4 stringToVector(std::string str)
 
 //------------------------------------------------------------------------------
 
+static int stringToLayers(std::string str)
+{
+    static const std::map<std::string, int> layers = {
+        {"default", PhysicsComponent::Default},       {"static", PhysicsComponent::Static},
+        {"debris", PhysicsComponent::Debris},         {"character", PhysicsComponent::Character},
+        {"projectile", PhysicsComponent::Projectile}, {"trigger", PhysicsComponent::Trigger},
+        {"all", PhysicsComponent::AllLayers},
+    };
+
+    int retval = 0;
+
+    boost::trim(str);
+    if (str.empty()) return retval;
+
+    std::vector<std::string> splitted;
+    boost::split(splitted, str, boost::is_any_of(" \t"), boost::token_compress_on);
+    for (const auto& name : splitted) {
+        auto it = layers.find(name);
+        if (it == layers.cend()) throw std::runtime_error{"Unknown collision layer: " + name};
+        retval |= it->second;
+    }
+
+    return retval;
+}
+
+//------------------------------------------------------------------------------
+
 static std::shared_ptr<RenderComponent> getRenderComponent(const nlohmann::json& node,
                                                            RenderComponent prototype)
 {
@@ -93,6 +123,12 @@ static std::shared_ptr<PhysicsComponent> getPhysicsComponent(const nlohmann::jso
     ph->shape = node.value("shape", prototype.shape);
     ph->mass  = node.value("mass", prototype.mass);
 
+    // Names separated by spaces, e.g. "mask": "static character"
+    auto layer = node.find("layer");
+    ph->layer  = layer != node.cend() ? stringToLayers(layer->get<std::string>()) : prototype.layer;
+    auto mask  = node.find("mask");
+    ph->mask   = mask != node.cend() ? stringToLayers(mask->get<std::string>()) : prototype.mask;
+
     return ph;
 }
 
@@ -232,6 +268,14 @@ std::unique_ptr<Actor> ActorFactory::create(const nlohmann::json& node)
     return a;
 }
 
+//------------------------------------------------------------------------------
+
+void ActorFactory::addAssetRefs(AssetRefs& refs) const
+{
+    for (const auto& p : m_prototypes)
+        refs.add(*p.second);
+}
+
 //--------------------------------------------------------------------------
 
 unsigned int ActorFactory::getNextId()
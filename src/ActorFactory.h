@@ -11,6 +11,7 @@
 #include <memory>
 
 class GameLogic;
+struct AssetRefs;
 
 class ActorFactory
 {
@@ -18,6 +19,9 @@ class ActorFactory
     void registerPrototype(const nlohmann::json& node);
     std::unique_ptr<Actor> create(const nlohmann::json& mode);
 
+    /// Assets used by registered prototypes (actors can be created from them later)
+    void addAssetRefs(AssetRefs& refs) const;
+
   private:
     unsigned int getNextId();
 
@@ -0,0 +1,87 @@
+#include "AssetCache.h"
+
+#include "Logger.h"
+
+#include <cstdio>
+#include <fstream>
+
+AssetCache::Hasher::Hasher(const std::string& tag) { add(tag.data(), tag.size()); }
+
+//------------------------------------------------------------------------------
+
+AssetCache::Hasher& AssetCache::Hasher::add(const void* data, std::size_t size)
+{
+    const auto* bytes = static_cast<const uint8_t*>(data);
+
+    for (std::size_t i = 0; i < size; ++i) {
+        m_hash ^= bytes[i];
+        m_hash *= 1099511628211ull;
+    }
+    return *this;
+}
+
+//==============================================================================
+
+AssetCache::AssetCache(std::filesystem::path folder)
+    : m_folder{std::move(folder)}
+{
+    if (!enabled()) return;
+
+    std::error_code ec;
+    std::filesystem::create_directories(m_folder, ec);
+    if (ec) {
+        LOG_WARNING("Asset cache disabled. Unable to create {}: {}", m_folder.string(),
+                    ec.message());
+        m_folder.clear();
+    }
+}
+
+//------------------------------------------------------------------------------
+
+std::filesystem::path AssetCache::entryPath(uint64_t key) const
+{
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.bin", static_cast<unsigned long long>(key));
+    return m_folder / name;
+}
+
+//------------------------------------------------------------------------------
+
+bool AssetCache::load(uint64_t key, std::vector<uint8_t>& data) const
+{
+    if (!enabled()) return false;
+
+    std::ifstream in{entryPath(key), std::ios::binary | std::ios::ate};
+    if (!in) return false;
+
+    data.resize(static_cast<std::size_t>(in.tellg()));
+    in.seekg(0);
+    in.read(reinterpret_cast<char*>(data.data()), data.size());
+
+    return bool(in);
+}
+
+//------------------------------------------------------------------------------
+
+void AssetCache::store(uint64_t key, const std::vector<uint8_t>& data) const
+{
+    if (!enabled()) return;
+
+    // Write to temporary file first so that readers never see partial entry
+    const auto path = entryPath(key);
+    auto tmpPath    = path;
+    tmpPath += ".tmp";
+
+    {
+        std::ofstream out{tmpPath, std::ios::binary | std::ios::trunc};
+        out.write(reinterpret_cast<const char*>(data.data()), data.size());
+        if (!out) {
+            LOG_WARNING("Unable to write asset cache entry: {}", tmpPath.string());
+            return;
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tmpPath, path, ec);
+    if (ec) LOG_WARNING("Unable to write asset cache entry: {}", path.string());
+}
@@ -0,0 +1,55 @@
+#ifndef ASSETCACHE_H
+#define ASSETCACHE_H
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Disk cache for data cooked at import time.
+ *
+ * Entries are addressed by hash of their input data, so changed source gives new entry and
+ * stale ones are simply never read. Empty folder disables the cache.
+ */
+class AssetCache final
+{
+  public:
+    /// FNV-1a, incremental
+    class Hasher final
+    {
+      public:
+        explicit Hasher(const std::string& tag);
+
+        Hasher& add(const void* data, std::size_t size);
+
+        template <typename T>
+        Hasher& add(const std::vector<T>& v)
+        {
+            add(v.size());
+            return add(v.data(), v.size() * sizeof(T));
+        }
+
+        Hasher& add(std::size_t value) { return add(&value, sizeof(value)); }
+
+        uint64_t value() const { return m_hash; }
+
+      private:
+        uint64_t m_hash = 14695981039346656037ull;
+    };
+
+    explicit AssetCache(std::filesystem::path folder = {});
+
+    bool enabled() const { return !m_folder.empty(); }
+
+    /// Returns false if there is no entry
+    bool load(uint64_t key, std::vector<uint8_t>& data) const;
+    void store(uint64_t key, const std::vector<uint8_t>& data) const;
+
+  private:
+    std::filesystem::path entryPath(uint64_t key) const;
+
+    std::filesystem::path m_folder;
+};
+
+#endif // ASSETCACHE_H
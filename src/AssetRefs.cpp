@@ -0,0 +1,23 @@
+#include "AssetRefs.h"
+
+#include "Actor.h"
+
+void AssetRefs::add(Actor& actor)
+{
+    if (auto rd = actor.getComponent<RenderComponent>(ComponentId::Render).lock()) {
+        if (!rd->shaderProgram.empty()) shaderPrograms.insert(rd->shaderProgram);
+    }
+
+    if (auto lt = actor.getComponent<LightComponent>(ComponentId::Light).lock()) {
+        if (!lt->material.empty()) materials.insert(lt->material);
+    }
+}
+
+//------------------------------------------------------------------------------
+
+void AssetRefs::add(const AssetRefs& other)
+{
+    shaderPrograms.insert(std::cbegin(other.shaderPrograms), std::cend(other.shaderPrograms));
+    materials.insert(std::cbegin(other.materials), std::cend(other.materials));
+    fonts.insert(std::cbegin(other.fonts), std::cend(other.fonts));
+}
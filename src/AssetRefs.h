@@ -0,0 +1,28 @@
+#ifndef ASSETREFS_H
+#define ASSETREFS_H
+
+#include <set>
+#include <string>
+
+class Actor;
+
+/**
+ * @brief Names of assets reachable from a scene.
+ *
+ * Collected before resources are loaded. ResourcesMgr loads these eagerly and everything else
+ * registered in assets file on first use.
+ */
+struct AssetRefs
+{
+    std::set<std::string> shaderPrograms;
+    std::set<std::string> materials;
+    std::set<std::string> fonts;
+
+    /// Adds assets referenced by actor's components
+    void add(Actor& actor);
+    void add(const AssetRefs& other);
+
+    std::size_t size() const { return shaderPrograms.size() + materials.size() + fonts.size(); }
+};
+
+#endif // ASSETREFS_H
@@ -1,6 +1,8 @@
 #ifndef COMPONENTS_H
 #define COMPONENTS_H
 
+#include "Handle.h"
+
 #include <glm/glm.hpp>
 #include <glm/gtx/quaternion.hpp>
 #include <glm/gtx/matrix_decompose.hpp>
@@ -8,6 +10,8 @@
 #include <string>
 #include <vector>
 
+class Script;
+
 enum class ComponentId { Transformation, Render, Light, Physics, Control, Script };
 
 struct Component
@@ -58,8 +62,21 @@ struct LightComponent : public Component
 
 struct PhysicsComponent : public Component
 {
+    /// Collision layers, bodies pair up only when each one's layer is in the other's mask
+    enum Layer {
+        Default    = (1 << 0), //< Dynamic bodies with no other layer
+        Static     = (1 << 1), //< Static world
+        Debris     = (1 << 2), //< Small pieces, do not collide with each other
+        Character  = (1 << 3),
+        Projectile = (1 << 4),
+        Trigger    = (1 << 5), //< Detects overlaps, no contact response
+        AllLayers  = (1 << 6) - 1,
+    };
+
     std::string shape;
     float mass         = 0.0f;
+    int layer          = 0; //< One Layer, 0 picks Static or Default by mass
+    int mask           = 0; //< Layers it collides with, 0 picks the usual ones for layer
     glm::vec3 maxForce = glm::vec3{5000, 5000, 5000};
     glm::vec3 maxTorque{};
     glm::vec3 force{};
@@ -88,6 +105,7 @@ struct ControlComponent : public Component
 struct ScriptComponent : public Component
 {
     std::string name;
+    Handle<Script> script; //< Resolved from name when actor is added
 };
 
 #endif // COMPONENTS_H
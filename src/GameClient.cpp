@@ -1,8 +1,10 @@
 #include "GameClient.h"
 
 #include "CameraController.h"
+#include "Logger.h"
 #include "Terrain.h"
 #include "gfx/Camera.h"
+#include "gfx/GpuMemory.h"
 #include "gfx/Model.h"
 #include "gfx/Shader.h"
 #include "gfx/Skybox.h"
@@ -23,6 +25,7 @@ GameClient::GameClient(const Settings& settings, const std::shared_ptr<Resources
         m_resourcesMgr =
             std::make_shared<ResourcesMgr>(m_settings.dataFolder, m_settings.shadersFolder);
     }
+    m_resourcesMgr->setMemoryBudget(std::size_t(m_settings.gpuMemoryBudget) * 1024 * 1024);
 
     m_freeCameraCtrl = std::make_unique<FreeCameraController>();
 
@@ -53,9 +56,13 @@ void GameClient::resizeWindow(int width, int height)
 
 //------------------------------------------------------------------------------
 
-void GameClient::loadResources(const std::string& file)
+void GameClient::loadResources(const std::string& file, const AssetRefs& refs)
 {
+    AssetRefs allRefs = refs;
+    gfx::RenderSystem::addCommonAssetRefs(allRefs);
+
     m_resourcesMgr->load(file);
+    m_resourcesMgr->preload(allRefs);
     m_renderSystem.loadCommonResources(*m_resourcesMgr);
 
     m_resourcesFile = file;
@@ -87,7 +94,12 @@ void GameClient::addActor(int id, TransformationComponent* tr, RenderComponent*
             fullPath /= rd->model;
 
             if (fullPath.extension() == ".gltf") {
-                loaders::GltfLoader loader;
+                loaders::GltfLoader::Options options;
+                options.cacheFolder    = m_settings.cacheFolder;
+                options.streamTextures = m_settings.textureStreaming;
+                options.quantizeMeshes = m_settings.quantizeMeshes;
+
+                loaders::GltfLoader loader{options};
                 loader.load(fullPath);
                 model = loader.model();
             } else if (fullPath.extension() == ".obj") {
@@ -96,7 +108,11 @@ void GameClient::addActor(int id, TransformationComponent* tr, RenderComponent*
                 model = loader.model();
             }
             model->name = rd->model;
-            if (model) m_renderSystem.addModel(model);
+            if (model) {
+                m_renderSystem.addModel(model);
+                for (const auto& texture : model->textures())
+                    m_resourcesMgr->track(texture);
+            }
         }
     }
 
@@ -125,6 +141,7 @@ void GameClient::draw()
 
     m_renderSystem.draw();
     m_debugDraw.draw(m_renderSystem.getCamera());
+    m_resourcesMgr->enforceMemoryBudget();
 
     static bool showNormals    = false;
     static float normalLength  = 1.0f;
@@ -136,6 +153,13 @@ void GameClient::draw()
     ImGui::Text("Application average %.3f ms/frame (%.1f FPS)", 1000.0f / ImGui::GetIO().Framerate,
                 ImGui::GetIO().Framerate);
 
+    ImGui::Text("GPU memory: textures %.1f MB, buffers %.1f MB",
+                gfx::GpuMemory::used(gfx::GpuMemory::Textures) / 1048576.0,
+                gfx::GpuMemory::used(gfx::GpuMemory::Buffers) / 1048576.0);
+    if (ImGui::Button("Residency report")) {
+        LOG_INFO("{}", m_resourcesMgr->residencyReport());
+    }
+
     if (ImGui::Checkbox("VSync", &vsync)) {
         toggleVSync();
     }
@@ -166,6 +190,14 @@ void GameClient::draw()
 
 //------------------------------------------------------------------------------
 
+bool GameClient::cameraPosition(glm::vec3& position) const
+{
+    position = glm::vec3{m_camera.worldTranslation()};
+    return true;
+}
+
+//------------------------------------------------------------------------------
+
 void GameClient::update(float delta)
 {
     m_inputSystem.update(delta);
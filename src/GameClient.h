@@ -19,7 +19,7 @@ class GameClient : public SDLWindow
     GameClient(const Settings& settings, const std::shared_ptr<ResourcesMgr>& resourcesMgr = {});
     ~GameClient();
 
-    void loadResources(const std::string& xmlFile) override;
+    void loadResources(const std::string& xmlFile, const AssetRefs& refs) override;
     void unloadResources() override;
 
     void addActor(int id, TransformationComponent* tr, RenderComponent* rd, LightComponent* lt,
@@ -28,6 +28,8 @@ class GameClient : public SDLWindow
 
     PhysicsDebugDrawer* debugDrawer() override { return &m_debugDraw; }
 
+    bool cameraPosition(glm::vec3& position) const override;
+
   protected:
     void resizeWindow(int width, int height) override;
 
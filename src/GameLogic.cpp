@@ -1,11 +1,11 @@
 #include "GameLogic.h"
 #include "ActorFactory.h"
+#include "Logger.h"
 #include "PhysicsSystem.h"
+#include "Vfs.h"
 
 #include <nlohmann/json.hpp>
 
-#include <fstream>
-
 class RotationScript : public Script
 {
   public:
@@ -21,53 +21,84 @@ class RotationScript : public Script
 class ControlScript : public Script
 {
   public:
+    explicit ControlScript(PhysicsSystem& physicsSystem)
+        : m_physicsSystem{physicsSystem}
+    {
+    }
+
     void execute(float /*elapsedTime*/, Actor* a) override
     {
         auto ctrl = a->getComponent<ControlComponent>(ComponentId::Control).lock();
         auto ph   = a->getComponent<PhysicsComponent>(ComponentId::Physics).lock();
 
         if (ctrl && ph) {
-            ph->force  = glm::vec3{0.f, 9.81f * ph->mass, 0.f};
-            ph->torque = glm::vec3{};
+            glm::vec3 force{0.f, 9.81f * ph->mass, 0.f};
+            glm::vec3 torque{};
 
             if (ctrl->actions & ControlComponent::Forward) {
-                ph->force.z += ph->maxForce.z;
+                force.z += ph->maxForce.z;
             }
             if (ctrl->actions & ControlComponent::Back) {
-                ph->force.z -= ph->maxForce.z;
+                force.z -= ph->maxForce.z;
             }
             if (ctrl->actions & ControlComponent::Up) {
-                ph->force.y += ph->maxForce.y;
+                force.y += ph->maxForce.y;
             }
             if (ctrl->actions & ControlComponent::Down) {
-                ph->force.y -= ph->maxForce.y;
+                force.y -= ph->maxForce.y;
             }
             if (ctrl->actions & ControlComponent::StrafeRight) {
-                // ph->force.x -= ph->maxForce.x;
-                ph->torque.y -= 200;
+                // force.x -= ph->maxForce.x;
+                torque.y -= 200;
             }
             if (ctrl->actions & ControlComponent::StrafeLeft) {
-                // ph->force.x += ph->maxForce.x;
-                ph->torque.y += 200;
+                // force.x += ph->maxForce.x;
+                torque.y += 200;
             }
-            ph->torque.x = -ctrl->axes.y * 200;
-            ph->torque.z = ctrl->axes.x * 200;
+            torque.x = -ctrl->axes.y * 200;
+            torque.z = ctrl->axes.x * 200;
+
+            m_physicsSystem.setInput(a->id(), force, torque);
         }
     }
+
+  private:
+    PhysicsSystem& m_physicsSystem;
 };
 
 //==============================================================================
 
+static PhysicsSystem::Options physicsOptions(const Settings& settings,
+                                             const std::shared_ptr<ResourcesMgr>& resourcesMgr)
+{
+    PhysicsSystem::Options options;
+    options.fixedTimeStep = 1.0f / settings.physicsTickRate;
+    options.maxSubSteps   = settings.physicsMaxSubSteps;
+    options.world.threads = settings.physicsThreads;
+    options.dataFolder    = settings.dataFolder;
+    options.cacheFolder   = settings.cacheFolder;
+    options.heightfields  = [resourcesMgr](const std::string& name) {
+        return resourcesMgr->getHeightfield(name);
+    };
+    options.activeRadius  = settings.physicsActiveRadius;
+    options.reducedRadius = settings.physicsReducedRadius;
+    options.reducedRate   = settings.physicsReducedRate;
+    return options;
+}
+
+//------------------------------------------------------------------------------
+
 GameLogic::GameLogic(const Settings& settings, const std::shared_ptr<ResourcesMgr>& resourcesMgr)
     : m_settings{settings}
     , m_resourcesMgr(resourcesMgr)
-    , m_physicsSystem{new PhysicsSystem}
 {
     if (!m_resourcesMgr) {
         m_resourcesMgr =
             std::make_shared<ResourcesMgr>(m_settings.dataFolder, m_settings.shadersFolder);
     }
 
+    m_physicsSystem = std::make_unique<PhysicsSystem>(physicsOptions(settings, m_resourcesMgr));
+
     m_resourcesMgr->addScript("sun_script", std::make_shared<RotationScript>());
 }
 
@@ -89,26 +120,35 @@ void GameLogic::attachView(std::shared_ptr<GameView> gameView, unsigned actorId)
 void GameLogic::onBeforeMainLoop(Engine* /*e*/)
 {
     // Load scene
-    nlohmann::json json;
-
-    {
-        std::ifstream f(m_settings.dataFolder + "scene.json");
-        f >> json;
-    }
-
-    for (auto& gv : m_gameViews) {
-        gv->loadResources(json["assets"]);
-    }
+    const FileData data = Vfs::global().read(m_settings.dataFolder + "scene.json");
+    auto json           = nlohmann::json::parse(data.view().begin(), data.view().end());
 
     ActorFactory factory;
     for (auto p : json["prototypes"]) {
         factory.registerPrototype(p);
     }
+
+    // Only assets used by the scene are loaded now
+    AssetRefs refs;
+    factory.addAssetRefs(refs);
+
     for (auto i : json["actors"]) {
         auto a = factory.create(i);
+        refs.add(*a);
+
+        auto sc = a->getComponent<ScriptComponent>(ComponentId::Script).lock();
+        if (sc) {
+            sc->script = m_resourcesMgr->findScript(sc->name);
+            if (!sc->script) LOG_WARNING("Script '{}' not loaded", sc->name);
+        }
+
         m_actors.push_back(std::move(a));
     }
 
+    for (auto& gv : m_gameViews) {
+        gv->loadResources(json["assets"], refs);
+    }
+
     for (auto& gv : m_gameViews) {
         for (auto& a : m_actors) {
             auto tr = a->getComponent<TransformationComponent>(ComponentId::Transformation).lock();
@@ -124,7 +164,7 @@ void GameLogic::onBeforeMainLoop(Engine* /*e*/)
         auto tr = a->getComponent<TransformationComponent>(ComponentId::Transformation).lock();
         auto ph = a->getComponent<PhysicsComponent>(ComponentId::Physics).lock();
 
-        if (tr && ph) m_physicsSystem->addActor(a->id(), tr.get(), ph.get(), *m_resourcesMgr);
+        if (tr && ph) m_physicsSystem->addActor(a->id(), tr.get(), ph.get());
     }
 }
 
@@ -146,21 +186,43 @@ void GameLogic::onAfterMainLoop(Engine* /*e*/)
 void GameLogic::update(float elapsedTime)
 {
     for (auto& a : m_actors) {
-        ControlScript ctrlScript;
+        ControlScript ctrlScript{*m_physicsSystem};
         ctrlScript.execute(elapsedTime, a.get());
 
         auto sc = a->getComponent<ScriptComponent>(ComponentId::Script).lock();
         if (sc) {
-            auto script = m_resourcesMgr->getScript(sc->name);
-            script->execute(elapsedTime, a.get());
+            auto script = m_resourcesMgr->get(sc->script);
+            if (script) script->execute(elapsedTime, a.get());
         }
     }
 
+    m_physicsSystem->setRegionCenters(regionCenters());
     m_physicsSystem->update(elapsedTime);
 }
 
 //------------------------------------------------------------------------------
 
+std::vector<glm::vec3> GameLogic::regionCenters() const
+{
+    std::vector<glm::vec3> centers;
+
+    glm::vec3 position;
+    for (const auto& gv : m_gameViews) {
+        if (gv->cameraPosition(position)) centers.push_back(position);
+    }
+
+    for (const auto& a : m_actors) {
+        if (a->getComponent<ControlComponent>(ComponentId::Control).expired()) continue;
+
+        auto tr = a->getComponent<TransformationComponent>(ComponentId::Transformation).lock();
+        if (tr) centers.push_back(tr->translation);
+    }
+
+    return centers;
+}
+
+//------------------------------------------------------------------------------
+
 void GameLogic::debugDraw()
 {
     if (m_drawDebug) m_physicsSystem->drawDebugData();
@@ -9,6 +9,7 @@
 #include <boost/utility.hpp>
 #include <list>
 #include <memory>
+#include <vector>
 
 class Engine;
 class PhysicsSystem;
@@ -35,6 +36,9 @@ class GameLogic final : private boost::noncopyable
     void toggleDrawDebug() { m_drawDebug = !m_drawDebug; }
 
   private:
+    /// Cameras and controlled actors
+    std::vector<glm::vec3> regionCenters() const;
+
     const Settings m_settings;
     std::shared_ptr<ResourcesMgr> m_resourcesMgr;
     std::unique_ptr<PhysicsSystem> m_physicsSystem;
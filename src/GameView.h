@@ -1,6 +1,7 @@
 #ifndef GAMEVIEW_H
 #define GAMEVIEW_H
 
+#include "AssetRefs.h"
 #include "Components.h"
 #include "PhysicsDebugDrawer.h"
 
@@ -19,14 +20,18 @@ class GameView : private boost::noncopyable
     /*! Callbacks */
     virtual void onAttach(int /*gameViewId*/, unsigned long /*actorId*/) {}
 
-    virtual void loadResources(const std::string& xmlFile) = 0;
-    virtual void unloadResources()                         = 0;
+    /// refs are assets used by scene actors and prototypes
+    virtual void loadResources(const std::string& xmlFile, const AssetRefs& refs) = 0;
+    virtual void unloadResources()                                                = 0;
 
     virtual void addActor(int id, TransformationComponent* tr, RenderComponent* rd,
                           LightComponent* lt, ControlComponent* ctrl) = 0;
     virtual void removeActor(int id) = 0;
 
     virtual PhysicsDebugDrawer* debugDrawer() { return nullptr; }
+
+    /// Physics is simulated around it, false if view has no camera
+    virtual bool cameraPosition(glm::vec3& /*position*/) const { return false; }
 };
 
 #endif // GAMEVIEW_H
@@ -0,0 +1,132 @@
+#ifndef HANDLE_H
+#define HANDLE_H
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+template <typename T>
+class HandlePool;
+
+/**
+ * @brief Typed reference to an object in HandlePool.
+ *
+ * Index gives O(1) access, generation detects handles to removed objects. Default constructed
+ * handle is null.
+ */
+template <typename T>
+class Handle final
+{
+    friend class HandlePool<T>;
+
+  public:
+    Handle() = default;
+
+    bool isNull() const { return m_generation == 0; }
+    explicit operator bool() const { return !isNull(); }
+
+    uint32_t index() const { return m_index; }
+    uint32_t generation() const { return m_generation; }
+
+    bool operator==(const Handle& other) const
+    {
+        return m_index == other.m_index && m_generation == other.m_generation;
+    }
+    bool operator!=(const Handle& other) const { return !(*this == other); }
+
+  private:
+    Handle(uint32_t index, uint32_t generation)
+        : m_index{index}
+        , m_generation{generation}
+    {
+    }
+
+    uint32_t m_index      = 0;
+    uint32_t m_generation = 0; //< 0 is null handle
+};
+
+//==============================================================================
+
+/**
+ * @brief Owns objects addressed by Handle.
+ *
+ * Slots of removed objects are reused with increased generation, so stale handles resolve to
+ * nullptr instead of a different object.
+ */
+template <typename T>
+class HandlePool final
+{
+  public:
+    Handle<T> add(std::shared_ptr<T> object)
+    {
+        uint32_t index;
+        if (!m_free.empty()) {
+            index = m_free.back();
+            m_free.pop_back();
+        } else {
+            index = static_cast<uint32_t>(m_slots.size());
+            m_slots.emplace_back();
+        }
+
+        Slot& slot  = m_slots[index];
+        slot.object = std::move(object);
+        return Handle<T>{index, slot.generation};
+    }
+
+    /// Puts object in place of the one handle refers to, its handles stay valid. False for null
+    /// or stale handle.
+    bool replace(Handle<T> handle, std::shared_ptr<T> object)
+    {
+        if (!get(handle)) return false;
+
+        m_slots[handle.m_index].object = std::move(object);
+        return true;
+    }
+
+    void remove(Handle<T> handle)
+    {
+        if (!get(handle)) return;
+
+        Slot& slot = m_slots[handle.m_index];
+        slot.object.reset();
+        if (++slot.generation == 0) slot.generation = 1;
+        m_free.push_back(handle.m_index);
+    }
+
+    /// nullptr for null or stale handle
+    T* get(Handle<T> handle) const
+    {
+        if (handle.m_index >= m_slots.size()) return nullptr;
+
+        const Slot& slot = m_slots[handle.m_index];
+        return slot.generation == handle.m_generation ? slot.object.get() : nullptr;
+    }
+
+    std::shared_ptr<T> getShared(Handle<T> handle) const
+    {
+        return get(handle) ? m_slots[handle.m_index].object : std::shared_ptr<T>{};
+    }
+
+    /// Calls func(handle, object) for every object
+    template <typename F>
+    void forEach(F func) const
+    {
+        for (uint32_t i = 0; i < m_slots.size(); ++i) {
+            if (m_slots[i].object) func(Handle<T>{i, m_slots[i].generation}, m_slots[i].object);
+        }
+    }
+
+    std::size_t size() const { return m_slots.size() - m_free.size(); }
+
+  private:
+    struct Slot
+    {
+        std::shared_ptr<T> object;
+        uint32_t generation = 1;
+    };
+
+    std::vector<Slot> m_slots;
+    std::vector<uint32_t> m_free;
+};
+
+#endif // HANDLE_H
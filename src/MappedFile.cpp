@@ -0,0 +1,110 @@
+#include "MappedFile.h"
+
+#include <stdexcept>
+#include <utility>
+
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(_WIN32)
+
+MappedFile::MappedFile(const std::filesystem::path& file)
+{
+    const auto error = [&file](const char* what) {
+        return std::runtime_error{std::string{what} + ": " + file.string()};
+    };
+
+    HANDLE handle = CreateFileW(file.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                                OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (handle == INVALID_HANDLE_VALUE) throw error("Unable to open");
+    m_file = handle;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(handle, &size)) {
+        CloseHandle(handle);
+        throw error("Unable to get size of");
+    }
+    m_size = static_cast<std::size_t>(size.QuadPart);
+
+    if (m_size == 0) return;
+
+    m_mapping = CreateFileMappingW(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!m_mapping) {
+        CloseHandle(handle);
+        throw error("Unable to map");
+    }
+
+    m_data = static_cast<const char*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+    if (!m_data) {
+        CloseHandle(m_mapping);
+        CloseHandle(handle);
+        throw error("Unable to map");
+    }
+}
+
+MappedFile::~MappedFile()
+{
+    if (m_data) UnmapViewOfFile(m_data);
+    if (m_mapping) CloseHandle(m_mapping);
+    if (m_file) CloseHandle(m_file);
+}
+
+#else
+
+MappedFile::MappedFile(const std::filesystem::path& file)
+{
+    const auto error = [&file](const char* what) {
+        return std::runtime_error{std::string{what} + ": " + file.string()};
+    };
+
+    const int fd = open(file.c_str(), O_RDONLY);
+    if (fd == -1) throw error("Unable to open");
+
+    struct stat st;
+    if (fstat(fd, &st) == -1) {
+        close(fd);
+        throw error("Unable to get size of");
+    }
+    m_size = static_cast<std::size_t>(st.st_size);
+
+    if (m_size > 0) {
+        void* ptr = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (ptr == MAP_FAILED) {
+            close(fd);
+            throw error("Unable to map");
+        }
+        posix_madvise(ptr, m_size, POSIX_MADV_SEQUENTIAL);
+        m_data = static_cast<const char*>(ptr);
+    }
+
+    // Mapping stays valid after descriptor is closed
+    close(fd);
+}
+
+MappedFile::~MappedFile()
+{
+    if (m_data) munmap(const_cast<char*>(m_data), m_size);
+}
+
+#endif
+
+//------------------------------------------------------------------------------
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+{
+    std::swap(m_data, other.m_data);
+    std::swap(m_size, other.m_size);
+#if defined(_WIN32)
+    std::swap(m_file, other.m_file);
+    std::swap(m_mapping, other.m_mapping);
+#endif
+}
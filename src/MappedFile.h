@@ -0,0 +1,37 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <filesystem>
+#include <string_view>
+
+/**
+ * @brief Read-only memory mapping of the whole file.
+ *
+ * Throws std::runtime_error if file cannot be opened or mapped. Empty files are valid and give
+ * empty view.
+ */
+class MappedFile final
+{
+  public:
+    explicit MappedFile(const std::filesystem::path& file);
+    MappedFile(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile& operator=(MappedFile&&) = delete;
+    ~MappedFile();
+
+    const char* data() const { return m_data; }
+    std::size_t size() const { return m_size; }
+    std::string_view view() const { return {m_data, m_size}; }
+
+  private:
+    const char* m_data = nullptr;
+    std::size_t m_size = 0;
+
+#if defined(_WIN32)
+    void* m_file    = nullptr;
+    void* m_mapping = nullptr;
+#endif
+};
+
+#endif // MAPPEDFILE_H
@@ -0,0 +1,175 @@
+#include "PackFile.h"
+
+#include <zlib.h>
+
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+constexpr char Magic[4]    = {'N', 'B', 'D', 'P'};
+constexpr uint32_t Version = 1;
+
+#pragma pack(push, 1)
+struct Header
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t entriesCount;
+    uint64_t indexOffset;
+};
+
+struct IndexRecord
+{
+    uint64_t offset;
+    uint64_t storedSize;
+    uint64_t size;
+    uint32_t compression;
+    uint32_t pathLength; //< Followed by path bytes
+};
+#pragma pack(pop)
+
+} // namespace
+
+PackFile::PackFile(const std::filesystem::path& file)
+    : m_path{file}
+    , m_file{file}
+{
+    const auto error = [&file](const char* what) {
+        return std::runtime_error{std::string{what} + ": " + file.string()};
+    };
+
+    const char* data  = m_file.data();
+    const size_t size = m_file.size();
+
+    Header header;
+    if (size < sizeof(header)) throw error("Not a pack file");
+    std::memcpy(&header, data, sizeof(header));
+
+    if (std::memcmp(header.magic, Magic, sizeof(Magic)) != 0) throw error("Not a pack file");
+    if (header.version != Version) throw error("Unsupported pack version");
+    if (header.indexOffset > size) throw error("Truncated pack file");
+
+    m_entries.reserve(header.entriesCount);
+
+    std::size_t pos = header.indexOffset;
+    for (uint32_t i = 0; i < header.entriesCount; ++i) {
+        IndexRecord record;
+        if (size - pos < sizeof(record)) throw error("Truncated pack file");
+        std::memcpy(&record, data + pos, sizeof(record));
+        pos += sizeof(record);
+
+        if (size - pos < record.pathLength || record.offset > size ||
+            size - record.offset < record.storedSize)
+            throw error("Truncated pack file");
+
+        const std::string_view path{data + pos, record.pathLength};
+        pos += record.pathLength;
+
+        m_entries[path] = Entry{record.offset, record.storedSize, record.size,
+                                static_cast<Compression>(record.compression)};
+    }
+}
+
+//------------------------------------------------------------------------------
+
+const PackFile::Entry* PackFile::find(std::string_view path) const
+{
+    auto it = m_entries.find(path);
+    return it != std::end(m_entries) ? &it->second : nullptr;
+}
+
+//------------------------------------------------------------------------------
+
+std::string_view PackFile::stored(const Entry& entry) const
+{
+    if (entry.compression != Compression::None) return {};
+    return {m_file.data() + entry.offset, entry.storedSize};
+}
+
+//------------------------------------------------------------------------------
+
+std::string PackFile::read(const Entry& entry) const
+{
+    const char* src = m_file.data() + entry.offset;
+
+    switch (entry.compression) {
+    case Compression::None: return std::string(src, entry.storedSize);
+    case Compression::Zlib: {
+        std::string data(entry.size, '\0');
+        uLongf destLen = static_cast<uLongf>(entry.size);
+        if (uncompress(reinterpret_cast<Bytef*>(&data[0]), &destLen,
+                       reinterpret_cast<const Bytef*>(src),
+                       static_cast<uLong>(entry.storedSize)) != Z_OK ||
+            destLen != entry.size)
+            throw std::runtime_error{"Corrupted entry in pack file: " + m_path.string()};
+        return data;
+    }
+    }
+    throw std::runtime_error{"Unknown compression in pack file: " + m_path.string()};
+}
+
+//==============================================================================
+
+PackWriter::PackWriter(const std::filesystem::path& file)
+    : m_path{file}
+    , m_out{file, std::ios::binary | std::ios::trunc}
+{
+    if (!m_out) throw std::runtime_error{"Unable to create: " + file.string()};
+
+    // Real header is written by finish()
+    const Header header{};
+    m_out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    m_offset = sizeof(header);
+}
+
+//------------------------------------------------------------------------------
+
+void PackWriter::add(const std::string& path, std::string_view data, bool compress)
+{
+    PackFile::Entry entry{m_offset, data.size(), data.size(), PackFile::Compression::None};
+
+    std::string compressed;
+    if (compress && !data.empty()) {
+        uLongf destLen = compressBound(static_cast<uLong>(data.size()));
+        compressed.resize(destLen);
+        if (compress2(reinterpret_cast<Bytef*>(&compressed[0]), &destLen,
+                      reinterpret_cast<const Bytef*>(data.data()), static_cast<uLong>(data.size()),
+                      Z_BEST_COMPRESSION) == Z_OK &&
+            destLen <= data.size() - data.size() / 8) {
+            compressed.resize(destLen);
+            data              = compressed;
+            entry.storedSize  = destLen;
+            entry.compression = PackFile::Compression::Zlib;
+        }
+    }
+
+    m_out.write(data.data(), data.size());
+    m_offset += data.size();
+    m_index.push_back({path, entry});
+}
+
+//------------------------------------------------------------------------------
+
+void PackWriter::finish()
+{
+    Header header;
+    std::memcpy(header.magic, Magic, sizeof(Magic));
+    header.version      = Version;
+    header.entriesCount = static_cast<uint32_t>(m_index.size());
+    header.indexOffset  = m_offset;
+
+    for (const auto& e : m_index) {
+        const IndexRecord record{e.entry.offset, e.entry.storedSize, e.entry.size,
+                                 static_cast<uint32_t>(e.entry.compression),
+                                 static_cast<uint32_t>(e.path.size())};
+        m_out.write(reinterpret_cast<const char*>(&record), sizeof(record));
+        m_out.write(e.path.data(), e.path.size());
+    }
+
+    m_out.seekp(0);
+    m_out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    m_out.close();
+
+    if (!m_out) throw std::runtime_error{"Unable to write: " + m_path.string()};
+}
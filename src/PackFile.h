@@ -0,0 +1,86 @@
+#ifndef PACKFILE_H
+#define PACKFILE_H
+
+#include "MappedFile.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief Read-only archive of many files in one memory mapped file.
+ *
+ * Layout: header, file data, index. Index entry holds offset, stored size, original size,
+ * compression and path relative to the packed folder (with '/' separators). Stored entries are
+ * read straight from the mapping, zlib compressed ones are inflated on read.
+ *
+ * Throws std::runtime_error for files that are not packs or are truncated.
+ */
+class PackFile final
+{
+  public:
+    enum class Compression : uint32_t { None = 0, Zlib = 1 };
+
+    struct Entry
+    {
+        uint64_t offset;
+        uint64_t storedSize;
+        uint64_t size;
+        Compression compression;
+    };
+
+    explicit PackFile(const std::filesystem::path& file);
+
+    /// nullptr if there is no such file
+    const Entry* find(std::string_view path) const;
+
+    /// Data of stored entry or empty view for compressed one
+    std::string_view stored(const Entry& entry) const;
+    /// Inflated data of any entry
+    std::string read(const Entry& entry) const;
+
+    std::size_t size() const { return m_entries.size(); }
+    const std::filesystem::path& path() const { return m_path; }
+
+  private:
+    std::filesystem::path m_path;
+    MappedFile m_file;
+    std::unordered_map<std::string_view, Entry> m_entries; //< Keys point into the mapping
+};
+
+//==============================================================================
+
+/**
+ * @brief Writes PackFile.
+ *
+ * Data is streamed to the file as entries are added, index is written by finish().
+ */
+class PackWriter final
+{
+  public:
+    explicit PackWriter(const std::filesystem::path& file);
+
+    /// Compressed only if it saves at least 1/8 of size
+    void add(const std::string& path, std::string_view data, bool compress);
+    void finish();
+
+    uint64_t storedBytes() const { return m_offset; }
+
+  private:
+    struct IndexEntry
+    {
+        std::string path;
+        PackFile::Entry entry;
+    };
+
+    std::filesystem::path m_path;
+    std::ofstream m_out;
+    uint64_t m_offset = 0;
+    std::vector<IndexEntry> m_index;
+};
+
+#endif // PACKFILE_H
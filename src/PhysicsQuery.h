@@ -0,0 +1,74 @@
+#ifndef PHYSICSQUERY_H
+#define PHYSICSQUERY_H
+
+#include "Components.h"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+/**
+ * @brief Rays, sphere sweeps and sphere overlaps run together by PhysicsSystem.
+ *
+ * Fill query arrays and pass the batch to PhysicsSystem::query() or queue it with
+ * PhysicsSystem::queueQuery() to run after the next update. Results are written to arrays indexed
+ * like queries. Arrays keep their capacity, so a batch reused every frame does not allocate.
+ */
+struct PhysicsQueryBatch
+{
+    struct Ray
+    {
+        glm::vec3 from;
+        glm::vec3 to;
+        int ignoredActor = -1;                          //< e.g. the one casting it
+        int layers       = PhysicsComponent::AllLayers; //< PhysicsComponent layers hit
+    };
+
+    struct Sweep
+    {
+        glm::vec3 from;
+        glm::vec3 to;
+        float radius;
+        int ignoredActor = -1;
+        int layers       = PhysicsComponent::AllLayers;
+    };
+
+    struct Overlap
+    {
+        glm::vec3 center;
+        float radius;
+        int layers = PhysicsComponent::AllLayers;
+    };
+
+    struct Hit
+    {
+        int actorId    = -1; //< -1 if nothing was hit
+        float fraction = 1.0f;
+        glm::vec3 point{};
+        glm::vec3 normal{};
+
+        bool isHit() const { return actorId >= 0; }
+    };
+
+    std::vector<Ray> rays;
+    std::vector<Sweep> sweeps;
+    std::vector<Overlap> overlaps;
+
+    std::vector<Hit> rayHits;   //< Closest hit of each ray
+    std::vector<Hit> sweepHits; //< Closest hit of each sweep
+    /// Actors touching overlap i are overlapActors[overlapOffsets[i]] up to
+    /// overlapActors[overlapOffsets[i + 1]]
+    std::vector<int> overlapActors;
+    std::vector<int> overlapOffsets;
+
+    bool parallel = true; //< Split big batches across ThreadPool workers when world allows it
+
+    void clearQueries()
+    {
+        rays.clear();
+        sweeps.clear();
+        overlaps.clear();
+    }
+};
+
+#endif // PHYSICSQUERY_H
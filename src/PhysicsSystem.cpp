@@ -1,114 +1,618 @@
 #include "PhysicsSystem.h"
 
 #include "Logger.h"
+#include "ThreadPool.h"
 
 #include <BulletCollision/CollisionShapes/btHeightfieldTerrainShape.h>
+#include <BulletCollision/CollisionShapes/btScaledBvhTriangleMeshShape.h>
 #include <btBulletDynamicsCommon.h>
 
 #include <boost/algorithm/string.hpp>
 #include <boost/algorithm/string/split.hpp>
 
-class MotionState : public btMotionState
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <mutex>
+#include <numeric>
+#include <unordered_map>
+
+namespace {
+
+btTransform toBtTransform(const TransformationComponent& tr)
+{
+    const auto& p = tr.translation;
+    const auto& o = tr.rotation;
+    return btTransform{btQuaternion{o.x, o.y, o.z, o.w}, btVector3{p.x, p.y, p.z}};
+}
+
+void eraseValue(std::vector<int>& values, int value)
+{
+    values.erase(std::remove(values.begin(), values.end(), value), values.end());
+}
+
+btVector3 toBtVector3(const glm::vec3& v) { return btVector3{v.x, v.y, v.z}; }
+
+glm::vec3 toVec3(const btVector3& v) { return glm::vec3{v.x(), v.y(), v.z()}; }
+
+const int QueryGrain = 32; //< Queries per worker thread at least
+
+/// Layers colliding with layer when PhysicsComponent has no mask
+int defaultMask(int layer)
+{
+    using Ph = PhysicsComponent;
+
+    switch (layer) {
+    case Ph::Static: return Ph::AllLayers & ~Ph::Static;
+    case Ph::Debris: return Ph::Default | Ph::Static | Ph::Character | Ph::Projectile;
+    case Ph::Projectile: return Ph::AllLayers & ~Ph::Projectile;
+    case Ph::Trigger: return Ph::Default | Ph::Character | Ph::Projectile;
+    default: return Ph::AllLayers;
+    }
+}
+
+const float RegionHysteresis = 1.1f; //< Bodies leave a region this much farther than they enter
+const int RegionUpdateTicks  = 15;   //< Ticks between region updates at least
+
+/// Static body with shape, pose, filter flags and user indices of body
+btRigidBody* staticCopy(btRigidBody& body)
+{
+    btRigidBody::btRigidBodyConstructionInfo info{0, nullptr, body.getCollisionShape()};
+    info.m_startWorldTransform = body.getWorldTransform();
+
+    auto copy = new btRigidBody{info};
+    copy->setCollisionFlags(copy->getCollisionFlags() |
+                            (body.getCollisionFlags() & btCollisionObject::CF_NO_CONTACT_RESPONSE));
+    copy->setUserIndex(body.getUserIndex());
+    copy->setUserIndex2(body.getUserIndex2());
+    return copy;
+}
+
+const uint32_t StateMagic = 0x33534850; //< "PHS3"
+
+struct StateHeader
+{
+    uint32_t magic;
+    uint32_t bodies; //< Dynamic ones only
+    uint32_t joints;
+    uint32_t reducedTicks;
+    uint32_t regionTicks;
+    float accumulator;
+};
+
+struct BodyState
+{
+    int32_t actorId;
+    int32_t region;
+    int32_t frozenGroup;
+    int32_t activationState;
+    float deactivationTime;
+    float origin[3];
+    float rotation[4]; //< x, y, z, w
+    float linearVelocity[3];
+    float angularVelocity[3];
+};
+
+struct JointState
+{
+    float appliedImpulse;
+    int32_t enabled;
+};
+
+template <typename T>
+void write(std::vector<uint8_t>& out, const T& value)
+{
+    const auto bytes = reinterpret_cast<const uint8_t*>(&value);
+    out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+
+template <typename T>
+T read(const uint8_t*& in, const uint8_t* end)
+{
+    if (end - in < static_cast<std::ptrdiff_t>(sizeof(T)))
+        throw std::runtime_error{"Physics state is truncated"};
+
+    T value;
+    std::memcpy(&value, in, sizeof(T));
+    in += sizeof(T);
+    return value;
+}
+
+void toFloats(const btVector3& v, float (&out)[3])
+{
+    out[0] = v.x();
+    out[1] = v.y();
+    out[2] = v.z();
+}
+
+btVector3 fromFloats(const float (&v)[3]) { return btVector3{v[0], v[1], v[2]}; }
+
+/// Body user index 2 is actor id
+int actorOf(const btCollisionObject* obj) { return obj->getUserIndex2(); }
+
+/// Query is in all layers so body masks do not reject it, layers limit bodies it hits
+template <typename Callback>
+void setLayers(Callback& callback, int layers)
+{
+    callback.m_collisionFilterGroup = PhysicsComponent::AllLayers;
+    callback.m_collisionFilterMask  = layers;
+}
+
+bool isIgnored(btBroadphaseProxy* proxy, int ignoredActor)
+{
+    return ignoredActor >= 0 &&
+           actorOf(static_cast<const btCollisionObject*>(proxy->m_clientObject)) == ignoredActor;
+}
+
+struct RayCallback final : btCollisionWorld::ClosestRayResultCallback
 {
-  public:
-    explicit MotionState(TransformationComponent* tr)
-        : m_tr{tr}
+    RayCallback(const btVector3& from, const btVector3& to, int ignoredActor, int layers)
+        : ClosestRayResultCallback{from, to}
+        , ignoredActor{ignoredActor}
     {
+        setLayers(*this, layers);
     }
 
-    void getWorldTransform(btTransform& worldTrans) const override
+    bool needsCollision(btBroadphaseProxy* proxy) const override
     {
-        const auto& p = m_tr->translation;
-        worldTrans.setOrigin({p.x, p.y, p.z});
-        const auto& o = m_tr->rotation;
-        worldTrans.setRotation({o.x, o.y, o.z, o.w});
+        return ClosestRayResultCallback::needsCollision(proxy) && !isIgnored(proxy, ignoredActor);
     }
 
-    void setWorldTransform(const btTransform& worldTrans) override
+    int ignoredActor;
+};
+
+struct SweepCallback final : btCollisionWorld::ClosestConvexResultCallback
+{
+    SweepCallback(const btVector3& from, const btVector3& to, int ignoredActor, int layers)
+        : ClosestConvexResultCallback{from, to}
+        , ignoredActor{ignoredActor}
     {
-        m_tr->translation.x = worldTrans.getOrigin().x();
-        m_tr->translation.y = worldTrans.getOrigin().y();
-        m_tr->translation.z = worldTrans.getOrigin().z();
+        setLayers(*this, layers);
+    }
 
-        m_tr->rotation.x = worldTrans.getRotation().x();
-        m_tr->rotation.y = worldTrans.getRotation().y();
-        m_tr->rotation.z = worldTrans.getRotation().z();
-        m_tr->rotation.w = worldTrans.getRotation().w();
+    bool needsCollision(btBroadphaseProxy* proxy) const override
+    {
+        return ClosestConvexResultCallback::needsCollision(proxy) &&
+               !isIgnored(proxy, ignoredActor);
     }
 
-  private:
-    TransformationComponent* m_tr;
+    int ignoredActor;
 };
 
+/// Collects each touching actor once
+struct OverlapCallback final : btCollisionWorld::ContactResultCallback
+{
+    OverlapCallback(const btCollisionObject* probe, std::vector<int>& actors, int layers)
+        : probe{probe}
+        , actors{actors}
+        , first{actors.size()}
+    {
+        setLayers(*this, layers);
+    }
+
+    btScalar addSingleResult(btManifoldPoint& /*cp*/, const btCollisionObjectWrapper* colObj0,
+                             int /*partId0*/, int /*index0*/,
+                             const btCollisionObjectWrapper* colObj1, int /*partId1*/,
+                             int /*index1*/) override
+    {
+        // Dispatcher can pass the probe in either slot
+        const btCollisionObject* obj = colObj0->getCollisionObject();
+        if (obj == probe) obj = colObj1->getCollisionObject();
+
+        const int actor = actorOf(obj);
+        if (std::find(actors.begin() + first, actors.end(), actor) == actors.end())
+            actors.push_back(actor);
+        return 0;
+    }
+
+    const btCollisionObject* probe;
+    std::vector<int>& actors;
+    std::size_t first;
+};
+
+} // namespace
+
 //==============================================================================
 
 PhysicsSystem::PhysicsSystem()
+    : PhysicsSystem{Options{}}
 {
-    m_collisionConfiguration = new btDefaultCollisionConfiguration();
-    m_dispatcher             = new btCollisionDispatcher(m_collisionConfiguration);
-    m_overlappingPairCache   = new btDbvtBroadphase();
-    m_solver                 = new btSequentialImpulseConstraintSolver;
-    m_dynamicsWorld = new btDiscreteDynamicsWorld(m_dispatcher, m_overlappingPairCache, m_solver,
-                                                  m_collisionConfiguration);
-    m_dynamicsWorld->setGravity(btVector3(0, -9.81, 0));
+}
+
+//------------------------------------------------------------------------------
+
+PhysicsSystem::PhysicsSystem(const Options& options)
+    : m_heightfieldSource{options.heightfields}
+    , m_shapeCooker{options.dataFolder, options.cacheFolder, options.maxHullVertices}
+    , m_world{options.world}
+    , m_dynamicsWorld{m_world.dynamicsWorld()}
+    , m_activeRadius{options.activeRadius}
+    , m_reducedRadius{options.reducedRadius}
+    , m_reducedRate{std::max(options.reducedRate, 1)}
+    , m_fixedTimeStep{options.fixedTimeStep}
+    , m_maxSubSteps{options.maxSubSteps}
+{
+    if (m_activeRadius > 0.0f && m_reducedRadius > m_activeRadius) {
+        m_reducedWorld         = std::make_unique<PhysicsWorld>(options.world);
+        m_reducedDynamicsWorld = m_reducedWorld->dynamicsWorld();
+    }
 }
 
 //------------------------------------------------------------------------------
 
 PhysicsSystem::~PhysicsSystem()
 {
-    // Remove the rigidbodies from the dynamics world and delete them
-    for (int i = m_dynamicsWorld->getNumCollisionObjects() - 1; i >= 0; --i) {
-        btCollisionObject* obj = m_dynamicsWorld->getCollisionObjectArray()[i];
-        btRigidBody* body      = btRigidBody::upcast(obj);
-        if (body && body->getMotionState()) {
-            delete body->getMotionState();
-        }
-        m_dynamicsWorld->removeCollisionObject(obj);
-        delete obj;
+    // Worlds delete only bodies and constraints they hold
+    for (const Joint& joint : m_joints) {
+        if (joint.world) joint.world->removeConstraint(joint.constraint);
+        delete joint.constraint;
     }
 
-    delete m_dynamicsWorld;
-    delete m_solver;
-    delete m_overlappingPairCache;
-    delete m_dispatcher;
-    delete m_collisionConfiguration;
+    for (std::size_t i = 0; i < m_nodes.size(); ++i) {
+        if (m_regions[i] == Region::Frozen) delete m_nodes[i].body;
+    }
 }
 
 //------------------------------------------------------------------------------
 
 void PhysicsSystem::update(float elapsedTime)
 {
-    for (auto& n : m_nodes) {
-        if (glm::length(n.ph->force) > 0.f) {
-            n.body->activate();
-            auto force = glm::rotate(n.tr->rotation, n.ph->force);
-            n.body->applyCentralForce(btVector3{force.x, force.y, force.z});
+    m_accumulator += elapsedTime;
+
+    int steps = 0;
+    while (m_accumulator >= m_fixedTimeStep && steps < m_maxSubSteps) {
+        step();
+        m_accumulator -= m_fixedTimeStep;
+        ++steps;
+    }
+
+    // Cannot keep up, drop the rest instead of doing even more steps next frame
+    if (m_accumulator >= m_fixedTimeStep) {
+        LOG_TRACE("Physics dropped {:.3f} s", m_accumulator);
+        m_accumulator = std::fmod(m_accumulator, m_fixedTimeStep);
+    }
+
+    for (PhysicsQueryBatch* batch : m_queuedQueries)
+        query(*batch);
+    m_queuedQueries.clear();
+
+    interpolate(m_accumulator / m_fixedTimeStep);
+}
+
+//------------------------------------------------------------------------------
+
+void PhysicsSystem::setInput(int actorId, const glm::vec3& force, const glm::vec3& torque)
+{
+    const int i = nodeIndex(actorId);
+    if (i < 0) return;
+
+    PhysicsComponent& ph = *m_nodes[i].ph;
+    ph.force             = force;
+    ph.torque            = torque;
+    syncInput(i);
+}
+
+//------------------------------------------------------------------------------
+
+void PhysicsSystem::syncInput(int i)
+{
+    const PhysicsComponent& ph = *m_nodes[i].ph;
+    Input& input               = m_inputs[i];
+    if (ph.force == input.force && ph.torque == input.torque) return;
+
+    const bool wasDriven = !input.isZero();
+    input                = Input{ph.force, ph.torque};
+
+    if (input.isZero())
+        eraseValue(m_driven, i);
+    else if (!wasDriven)
+        m_driven.push_back(i);
+
+    m_nodes[i].body->activate();
+}
+
+//------------------------------------------------------------------------------
+
+void PhysicsSystem::updateRegions()
+{
+    if (m_activeRadius <= 0.0f || m_regionCenters.empty()) return;
+
+    // Region is kept up to a bit bigger radius, bodies on the edge do not flicker
+    const auto isWithin = [](float distance2, float radius, bool inside) {
+        if (inside) radius *= RegionHysteresis;
+        return distance2 <= radius * radius;
+    };
+
+    groupNodes();
+    const std::vector<int>& groups = m_groups;
+
+    // Nearest distance and best current region of each group, kept at its root
+    std::vector<float>& distances2 = m_groupDistances2;
+    std::vector<Region>& regions   = m_groupRegions;
+    distances2.assign(m_nodes.size(), std::numeric_limits<float>::max());
+    regions.assign(m_nodes.size(), Region::Frozen);
+    for (std::size_t i = 0; i < m_nodes.size(); ++i) {
+        if (m_nodes[i].body->isStaticObject()) continue;
+
+        const int g = groups[i];
+        for (const glm::vec3& center : m_regionCenters) {
+            const glm::vec3 d = m_current[i].translation - center;
+            distances2[g]     = std::min(distances2[g], glm::dot(d, d));
         }
-        if (glm::length(n.ph->torque) > 0.f) {
-            n.body->activate();
-            auto torque = glm::rotate(n.tr->rotation, n.ph->torque);
-            n.body->applyTorque(btVector3{torque.x, torque.y, torque.z});
+        regions[g] = std::min(regions[g], m_regions[i]);
+    }
+
+    bool moved = false;
+    for (std::size_t i = 0; i < m_nodes.size(); ++i) {
+        if (m_nodes[i].body->isStaticObject()) continue;
+
+        const int g           = groups[i];
+        const Region region   = regions[g];
+        const float distance2 = distances2[g];
+
+        Region target = Region::Frozen;
+        if (isWithin(distance2, m_activeRadius, region == Region::Active))
+            target = Region::Active;
+        else if (m_reducedWorld && isWithin(distance2, m_reducedRadius, region != Region::Frozen))
+            target = Region::Reduced;
+
+        if (target == Region::Frozen) m_nodes[i].frozenGroup = m_nodes[g].actorId;
+        if (target != m_regions[i]) {
+            moveNode(int(i), target);
+            moved = true;
         }
     }
-    m_dynamicsWorld->stepSimulation(elapsedTime);
+
+    if (moved) attachJoints();
+}
+
+//------------------------------------------------------------------------------
+
+void PhysicsSystem::groupNodes()
+{
+    std::vector<int>& roots = m_groups;
+    roots.resize(m_nodes.size());
+    std::iota(roots.begin(), roots.end(), 0);
+
+    const auto find = [&roots](int i) {
+        while (roots[i] != i)
+            i = roots[i] = roots[roots[i]];
+        return i;
+    };
+    const auto unite = [&](int a, int b) { roots[find(a)] = find(b); };
+
+    for (const Joint& joint : m_joints)
+        unite(joint.constraint->getRigidBodyA().getUserIndex(),
+              joint.constraint->getRigidBodyB().getUserIndex());
+
+    // Island tags are numbered per world, frozen bodies keep group they were frozen with
+    std::unordered_map<int64_t, int>& islands = m_islands;
+    islands.clear();
+    for (std::size_t i = 0; i < m_nodes.size(); ++i) {
+        const PhysicsNode& node = m_nodes[i];
+        if (node.body->isStaticObject()) continue;
+
+        const Region region = m_regions[i];
+        const int tag = region == Region::Frozen ? node.frozenGroup : node.body->getIslandTag();
+        if (tag < 0) continue;
+
+        const int64_t key = (int64_t(region) << 32) | uint32_t(tag);
+        const auto island = islands.emplace(key, int(i));
+        if (!island.second) unite(int(i), island.first->second);
+    }
+
+    for (std::size_t i = 0; i < roots.size(); ++i)
+        roots[i] = find(int(i));
+}
+
+//------------------------------------------------------------------------------
+
+void PhysicsSystem::moveNode(int i, Region region)
+{
+    // Interpolation stops at the last simulated pose
+    for (auto* moving : {&m_moving, &m_reducedMoving}) {
+        if (std::find(moving->begin(), moving->end(), i) == moving->end()) continue;
+
+        eraseValue(*moving, i);
+        m_previous[i] = m_current[i];
+        m_settled.push_back(i);
+    }
+
+    // State stays in the body, velocities and activation are kept while frozen
+    PhysicsNode& node = m_nodes[i];
+    if (auto world = worldOf(m_regions[i]))
+        world->removeRigidBody(node.body);
+    else
+        removeProxies(node);
+
+    if (auto world = worldOf(region))
+        world->addRigidBody(node.body, node.layer, node.mask);
+    else
+        addProxies(node);
+
+    m_regions[i] = region;
+}
+
+//------------------------------------------------------------------------------
+
+void PhysicsSystem::addProxies(PhysicsNode& node)
+{
+    node.proxy = staticCopy(*node.body);
+    m_dynamicsWorld->addRigidBody(node.proxy, node.layer, node.mask);
+
+    if (m_reducedWorld) {
+        node.twin = staticCopy(*node.body);
+        m_reducedDynamicsWorld->addRigidBody(node.twin, node.layer, node.mask);
+    }
 }
 
 //------------------------------------------------------------------------------
 
-void PhysicsSystem::addActor(int id, TransformationComponent* tr, PhysicsComponent* ph,
-                             const ResourcesMgr& resourcesMgr)
+void PhysicsSystem::removeProxies(PhysicsNode& node)
+{
+    if (node.proxy) {
+        m_dynamicsWorld->removeRigidBody(node.proxy);
+        delete node.proxy;
+        node.proxy = nullptr;
+    }
+
+    if (node.twin) {
+        m_reducedDynamicsWorld->removeRigidBody(node.twin);
+        delete node.twin;
+        node.twin = nullptr;
+    }
+}
+
+//------------------------------------------------------------------------------
+
+void PhysicsSystem::attachJoints()
+{
+    for (Joint& joint : m_joints) {
+        const int a = joint.constraint->getRigidBodyA().getUserIndex();
+        const int b = joint.constraint->getRigidBodyB().getUserIndex();
+
+        btDiscreteDynamicsWorld* world = nullptr;
+        if (m_regions[a] == m_regions[b]) world = worldOf(m_regions[a]);
+        if (world == joint.world) continue;
+
+        if (joint.world) joint.world->removeConstraint(joint.constraint);
+        if (world) world->addConstraint(joint.constraint, true);
+        joint.world = world;
+    }
+}
+
+//------------------------------------------------------------------------------
+
+btDiscreteDynamicsWorld* PhysicsSystem::worldOf(Region region) const
+{
+    switch (region) {
+    case Region::Active: return m_dynamicsWorld;
+    case Region::Reduced: return m_reducedDynamicsWorld;
+    case Region::Frozen: break;
+    }
+    return nullptr;
+}
+
+//------------------------------------------------------------------------------
+
+void PhysicsSystem::applyForces()
+{
+    // Bullet clears forces after each step, bodies out of active region would pile them up
+    for (int i : m_driven) {
+        if (m_regions[i] != Region::Active) continue;
+
+        btRigidBody* body    = m_nodes[i].body;
+        const Input& input   = m_inputs[i];
+        const glm::quat& rot = m_current[i].rotation;
+
+        body->activate();
+        const auto force  = glm::rotate(rot, input.force);
+        const auto torque = glm::rotate(rot, input.torque);
+        body->applyCentralForce(btVector3{force.x, force.y, force.z});
+        body->applyTorque(btVector3{torque.x, torque.y, torque.z});
+    }
+}
+
+//------------------------------------------------------------------------------
+
+void PhysicsSystem::step()
+{
+    // Both worlds are at the same time only when reduced step starts, bodies moved in between
+    // would get ahead
+    if (m_regionTicks > 0) --m_regionTicks;
+    if (m_regionTicks == 0 && m_reducedTicks == 0) {
+        updateRegions();
+        m_regionTicks = RegionUpdateTicks;
+    }
+
+    applyForces();
+
+    // Zero substeps makes Bullet do exactly one step of given length
+    m_dynamicsWorld->stepSimulation(m_fixedTimeStep, 0);
+    syncTransforms(m_dynamicsWorld, m_moving);
+
+    if (m_reducedWorld && ++m_reducedTicks == m_reducedRate) {
+        m_reducedDynamicsWorld->stepSimulation(m_fixedTimeStep * m_reducedRate, 0);
+        syncTransforms(m_reducedDynamicsWorld, m_reducedMoving);
+        m_reducedTicks = 0;
+    }
+}
+
+//------------------------------------------------------------------------------
+
+void PhysicsSystem::syncTransforms(btDiscreteDynamicsWorld* world, std::vector<int>& moving)
+{
+    const auto poseOf = [](const btRigidBody& body) {
+        const btTransform& worldTrans = body.getWorldTransform();
+        const btVector3& p            = worldTrans.getOrigin();
+        const btQuaternion o          = worldTrans.getRotation();
+        return Pose{{p.x(), p.y(), p.z()}, {o.w(), o.x(), o.y(), o.z()}};
+    };
+
+    // Bodies that fell asleep in this tick still moved in it, their final pose is kept
+    for (int i : moving) {
+        m_previous[i]           = m_current[i];
+        const btRigidBody& body = *m_nodes[i].body;
+        if (body.isActive()) continue;
+
+        m_current[i] = poseOf(body);
+        m_settled.push_back(i);
+    }
+    moving.clear();
+
+    // Static bodies are not on this list, sleeping ones are skipped
+    const auto& bodies = world->getNonStaticRigidBodies();
+    for (int b = 0; b < bodies.size(); ++b) {
+        const btRigidBody* body = bodies[b];
+        if (!body->isActive()) continue;
+
+        const int i  = body->getUserIndex();
+        m_current[i] = poseOf(*body);
+        moving.push_back(i);
+    }
+}
+
+//------------------------------------------------------------------------------
+
+void PhysicsSystem::interpolate(float alpha)
+{
+    for (int i : m_settled) {
+        m_nodes[i].tr->translation = m_current[i].translation;
+        m_nodes[i].tr->rotation    = m_current[i].rotation;
+    }
+    m_settled.clear();
+
+    const auto blend = [this](const std::vector<int>& moving, float alpha) {
+        for (int i : moving) {
+            const Pose& prev = m_previous[i];
+            const Pose& curr = m_current[i];
+
+            m_nodes[i].tr->translation = glm::mix(prev.translation, curr.translation, alpha);
+            m_nodes[i].tr->rotation    = glm::slerp(prev.rotation, curr.rotation, alpha);
+        }
+    };
+
+    blend(m_moving, alpha);
+    // Reduced region step is reducedRate ticks long
+    blend(m_reducedMoving, (m_reducedTicks + alpha) / m_reducedRate);
+}
+
+//------------------------------------------------------------------------------
+
+void PhysicsSystem::addActor(int id, TransformationComponent* tr, PhysicsComponent* ph)
 {
     btCollisionShape* colShape = nullptr;
 
-    auto key        = std::make_pair(ph->shape, tr->scale[0]);
-    auto colShapeIt = m_collisionShapes.find(key);
+    const auto& scale = tr->scale;
+    auto key          = std::make_tuple(ph->shape, scale.x, scale.y, scale.z);
+    auto colShapeIt   = m_collisionShapes.find(key);
     if (colShapeIt == std::end(m_collisionShapes)) {
-        auto colShapeUPtr = createCollisionShape(*ph, resourcesMgr);
-        colShapeUPtr->setLocalScaling({tr->scale[0], tr->scale[1], tr->scale[2]});
+        auto colShapeUPtr = createCollisionShape(*ph);
+        colShapeUPtr->setLocalScaling({scale.x, scale.y, scale.z});
         colShape               = colShapeUPtr.get();
         m_collisionShapes[key] = std::move(colShapeUPtr);
-        LOG_TRACE("Created CollisionShape: {} {}", key.first, key.second);
+        LOG_TRACE("Created CollisionShape: {} {} {} {}", ph->shape, scale.x, scale.y, scale.z);
     } else {
         colShape = colShapeIt->second.get();
     }
@@ -118,35 +622,405 @@ void PhysicsSystem::addActor(int id, TransformationComponent* tr, PhysicsCompone
     // Rigidbody is dynamic if and only if mass is non zero, otherwise static
     bool isDynamic = (mass != 0.f);
 
+    int layer = ph->layer;
+    if (layer == 0) layer = isDynamic ? PhysicsComponent::Default : PhysicsComponent::Static;
+    if ((layer & (layer - 1)) != 0 || (layer & ~PhysicsComponent::AllLayers) != 0)
+        throw std::runtime_error{"PhysicsComponent must be in a single layer"};
+
     btVector3 localInertia(0, 0, 0);
     if (isDynamic) colShape->calculateLocalInertia(mass, localInertia);
 
-    btRigidBody::btRigidBodyConstructionInfo rbInfo(mass, new MotionState{tr}, colShape,
-                                                    localInertia);
+    // No motion state, transformation is written back by interpolate()
+    btRigidBody::btRigidBodyConstructionInfo rbInfo(mass, nullptr, colShape, localInertia);
+    rbInfo.m_startWorldTransform = toBtTransform(*tr);
 
     PhysicsNode node;
     node.actorId = id;
     node.tr      = tr;
     node.ph      = ph;
     node.body    = new btRigidBody(rbInfo);
+    node.body->setUserIndex(static_cast<int>(m_nodes.size()));
+    node.body->setUserIndex2(id);
+    node.layer = layer;
+    node.mask  = ph->mask ? ph->mask : defaultMask(layer);
+    if (layer == PhysicsComponent::Trigger)
+        node.body->setCollisionFlags(node.body->getCollisionFlags() |
+                                     btCollisionObject::CF_NO_CONTACT_RESPONSE);
+
+    // Static bodies are in both worlds, bodies of reduced region collide with them too
+    if (m_reducedWorld && !isDynamic) {
+        node.twin = staticCopy(*node.body);
+        m_reducedDynamicsWorld->addRigidBody(node.twin, node.layer, node.mask);
+    }
 
-    m_dynamicsWorld->addRigidBody(node.body);
+    m_dynamicsWorld->addRigidBody(node.body, node.layer, node.mask);
     m_nodes.push_back(node);
+    m_previous.push_back(Pose{tr->translation, tr->rotation});
+    m_current.push_back(m_previous.back());
+    m_inputs.emplace_back();
+    m_regions.push_back(Region::Active);
+    m_nodeIndices[id] = node.body->getUserIndex();
+    syncInput(node.body->getUserIndex());
 }
 
 //------------------------------------------------------------------------------
 
 void PhysicsSystem::removeActor(int id)
 {
-    auto nodeIt = std::find_if(m_nodes.begin(), m_nodes.end(),
-                               [id](const PhysicsNode& n) { return n.actorId == id; });
-    if (nodeIt != std::end(m_nodes)) {
-        auto& node = *nodeIt;
-        delete node.body->getMotionState();
-        m_dynamicsWorld->removeRigidBody(node.body);
-        delete node.body;
-        m_nodes.erase(nodeIt);
+    const int i = nodeIndex(id);
+    if (i < 0) return;
+
+    const int last    = static_cast<int>(m_nodes.size()) - 1;
+    btRigidBody* body = m_nodes[i].body;
+
+    auto jointIt = m_joints.begin();
+    while (jointIt != m_joints.end()) {
+        btTypedConstraint* joint = jointIt->constraint;
+        if (&joint->getRigidBodyA() == body || &joint->getRigidBodyB() == body) {
+            if (jointIt->world) jointIt->world->removeConstraint(joint);
+            delete joint;
+            jointIt = m_joints.erase(jointIt);
+        } else {
+            ++jointIt;
+        }
     }
+
+    if (auto world = worldOf(m_regions[i])) world->removeRigidBody(body);
+    delete body;
+    // Twin of static body or copies of frozen one
+    removeProxies(m_nodes[i]);
+
+    for (auto* indices : {&m_moving, &m_reducedMoving, &m_settled, &m_driven}) {
+        eraseValue(*indices, i);
+        std::replace(indices->begin(), indices->end(), last, i);
+    }
+
+    // Last node takes place of the removed one
+    if (i != last) {
+        m_nodes[i]    = m_nodes[last];
+        m_previous[i] = m_previous[last];
+        m_current[i]  = m_current[last];
+        m_inputs[i]   = m_inputs[last];
+        m_regions[i]  = m_regions[last];
+        m_nodes[i].body->setUserIndex(i);
+        if (m_nodes[i].twin) m_nodes[i].twin->setUserIndex(i);
+        if (m_nodes[i].proxy) m_nodes[i].proxy->setUserIndex(i);
+        m_nodeIndices[m_nodes[i].actorId] = i;
+    }
+
+    m_nodes.pop_back();
+    m_previous.pop_back();
+    m_current.pop_back();
+    m_inputs.pop_back();
+    m_regions.pop_back();
+    m_nodeIndices.erase(id);
+}
+
+//------------------------------------------------------------------------------
+
+void PhysicsSystem::addBallJoint(int actorA, int actorB, const glm::vec3& pivot)
+{
+    const int a = nodeIndex(actorA);
+    const int b = nodeIndex(actorB);
+    if (a < 0 || b < 0) throw std::runtime_error{"Joint of actor without PhysicsComponent"};
+
+    btRigidBody* bodyA = m_nodes[a].body;
+    btRigidBody* bodyB = m_nodes[b].body;
+
+    const btVector3 worldPivot = toBtVector3(pivot);
+    const btVector3 pivotInA   = bodyA->getWorldTransform().inverse() * worldPivot;
+    const btVector3 pivotInB   = bodyB->getWorldTransform().inverse() * worldPivot;
+
+    // Added to a world by attachJoints(), deleted by removeActor() or destructor
+    auto joint = new btPoint2PointConstraint{*bodyA, *bodyB, pivotInA, pivotInB};
+    m_joints.push_back(Joint{joint, nullptr});
+    attachJoints();
+}
+
+//------------------------------------------------------------------------------
+
+std::vector<uint8_t> PhysicsSystem::saveState() const
+{
+    StateHeader header{};
+    header.magic        = StateMagic;
+    header.joints       = static_cast<uint32_t>(m_joints.size());
+    header.reducedTicks = static_cast<uint32_t>(m_reducedTicks);
+    header.regionTicks  = static_cast<uint32_t>(m_regionTicks);
+    header.accumulator  = m_accumulator;
+    for (const PhysicsNode& node : m_nodes)
+        if (!node.body->isStaticObject()) ++header.bodies;
+
+    std::vector<uint8_t> state;
+    state.reserve(sizeof(header) + header.bodies * sizeof(BodyState) +
+                  header.joints * sizeof(JointState));
+    write(state, header);
+
+    for (std::size_t i = 0; i < m_nodes.size(); ++i) {
+        const PhysicsNode& node = m_nodes[i];
+        const btRigidBody* body = node.body;
+        if (body->isStaticObject()) continue;
+
+        const btTransform& trans = body->getWorldTransform();
+        const btQuaternion rot   = trans.getRotation();
+
+        BodyState bodyState;
+        bodyState.actorId          = node.actorId;
+        bodyState.region           = static_cast<int32_t>(m_regions[i]);
+        bodyState.frozenGroup      = node.frozenGroup;
+        bodyState.activationState  = body->getActivationState();
+        bodyState.deactivationTime = body->getDeactivationTime();
+        toFloats(trans.getOrigin(), bodyState.origin);
+        bodyState.rotation[0] = rot.x();
+        bodyState.rotation[1] = rot.y();
+        bodyState.rotation[2] = rot.z();
+        bodyState.rotation[3] = rot.w();
+        toFloats(body->getLinearVelocity(), bodyState.linearVelocity);
+        toFloats(body->getAngularVelocity(), bodyState.angularVelocity);
+        write(state, bodyState);
+    }
+
+    for (const Joint& joint : m_joints) {
+        const btTypedConstraint* constraint = joint.constraint;
+        write(state, JointState{constraint->getAppliedImpulse(), constraint->isEnabled()});
+    }
+
+    return state;
+}
+
+//------------------------------------------------------------------------------
+
+void PhysicsSystem::restoreState(const std::vector<uint8_t>& state)
+{
+    const uint8_t* in        = state.data();
+    const uint8_t* const end = state.data() + state.size();
+
+    const auto header = read<StateHeader>(in, end);
+    if (header.magic != StateMagic) throw std::runtime_error{"Not a physics state"};
+    if (header.joints != m_joints.size())
+        throw std::runtime_error{"Physics state joints do not match"};
+    if (header.bodies > m_nodes.size())
+        throw std::runtime_error{"Physics state actors do not match"};
+    if (header.reducedTicks >= static_cast<uint32_t>(m_reducedRate))
+        throw std::runtime_error{"Physics state reduced region cycle does not match"};
+    if (header.regionTicks > static_cast<uint32_t>(RegionUpdateTicks))
+        throw std::runtime_error{"Physics state region cycle does not match"};
+
+    // Everything is checked before the state is applied
+    std::vector<BodyState> bodyStates(header.bodies);
+    for (BodyState& bodyState : bodyStates)
+        bodyState = read<BodyState>(in, end);
+
+    std::vector<JointState> jointStates(header.joints);
+    for (JointState& jointState : jointStates)
+        jointState = read<JointState>(in, end);
+    if (in != end) throw std::runtime_error{"Physics state has trailing data"};
+
+    std::size_t b = 0;
+    for (const PhysicsNode& node : m_nodes) {
+        if (node.body->isStaticObject()) continue;
+        if (b == bodyStates.size() || bodyStates[b++].actorId != node.actorId)
+            throw std::runtime_error{"Physics state actors do not match"};
+
+        const int32_t region = bodyStates[b - 1].region;
+        if (region < int32_t(Region::Active) || region > int32_t(Region::Frozen) ||
+            (region == int32_t(Region::Reduced) && !m_reducedWorld))
+            throw std::runtime_error{"Physics state regions do not match"};
+    }
+    if (b != bodyStates.size()) throw std::runtime_error{"Physics state actors do not match"};
+
+    b = 0;
+    for (std::size_t i = 0; i < m_nodes.size(); ++i) {
+        btRigidBody* body = m_nodes[i].body;
+        if (body->isStaticObject()) continue;
+
+        const BodyState& bodyState = bodyStates[b++];
+        const auto& r              = bodyState.rotation;
+        const btTransform trans{btQuaternion{r[0], r[1], r[2], r[3]},
+                                fromFloats(bodyState.origin)};
+        const btVector3 linearVelocity  = fromFloats(bodyState.linearVelocity);
+        const btVector3 angularVelocity = fromFloats(bodyState.angularVelocity);
+
+        body->setWorldTransform(trans);
+        body->setInterpolationWorldTransform(trans);
+        body->setLinearVelocity(linearVelocity);
+        body->setInterpolationLinearVelocity(linearVelocity);
+        body->setAngularVelocity(angularVelocity);
+        body->setInterpolationAngularVelocity(angularVelocity);
+        body->clearForces();
+        body->forceActivationState(bodyState.activationState);
+        body->setDeactivationTime(bodyState.deactivationTime);
+        m_nodes[i].frozenGroup = bodyState.frozenGroup;
+
+        // Body goes back to region it was saved in, with no contacts and proxies at restored pose
+        const auto region = static_cast<Region>(bodyState.region);
+        if (region != m_regions[i]) {
+            moveNode(int(i), region);
+        } else if (auto world = worldOf(region)) {
+            world->updateSingleAabb(body);
+            world->getBroadphase()->getOverlappingPairCache()->cleanProxyFromPairs(
+                body->getBroadphaseHandle(), world->getDispatcher());
+        } else {
+            removeProxies(m_nodes[i]);
+            addProxies(m_nodes[i]);
+        }
+
+        const Pose pose{toVec3(trans.getOrigin()), glm::quat{r[3], r[0], r[1], r[2]}};
+        m_previous[i]              = pose;
+        m_current[i]               = pose;
+        m_nodes[i].tr->translation = pose.translation;
+        m_nodes[i].tr->rotation    = pose.rotation;
+    }
+
+    attachJoints();
+    for (std::size_t i = 0; i < m_joints.size(); ++i) {
+        btTypedConstraint* joint = m_joints[i].constraint;
+        joint->internalSetAppliedImpulse(jointStates[i].appliedImpulse);
+        joint->setEnabled(jointStates[i].enabled != 0);
+    }
+
+    // Components are written above, next tick starts from the restored poses
+    m_moving.clear();
+    m_reducedMoving.clear();
+    m_settled.clear();
+    m_reducedTicks = static_cast<int>(header.reducedTicks);
+    m_regionTicks  = static_cast<int>(header.regionTicks);
+    m_accumulator  = header.accumulator;
+}
+
+//------------------------------------------------------------------------------
+
+int PhysicsSystem::nodeIndex(int actorId) const
+{
+    auto it = m_nodeIndices.find(actorId);
+    return it != std::end(m_nodeIndices) ? it->second : -1;
+}
+
+//------------------------------------------------------------------------------
+
+void PhysicsSystem::query(PhysicsQueryBatch& batch)
+{
+    batch.rayHits.resize(batch.rays.size());
+    forEachQuery(batch, batch.rays.size(),
+                 [&](std::size_t begin, std::size_t end) { rayTests(batch, begin, end); });
+
+    batch.sweepHits.resize(batch.sweeps.size());
+    forEachQuery(batch, batch.sweeps.size(),
+                 [&](std::size_t begin, std::size_t end) { sweepTests(batch, begin, end); });
+
+    overlapTests(batch);
+}
+
+//------------------------------------------------------------------------------
+
+void PhysicsSystem::queueQuery(PhysicsQueryBatch* batch) { m_queuedQueries.push_back(batch); }
+
+//------------------------------------------------------------------------------
+
+void PhysicsSystem::rayTests(PhysicsQueryBatch& batch, std::size_t begin, std::size_t end) const
+{
+    for (std::size_t i = begin; i < end; ++i) {
+        const auto& ray = batch.rays[i];
+        const btVector3 from{toBtVector3(ray.from)};
+        const btVector3 to{toBtVector3(ray.to)};
+
+        RayCallback callback{from, to, ray.ignoredActor, ray.layers};
+        m_dynamicsWorld->rayTest(from, to, callback);
+
+        auto& hit = batch.rayHits[i];
+        if (callback.hasHit()) {
+            hit.actorId  = actorOf(callback.m_collisionObject);
+            hit.fraction = callback.m_closestHitFraction;
+            hit.point    = toVec3(callback.m_hitPointWorld);
+            hit.normal   = toVec3(callback.m_hitNormalWorld);
+        } else {
+            hit = PhysicsQueryBatch::Hit{};
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+
+void PhysicsSystem::sweepTests(PhysicsQueryBatch& batch, std::size_t begin, std::size_t end) const
+{
+    for (std::size_t i = begin; i < end; ++i) {
+        const auto& sweep = batch.sweeps[i];
+        const btVector3 from{toBtVector3(sweep.from)};
+        const btVector3 to{toBtVector3(sweep.to)};
+
+        btTransform fromTrans, toTrans;
+        fromTrans.setIdentity();
+        fromTrans.setOrigin(from);
+        toTrans.setIdentity();
+        toTrans.setOrigin(to);
+
+        const btSphereShape sphere{sweep.radius};
+        SweepCallback callback{from, to, sweep.ignoredActor, sweep.layers};
+        m_dynamicsWorld->convexSweepTest(&sphere, fromTrans, toTrans, callback);
+
+        auto& hit = batch.sweepHits[i];
+        if (callback.hasHit()) {
+            hit.actorId  = actorOf(callback.m_hitCollisionObject);
+            hit.fraction = callback.m_closestHitFraction;
+            hit.point    = toVec3(callback.m_hitPointWorld);
+            hit.normal   = toVec3(callback.m_hitNormalWorld);
+        } else {
+            hit = PhysicsQueryBatch::Hit{};
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+
+void PhysicsSystem::overlapTests(PhysicsQueryBatch& batch)
+{
+    const std::size_t count = batch.overlaps.size();
+    batch.overlapActors.clear();
+    batch.overlapOffsets.assign(count + 1, 0);
+
+    // Ranges are collected separately and joined in query order
+    std::vector<std::pair<std::size_t, std::vector<int>>> ranges;
+    std::mutex rangesMutex;
+
+    forEachQuery(batch, count, [&](std::size_t begin, std::size_t end) {
+        std::vector<int> actors;
+        for (std::size_t i = begin; i < end; ++i) {
+            const auto& overlap = batch.overlaps[i];
+
+            btSphereShape sphere{overlap.radius};
+            btCollisionObject obj;
+            obj.setCollisionShape(&sphere);
+            obj.getWorldTransform().setIdentity();
+            obj.getWorldTransform().setOrigin(toBtVector3(overlap.center));
+
+            const std::size_t first = actors.size();
+            OverlapCallback callback{&obj, actors, overlap.layers};
+            m_dynamicsWorld->contactTest(&obj, callback);
+            batch.overlapOffsets[i + 1] = static_cast<int>(actors.size() - first);
+        }
+
+        std::lock_guard<std::mutex> lock{rangesMutex};
+        ranges.emplace_back(begin, std::move(actors));
+    });
+
+    std::sort(ranges.begin(), ranges.end(),
+              [](const auto& a, const auto& b) { return a.first < b.first; });
+    for (const auto& range : ranges)
+        batch.overlapActors.insert(batch.overlapActors.end(), range.second.begin(),
+                                   range.second.end());
+
+    for (std::size_t i = 0; i < count; ++i)
+        batch.overlapOffsets[i + 1] += batch.overlapOffsets[i];
+}
+
+//------------------------------------------------------------------------------
+
+void PhysicsSystem::forEachQuery(const PhysicsQueryBatch& batch, std::size_t count,
+                                 const std::function<void(std::size_t, std::size_t)>& func) const
+{
+    if (batch.parallel && m_world.threads() > 1)
+        ThreadPool::global().parallelFor(count, QueryGrain, func);
+    else if (count > 0)
+        func(0, count);
 }
 
 //------------------------------------------------------------------------------
@@ -163,8 +1037,7 @@ void PhysicsSystem::drawDebugData() { m_dynamicsWorld->debugDrawWorld(); }
 
 //------------------------------------------------------------------------------
 
-std::unique_ptr<btCollisionShape>
-PhysicsSystem::createCollisionShape(const PhysicsComponent& ph, const ResourcesMgr& resourcesMgr)
+std::unique_ptr<btCollisionShape> PhysicsSystem::createCollisionShape(const PhysicsComponent& ph)
 {
     const std::string shape = ph.shape;
 
@@ -174,21 +1047,26 @@ PhysicsSystem::createCollisionShape(const PhysicsComponent& ph, const ResourcesM
         if (splitted.size() < 2) throw std::runtime_error{"Invalid shape format: " + shape};
 
         if (splitted[0] == "heightfield") {
-            const auto& heightfield = resourcesMgr.getHeightfield(splitted[1]);
-            auto colShape           = std::make_unique<btHeightfieldTerrainShape>(
+            auto& heightfield = m_heightfields[splitted[1]];
+            if (!heightfield && m_heightfieldSource) heightfield = m_heightfieldSource(splitted[1]);
+            if (!heightfield) throw std::runtime_error{"Unknown heightfield: " + splitted[1]};
+
+            auto colShape = std::make_unique<btHeightfieldTerrainShape>(
                 heightfield->w, heightfield->h, heightfield->heights.data(), 1.0f,
                 -heightfield->amplitude, heightfield->amplitude, 1, PHY_FLOAT, false);
             return colShape;
 
         } else if (splitted[0] == "mesh") {
-            auto colShape = std::make_unique<btConvexHullShape>();
+            return m_shapeCooker.convexHull(splitted[1]);
 
-            const auto& positions = resourcesMgr.getMesh(splitted[1])->positions();
-            for (const auto p : positions) {
-                colShape->addPoint(btVector3{p.x, p.y, p.z}, false);
-            }
-            colShape->recalcLocalAabb();
-            return colShape;
+        } else if (splitted[0] == "trimesh") {
+            if (ph.mass != 0.0f)
+                throw std::runtime_error{"Triangle mesh shape must be static: " + shape};
+
+            auto& mesh = m_triangleMeshes[splitted[1]];
+            if (!mesh) mesh = m_shapeCooker.triangleMesh(splitted[1]);
+            // Scaling set by addActor() goes to the wrapper, not to the shared BVH
+            return std::make_unique<btScaledBvhTriangleMeshShape>(mesh.get(), btVector3{1, 1, 1});
 
         } else if (splitted[0] == "capsule") {
             auto colShape =
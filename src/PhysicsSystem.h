@@ -2,59 +2,224 @@
 #define PHYSICSSYSTEM_H
 
 #include "Components.h"
-#include "ResourcesMgr.h"
+#include "Heightfield.h"
+#include "PhysicsQuery.h"
+#include "PhysicsWorld.h"
+#include "ShapeCooker.h"
 
 #include <LinearMath/btAlignedObjectArray.h>
 
 #include <boost/noncopyable.hpp>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <map>
 #include <memory>
+#include <tuple>
+#include <unordered_map>
 
-class btCollisionConfiguration;
-class btDispatcher;
-class btBroadphaseInterface;
-class btSequentialImpulseConstraintSolver;
-class btDynamicsWorld;
+class btBvhTriangleMeshShape;
+class btDiscreteDynamicsWorld;
+class btTypedConstraint;
 class btCollisionShape;
 class btIDebugDraw;
 class btRigidBody;
 
+/**
+ * @brief Rigid body simulation stepped with fixed time step.
+ *
+ * Frame time is consumed in fixed ticks, at most maxSubSteps per update, the rest is dropped so
+ * slow frames do not pile up more work. Transformations seen by the renderer are interpolated
+ * between the last two simulated states.
+ */
 class PhysicsSystem final : private boost::noncopyable
 {
+    struct Pose
+    {
+        glm::vec3 translation{};
+        glm::quat rotation{1.f, 0.f, 0.f, 0.f};
+    };
+
+    struct Input
+    {
+        glm::vec3 force{};
+        glm::vec3 torque{};
+
+        bool isZero() const { return force == glm::vec3{} && torque == glm::vec3{}; }
+    };
+
     struct PhysicsNode
     {
         int actorId;
         TransformationComponent* tr;
         PhysicsComponent* ph;
-        btRigidBody* body;
+        btRigidBody* body;            //< User index is position in m_nodes, user index 2 is actorId
+        btRigidBody* twin  = nullptr; //< Static copy in reduced world of static or frozen body
+        btRigidBody* proxy = nullptr; //< Static copy in active world of frozen body
+        int layer;                    //< Collision group, kept for adding body back to a world
+        int mask;
+        int frozenGroup = -1; //< Actor id shared by group frozen together
+    };
+
+    enum class Region : uint8_t { Active, Reduced, Frozen };
+
+    struct Joint
+    {
+        btTypedConstraint* constraint;
+        btDiscreteDynamicsWorld* world; //< nullptr if bodies are in different regions
     };
 
   public:
+    using HeightfieldSource = std::function<std::shared_ptr<const Heightfield>(const std::string&)>;
+
+    struct Options
+    {
+        float fixedTimeStep = 1.0f / 60.0f; //< Length of one tick
+        int maxSubSteps     = 4;            //< Ticks per update, the rest of time is dropped
+        PhysicsWorld::Config world;         //< Threads, broadphase and solver settings
+        std::filesystem::path dataFolder;   //< Root of model files, mesh: and trimesh: shapes
+        std::filesystem::path cacheFolder;  //< Cooked shapes, empty disables caching
+        int maxHullVertices = 32;           //< Vertex limit of mesh: convex hulls
+        HeightfieldSource heightfields;     //< Data of heightfield: shapes by name
+        float activeRadius  = 0.0f;         //< Full rate region around centers, 0 disables regions
+        float reducedRadius = 0.0f;         //< Reduced rate region, <= activeRadius disables it
+        int reducedRate     = 4;            //< Ticks per reduced region step
+    };
+
     PhysicsSystem();
+    explicit PhysicsSystem(const Options& options);
     ~PhysicsSystem();
 
+    /// Runs ticks due and writes poses of bodies that moved to their TransformationComponent
     void update(float elapsedTime);
 
-    void addActor(int id, TransformationComponent* tr, PhysicsComponent* ph,
-                  const ResourcesMgr& resourcesMgr);
+    float fixedTimeStep() const { return m_fixedTimeStep; }
+
+    /// PhysicsComponent layer and mask are collision group and mask of body, so e.g. debris
+    /// pieces never reach narrowphase with each other. Triggers have no contact response.
+    void addActor(int id, TransformationComponent* tr, PhysicsComponent* ph);
+    /// Removes joints of the actor too
     void removeActor(int id);
 
+    /// Force and torque in body space applied every tick. PhysicsComponent input is read when
+    /// actor is added, later changes have to go through here.
+    void setInput(int actorId, const glm::vec3& force, const glm::vec3& torque);
+
+    /// Joins actors at pivot given in world space, joined bodies do not collide with each other
+    void addBallJoint(int actorA, int actorB, const glm::vec3& pivot);
+
+    /**
+     * @brief Simulation regions are placed around centers in the next update().
+     *
+     * With activeRadius set, only bodies near centers (cameras, controlled actors) are simulated
+     * every tick. Bodies up to reducedRadius go to a second world stepped every reducedRate ticks,
+     * farther ones are frozen and static copies stand in for them. Joined or touching bodies move
+     * together, regions are updated every few ticks when a reduced step starts.
+     */
+    void setRegionCenters(std::vector<glm::vec3> centers) { m_regionCenters = std::move(centers); }
+
+    /**
+     * @brief Dynamic state of bodies and joints in compact binary form.
+     *
+     * Covers transformations, velocities, activation states, regions, joint impulses, time not
+     * yet simulated and region update ticks. State can be restored while actors and joints are
+     * the same as when saving.
+     */
+    std::vector<uint8_t> saveState() const;
+    /// Writes state back to existing bodies, moves them to saved regions and drops their contacts.
+    /// Throws std::runtime_error if state does not match actors.
+    void restoreState(const std::vector<uint8_t>& state);
+
+    const PhysicsWorld& world() const { return m_world; }
+
+    /// Runs batch against state after the last tick, frozen bodies included. Batch is split
+    /// across worker threads for multithreaded world only.
+    void query(PhysicsQueryBatch& batch);
+    /// Batch runs right after the ticks of the next update(), it must live until then
+    void queueQuery(PhysicsQueryBatch* batch);
+
     void setDebugDrawer(btIDebugDraw* debugDrawer);
     void drawDebugData();
 
   private:
-    std::unique_ptr<btCollisionShape> createCollisionShape(const PhysicsComponent& ph,
-                                                           const ResourcesMgr& resourcesMgr);
+    /// Picks up force and torque of PhysicsComponent of node
+    void syncInput(int i);
+    void updateRegions();
+    /// Fills m_groups, joined or touching bodies are in one group
+    void groupNodes();
+    void moveNode(int i, Region region);
+    void addProxies(PhysicsNode& node);
+    void removeProxies(PhysicsNode& node);
+    void attachJoints();
+    void applyForces();
+    void step();
+    void syncTransforms(btDiscreteDynamicsWorld* world, std::vector<int>& moving);
+    void interpolate(float alpha);
+
+    /// nullptr for frozen bodies
+    btDiscreteDynamicsWorld* worldOf(Region region) const;
+
+    void rayTests(PhysicsQueryBatch& batch, std::size_t begin, std::size_t end) const;
+    void sweepTests(PhysicsQueryBatch& batch, std::size_t begin, std::size_t end) const;
+    void overlapTests(PhysicsQueryBatch& batch);
+    /// Calls func(begin, end) on worker threads if batch and world allow it
+    void forEachQuery(const PhysicsQueryBatch& batch, std::size_t count,
+                      const std::function<void(std::size_t, std::size_t)>& func) const;
+
+    /// -1 if actor has no body
+    int nodeIndex(int actorId) const;
 
-    btCollisionConfiguration* m_collisionConfiguration;
-    btDispatcher* m_dispatcher;
-    btBroadphaseInterface* m_overlappingPairCache;
-    btSequentialImpulseConstraintSolver* m_solver;
-    btDynamicsWorld* m_dynamicsWorld;
+    std::unique_ptr<btCollisionShape> createCollisionShape(const PhysicsComponent& ph);
 
-    using ShapesKey = std::pair<std::string, float>;
+    HeightfieldSource m_heightfieldSource;
+    /// Bullet does not copy heights
+    std::map<std::string, std::shared_ptr<const Heightfield>> m_heightfields;
+    ShapeCooker m_shapeCooker;
+    /// Unscaled trimesh: shapes, m_collisionShapes wrap them with scale so BVH is built once
+    std::map<std::string, std::unique_ptr<btBvhTriangleMeshShape>> m_triangleMeshes;
+
+    using ShapesKey = std::tuple<std::string, float, float, float>; //< Shape and scale
     std::map<ShapesKey, std::unique_ptr<btCollisionShape>> m_collisionShapes;
 
+    // Declared after shapes, bodies are deleted before shapes they use
+    PhysicsWorld m_world;
+    btDiscreteDynamicsWorld* m_dynamicsWorld; //< Owned by m_world
+    std::unique_ptr<PhysicsWorld> m_reducedWorld;
+    btDiscreteDynamicsWorld* m_reducedDynamicsWorld = nullptr; //< Owned by m_reducedWorld
+
     std::vector<PhysicsNode> m_nodes;
+    std::unordered_map<int, int> m_nodeIndices; //< Position in m_nodes by actor id
+    // Indexed like m_nodes
+    std::vector<Pose> m_previous;  //< State before the last tick
+    std::vector<Pose> m_current;   //< State after the last tick
+    std::vector<Input> m_inputs;   //< PhysicsComponent input seen by syncInput()
+    std::vector<Region> m_regions; //< Always Active for static bodies
+
+    std::vector<int> m_moving;        //< Nodes moved by the last tick
+    std::vector<int> m_reducedMoving; //< Nodes moved by the last reduced region step
+    std::vector<int> m_settled;       //< Nodes that stopped, written once more by interpolate()
+    std::vector<int> m_driven;        //< Nodes with non zero input
+
+    std::vector<Joint> m_joints; //< Owned here, worlds hold attached ones
+
+    std::vector<glm::vec3> m_regionCenters;
+    const float m_activeRadius;
+    const float m_reducedRadius;
+    const int m_reducedRate;
+    int m_reducedTicks = 0; //< Ticks since the last reduced region step
+    int m_regionTicks  = 0; //< Ticks until regions can be updated
+
+    // Reused by updateRegions(), indexed like m_nodes
+    std::vector<int> m_groups; //< Root node of group of each node
+    std::vector<float> m_groupDistances2;
+    std::vector<Region> m_groupRegions;
+    std::unordered_map<int64_t, int> m_islands; //< First node of each island
+
+    std::vector<PhysicsQueryBatch*> m_queuedQueries;
+
+    const float m_fixedTimeStep;
+    const int m_maxSubSteps;
+    float m_accumulator = 0.0f;
 };
 
 #endif // PHYSICSSYSTEM_H
@@ -0,0 +1,285 @@
+#include "PhysicsWorld.h"
+
+#include "Logger.h"
+#include "ThreadPool.h"
+
+#include <btBulletDynamicsCommon.h>
+#if BT_THREADSAFE
+#include <BulletCollision/CollisionDispatch/btCollisionDispatcherMt.h>
+#include <BulletDynamics/Dynamics/btDiscreteDynamicsWorldMt.h>
+#include <LinearMath/btThreads.h>
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+
+namespace {
+
+/// btDiscreteDynamicsWorld or btDiscreteDynamicsWorldMt measuring parts of each step
+template <typename World>
+class ProfiledWorld final : public World
+{
+    using Clock = std::chrono::steady_clock;
+
+  public:
+    template <typename... Args>
+    explicit ProfiledWorld(PhysicsWorld::Stats& stats, Args&&... args)
+        : World{std::forward<Args>(args)...}
+        , m_stats{stats}
+    {
+    }
+
+    void performDiscreteCollisionDetection() override
+    {
+        const auto start = Clock::now();
+        World::performDiscreteCollisionDetection();
+        m_stats.collisionTime += std::chrono::duration<double>(Clock::now() - start).count();
+    }
+
+  protected:
+    void solveConstraints(btContactSolverInfo& solverInfo) override
+    {
+        const auto start = Clock::now();
+        World::solveConstraints(solverInfo);
+        m_stats.solverTime += std::chrono::duration<double>(Clock::now() - start).count();
+    }
+
+  private:
+    PhysicsWorld::Stats& m_stats;
+};
+
+//------------------------------------------------------------------------------
+
+/// Group and mask test of Bullet default filter counting rejected pairs. Broadphase adds pairs on
+/// one thread also in multithreaded world.
+class CountingFilter final : public btOverlapFilterCallback
+{
+  public:
+    explicit CountingFilter(PhysicsWorld::Stats& stats)
+        : m_stats{stats}
+    {
+    }
+
+    bool needBroadphaseCollision(btBroadphaseProxy* proxy0,
+                                 btBroadphaseProxy* proxy1) const override
+    {
+        const bool collides = (proxy0->m_collisionFilterGroup & proxy1->m_collisionFilterMask) &&
+                              (proxy1->m_collisionFilterGroup & proxy0->m_collisionFilterMask);
+        if (!collides) ++m_stats.filteredPairs;
+        return collides;
+    }
+
+  private:
+    PhysicsWorld::Stats& m_stats;
+};
+
+//------------------------------------------------------------------------------
+
+btBroadphaseInterface* createBroadphase(const PhysicsWorld::Config& config)
+{
+    switch (config.broadphase) {
+    case PhysicsWorld::Broadphase::AxisSweep: {
+        const btVector3 halfExtent{config.worldHalfExtent, config.worldHalfExtent,
+                                   config.worldHalfExtent};
+        return new bt32BitAxisSweep3(-halfExtent, halfExtent);
+    }
+    case PhysicsWorld::Broadphase::Dbvt: break;
+    }
+    return new btDbvtBroadphase();
+}
+
+//------------------------------------------------------------------------------
+
+#if BT_THREADSAFE
+
+/// Runs Bullet parallel loops on engine worker threads instead of OpenMP or TBB ones
+class PoolTaskScheduler final : public btITaskScheduler
+{
+  public:
+    explicit PoolTaskScheduler(ThreadPool& pool)
+        : btITaskScheduler{"ThreadPool"}
+        , m_pool{pool}
+        , m_chunks{getMaxNumThreads()}
+    {
+    }
+
+    int getMaxNumThreads() const override
+    {
+        return std::min(static_cast<int>(m_pool.threadCount()) + 1, int(BT_MAX_THREAD_COUNT));
+    }
+
+    /// Any pool thread can run a range and Bullet indexes per thread data with
+    /// btGetCurrentThreadIndex(), so the count always covers the whole pool
+    int getNumThreads() const override { return getMaxNumThreads(); }
+
+    /// Limits ranges per loop only, see getNumThreads()
+    void setNumThreads(int numThreads) override
+    {
+        m_chunks = std::clamp(numThreads, 1, getMaxNumThreads());
+    }
+
+    int chunks() const { return m_chunks; }
+
+    void parallelFor(int iBegin, int iEnd, int grainSize, const btIParallelForBody& body) override
+    {
+        if (iEnd <= iBegin) return;
+
+        m_pool.parallelFor(iEnd - iBegin, grain(iEnd - iBegin, grainSize),
+                           [&](std::size_t begin, std::size_t end) {
+                               body.forLoop(iBegin + int(begin), iBegin + int(end));
+                           });
+    }
+
+#if BT_BULLET_VERSION >= 288
+    btScalar parallelSum(int iBegin, int iEnd, int grainSize,
+                         const btIParallelSumBody& body) override
+    {
+        if (iEnd <= iBegin) return btScalar(0);
+
+        btScalar sum = 0;
+        std::mutex sumMutex;
+        m_pool.parallelFor(iEnd - iBegin, grain(iEnd - iBegin, grainSize),
+                           [&](std::size_t begin, std::size_t end) {
+                               const btScalar partial =
+                                   body.sumLoop(iBegin + int(begin), iBegin + int(end));
+                               std::lock_guard<std::mutex> lock{sumMutex};
+                               sum += partial;
+                           });
+        return sum;
+    }
+#endif
+
+  private:
+    /// ThreadPool makes a range per thread at most, bigger grain leaves some threads idle
+    std::size_t grain(int count, int grainSize) const
+    {
+        const int perChunk = (count + m_chunks - 1) / m_chunks;
+        return static_cast<std::size_t>(std::max({grainSize, perChunk, 1}));
+    }
+
+    ThreadPool& m_pool;
+    int m_chunks; //< Ranges per loop at most
+};
+
+#endif
+
+} // namespace
+
+//==============================================================================
+
+PhysicsWorld::PhysicsWorld()
+    : PhysicsWorld{Config{}}
+{
+}
+
+//------------------------------------------------------------------------------
+
+PhysicsWorld::PhysicsWorld(const Config& config)
+{
+    if (config.threads > 0) {
+#if BT_THREADSAFE
+        createWorldMt(config);
+#else
+        LOG_WARNING("Bullet is built without BT_THREADSAFE, physics runs on one thread");
+        createWorld(config);
+#endif
+    } else {
+        createWorld(config);
+    }
+
+    m_dynamicsWorld->setGravity(btVector3(0, -9.81, 0));
+    m_dynamicsWorld->getSolverInfo().m_numIterations = config.solverIterations;
+
+    m_filterCallback = new CountingFilter{m_stats};
+    m_overlappingPairCache->getOverlappingPairCache()->setOverlapFilterCallback(m_filterCallback);
+}
+
+//------------------------------------------------------------------------------
+
+PhysicsWorld::~PhysicsWorld()
+{
+    for (int i = m_dynamicsWorld->getNumConstraints() - 1; i >= 0; --i) {
+        btTypedConstraint* constraint = m_dynamicsWorld->getConstraint(i);
+        m_dynamicsWorld->removeConstraint(constraint);
+        delete constraint;
+    }
+
+    // Remove the rigidbodies from the dynamics world and delete them
+    for (int i = m_dynamicsWorld->getNumCollisionObjects() - 1; i >= 0; --i) {
+        btCollisionObject* obj = m_dynamicsWorld->getCollisionObjectArray()[i];
+        btRigidBody* body      = btRigidBody::upcast(obj);
+        if (body && body->getMotionState()) {
+            delete body->getMotionState();
+        }
+        m_dynamicsWorld->removeCollisionObject(obj);
+        delete obj;
+    }
+
+    delete m_dynamicsWorld;
+    delete m_solver;
+    delete m_overlappingPairCache;
+    delete m_dispatcher;
+    delete m_collisionConfiguration;
+    delete m_filterCallback;
+}
+
+//------------------------------------------------------------------------------
+
+int PhysicsWorld::overlappingPairs() const
+{
+    return m_dynamicsWorld->getBroadphase()->getOverlappingPairCache()->getNumOverlappingPairs();
+}
+
+//------------------------------------------------------------------------------
+
+int PhysicsWorld::contactManifolds() const { return m_dispatcher->getNumManifolds(); }
+
+//------------------------------------------------------------------------------
+
+void PhysicsWorld::createWorld(const Config& config)
+{
+    m_collisionConfiguration = new btDefaultCollisionConfiguration();
+    m_dispatcher             = new btCollisionDispatcher(m_collisionConfiguration);
+    m_overlappingPairCache   = createBroadphase(config);
+    m_solver                 = new btSequentialImpulseConstraintSolver;
+    m_dynamicsWorld          = new ProfiledWorld<btDiscreteDynamicsWorld>(
+        m_stats, m_dispatcher, m_overlappingPairCache, m_solver, m_collisionConfiguration);
+}
+
+//------------------------------------------------------------------------------
+
+void PhysicsWorld::createWorldMt(const Config& config)
+{
+#if BT_THREADSAFE
+    // Bullet has one global scheduler, the last created world sets its parallelism
+    static PoolTaskScheduler scheduler{ThreadPool::global()};
+    scheduler.setNumThreads(config.threads);
+    btSetTaskScheduler(&scheduler);
+    m_threads = scheduler.chunks();
+
+    // Pools are shared by threads, growing them takes a lock
+    btDefaultCollisionConstructionInfo info;
+    info.m_defaultMaxPersistentManifoldPoolSize = 80000;
+    info.m_defaultMaxCollisionAlgorithmPoolSize = 80000;
+
+    m_collisionConfiguration = new btDefaultCollisionConfiguration(info);
+    m_dispatcher             = new btCollisionDispatcherMt(m_collisionConfiguration, 40);
+    m_overlappingPairCache   = createBroadphase(config);
+
+    auto solverPool = new btConstraintSolverPoolMt(scheduler.getNumThreads());
+    m_solver        = solverPool;
+#if BT_BULLET_VERSION >= 288
+    m_dynamicsWorld = new ProfiledWorld<btDiscreteDynamicsWorldMt>(
+        m_stats, m_dispatcher, m_overlappingPairCache, solverPool, nullptr,
+        m_collisionConfiguration);
+#else
+    m_dynamicsWorld = new ProfiledWorld<btDiscreteDynamicsWorldMt>(
+        m_stats, m_dispatcher, m_overlappingPairCache, solverPool, m_collisionConfiguration);
+#endif
+
+    LOG_INFO("Physics world stepped by {} threads", m_threads);
+#else
+    createWorld(config);
+#endif
+}
@@ -0,0 +1,85 @@
+#ifndef PHYSICSWORLD_H
+#define PHYSICSWORLD_H
+
+#include <boost/noncopyable.hpp>
+
+class btCollisionConfiguration;
+class btDispatcher;
+class btBroadphaseInterface;
+class btConstraintSolver;
+class btDiscreteDynamicsWorld;
+class btOverlapFilterCallback;
+
+/**
+ * @brief Bullet dynamics world with its collision configuration, dispatcher, broadphase and solver.
+ *
+ * With threads > 0 world is btDiscreteDynamicsWorldMt stepped by Bullet task scheduler running on
+ * ThreadPool::global(). This needs Bullet built with BT_THREADSAFE (NBD_BULLET_MULTITHREADING
+ * option), otherwise single threaded world is created and a warning is logged.
+ *
+ * Time of collision detection and constraint solving is measured every step, see stats().
+ *
+ * Broadphase pairs up bodies only when group of each one is in mask of the other, like Bullet
+ * default filter. Rejected pairs are counted in stats().
+ *
+ * Collision objects and constraints left in the world are deleted with it.
+ */
+class PhysicsWorld final : private boost::noncopyable
+{
+  public:
+    enum class Broadphase {
+        Dbvt,     //< btDbvtBroadphase, dynamic AABB trees, no world bounds
+        AxisSweep //< bt32BitAxisSweep3, 16 bit btAxisSweep3 is limited to 16384 bodies
+    };
+
+    struct Config
+    {
+        int threads           = 0; //< Counts the calling thread, 0 creates single threaded world
+        Broadphase broadphase = Broadphase::Dbvt;
+        float worldHalfExtent = 2000.0f; //< AxisSweep bounds, works badly for bodies outside
+        int solverIterations  = 10;
+    };
+
+    /// Summed since construction or resetStats()
+    struct Stats
+    {
+        double collisionTime    = 0.0; //< Broadphase and narrowphase, seconds
+        double solverTime       = 0.0; //< Seconds
+        /// Pairs rejected by filter. Dbvt counts overlaps of moving bodies in each step, AxisSweep
+        /// only when an overlap starts.
+        long long filteredPairs = 0;
+    };
+
+    PhysicsWorld();
+    explicit PhysicsWorld(const Config& config);
+    ~PhysicsWorld();
+
+    btDiscreteDynamicsWorld* dynamicsWorld() const { return m_dynamicsWorld; }
+
+    /// Threads a parallel loop is split across at most, 1 for single threaded world
+    int threads() const { return m_threads; }
+
+    const Stats& stats() const { return m_stats; }
+    void resetStats() { m_stats = Stats{}; }
+
+    /// Pairs with overlapping bounding boxes after the last step
+    int overlappingPairs() const;
+    /// Narrowphase contact manifolds after the last step
+    int contactManifolds() const;
+
+  private:
+    void createWorld(const Config& config);
+    void createWorldMt(const Config& config);
+
+    btCollisionConfiguration* m_collisionConfiguration = nullptr;
+    btDispatcher* m_dispatcher                         = nullptr;
+    btBroadphaseInterface* m_overlappingPairCache      = nullptr;
+    btConstraintSolver* m_solver                       = nullptr;
+    btDiscreteDynamicsWorld* m_dynamicsWorld           = nullptr;
+    btOverlapFilterCallback* m_filterCallback          = nullptr;
+
+    int m_threads = 1;
+    Stats m_stats;
+};
+
+#endif // PHYSICSWORLD_H
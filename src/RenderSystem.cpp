@@ -1,9 +1,11 @@
 #include "RenderSystem.h"
 
+#include "AssetRefs.h"
 #include "Logger.h"
 #include "ResourcesMgr.h"
 #include "Terrain.h"
 #include "gfx/Framebuffer.h"
+#include "gfx/GpuMemory.h"
 #include "gfx/Light.h"
 #include "gfx/Skybox.h"
 #include "gfx/Text.h"
@@ -45,7 +47,17 @@ RenderSystem::~RenderSystem() { glDeleteVertexArrays(1, &m_emptyVao); }
 
 //------------------------------------------------------------------------------
 
-void RenderSystem::loadCommonResources(const ResourcesMgr& resourcesMgr)
+void RenderSystem::addCommonAssetRefs(AssetRefs& refs)
+{
+    refs.shaderPrograms.insert(
+        {"default", "shadow", "normals", "aabb", "frustum", "font", "skybox"});
+    refs.fonts.insert("ubuntu");
+    refs.materials.insert("skybox_mtl");
+}
+
+//------------------------------------------------------------------------------
+
+void RenderSystem::loadCommonResources(ResourcesMgr& resourcesMgr)
 {
     m_defaultShader = resourcesMgr.getShaderProgram("default");
     m_shadowShader  = resourcesMgr.getShaderProgram("shadow");
@@ -100,9 +112,9 @@ void RenderSystem::addActor(int id, TransformationComponent* tr, RenderComponent
     actor.rd = rd;
     actor.lt = lt;
 
-    auto model = findModel(actor.rd->model);
-    if (model) {
-        actor.model = model;
+    auto it = m_modelNames.find(actor.rd->model);
+    if (it != std::end(m_modelNames)) {
+        actor.model = it->second;
     } else {
         LOG_WARNING("No model named {} found for actor {}", actor.rd->model, id);
     }
@@ -129,8 +141,9 @@ void RenderSystem::update(float delta)
 
     if (m_camera && m_cameraText) updateCameraText();
 
-    for (auto& model : m_models)
-        model->update(delta);
+    m_models.forEach([delta](auto, const auto& model) { model->update(delta); });
+
+    m_textureStreamer.update();
 }
 
 //------------------------------------------------------------------------------
@@ -139,6 +152,8 @@ void RenderSystem::draw()
 {
     if (!m_camera) return;
 
+    GpuMemory::nextFrame();
+
     std::array<Light*, 8> lights = {};
     // Light* sun                   = m_lights.begin()->second.get();
 
@@ -171,11 +186,20 @@ void RenderSystem::draw(ShaderProgram* shaderProgram, const Camera* camera,
     TexturePack environment;
     if (m_skybox) environment = m_skybox->textures();
 
+    // Pixels per unit length at unit distance
+    const float pixelScale = camera->projectionMatrix()[1][1] * m_windowSize.y * 0.5f;
+
     for (const auto& a : m_actors) {
-        if (auto model = a.model.lock()) {
+        if (auto model = m_models.get(a.model)) {
             if (isVisible(*camera, a)) {
-                model->draw(camera->viewMatrix() * a.transformation(), shaderProgram, lights,
-                            environment);
+                const glm::mat4 modelView = camera->viewMatrix() * a.transformation();
+                if (!m_textureStreamer.empty())
+                    model->requestTextureDetail(modelView, pixelScale);
+
+                gfx::Culling culling;
+                culling.projection = camera->projectionMatrix();
+                culling.backFaces  = a.rd->backfaceCulling;
+                model->draw(modelView, shaderProgram, lights, environment, &culling);
             }
         }
     }
@@ -213,7 +237,7 @@ void RenderSystem::drawNormals(ShaderProgram* shaderProgram, const Camera* camer
     std::array<Light*, 8> lights = {};
 
     for (const auto& a : m_actors) {
-        if (auto model = a.model.lock()) {
+        if (auto model = m_models.get(a.model)) {
             model->draw(camera->viewMatrix() * a.transformation(), shaderProgram, lights, {});
         }
     }
@@ -280,7 +304,7 @@ void RenderSystem::drawAabb(ShaderProgram* shaderProgram, const Camera* camera)
     glBindVertexArray(m_emptyVao);
 
     for (const auto& a : m_actors) {
-        if (auto model = a.model.lock()) {
+        if (auto model = m_models.get(a.model)) {
             model->drawAabb(camera->viewMatrix() * a.transformation(), shaderProgram);
         }
     }
@@ -424,7 +448,7 @@ void RenderSystem::lookAtAll()
     Aabb aabb;
 
     for (const auto& a : m_actors) {
-        if (auto model = a.model.lock()) {
+        if (auto model = m_models.get(a.model)) {
             aabb = aabb.mbr(model->aabb(a.transformation()));
         }
     }
@@ -437,7 +461,7 @@ void RenderSystem::lookAtAll()
 
 bool RenderSystem::isVisible(const Camera& camera, const Actor& actor) const
 {
-    if (auto sp = actor.model.lock()) {
+    if (auto sp = m_models.get(actor.model)) {
         const Aabb& box =
             sp->aabb(camera.projectionMatrix() * camera.viewMatrix() * actor.transformation());
         return Aabb::unit().intersects(box);
@@ -447,17 +471,24 @@ bool RenderSystem::isVisible(const Camera& camera, const Actor& actor) const
 
 //------------------------------------------------------------------------------
 
-void RenderSystem::addModel(std::shared_ptr<Model> model) { m_models.insert(model); }
+Handle<Model> RenderSystem::addModel(std::shared_ptr<Model> model)
+{
+    for (const auto& texture : model->textures())
+        m_textureStreamer.add(texture);
+
+    // Model with the same name is replaced, handles of actors using it stay valid
+    auto& handle = m_modelNames[model->name];
+    if (!m_models.replace(handle, model)) handle = m_models.add(std::move(model));
+    return handle;
+}
 
 //------------------------------------------------------------------------------
 
 std::shared_ptr<Model> RenderSystem::findModel(const std::string& name) const
 {
-    auto it = std::find_if(m_models.cbegin(), m_models.cend(),
-                           [&](const auto& m) { return m->name == name; });
-
-    if (it != m_models.cend())
-        return *it;
+    auto it = m_modelNames.find(name);
+    if (it != std::end(m_modelNames))
+        return m_models.getShared(it->second);
     else
         return std::shared_ptr<Model>();
 }
@@ -7,11 +7,14 @@
 #include "gfx/Model.h"
 #include "gfx/ShaderProgram.h"
 #include "gfx/Text.h"
+#include "gfx/TextureStreamer.h"
 
 #include <map>
 #include <set>
+#include <unordered_map>
 
 class ResourcesMgr;
+struct AssetRefs;
 
 namespace gfx {
 
@@ -28,7 +31,7 @@ class RenderSystem final
         TransformationComponent* tr;
         RenderComponent* rd;
         LightComponent* lt;
-        std::weak_ptr<Model> model;
+        Handle<Model> model;
 
         glm::mat4 transformation() const;
     };
@@ -39,7 +42,9 @@ class RenderSystem final
     RenderSystem(const RenderSystem&) = delete;
     RenderSystem& operator=(const RenderSystem&) = delete;
 
-    void loadCommonResources(const ResourcesMgr& resourcesMgr);
+    /// Assets used by loadCommonResources()
+    static void addCommonAssetRefs(AssetRefs& refs);
+    void loadCommonResources(ResourcesMgr& resourcesMgr);
 
     void addActor(int id, TransformationComponent* tr, RenderComponent* rd, LightComponent* lt,
                   const ResourcesMgr& resourcesMgr);
@@ -55,7 +60,8 @@ class RenderSystem final
     Camera* getCamera() { return m_camera; }
     void setCamera(Camera* camera) { m_camera = camera; }
 
-    void addModel(std::shared_ptr<Model> model);
+    /// Replaces model with the same name
+    Handle<Model> addModel(std::shared_ptr<Model> model);
     std::shared_ptr<Model> findModel(const std::string& name) const;
 
     void resizeWindow(glm::ivec2 size);
@@ -93,9 +99,12 @@ class RenderSystem final
 
     std::shared_ptr<Skybox> m_skybox;
     std::shared_ptr<Text> m_cameraText;
-    std::set<std::shared_ptr<Model>> m_models;
+    HandlePool<Model> m_models;
+    std::unordered_map<std::string, Handle<Model>> m_modelNames;
     std::set<std::shared_ptr<Text>> m_texts;
 
+    TextureStreamer m_textureStreamer;
+
     std::shared_ptr<ShaderProgram> m_defaultShader;
     std::shared_ptr<ShaderProgram> m_shadowShader;
     std::shared_ptr<ShaderProgram> m_normalsShader;
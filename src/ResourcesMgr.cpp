@@ -1,9 +1,12 @@
 #include "ResourcesMgr.h"
 
 #include "Logger.h"
+#include "Vfs.h"
+#include "gfx/GpuMemory.h"
 #include "loaders/MtlLoader.h"
 
 #include <SDL.h>
+#include <fmt/format.h>
 #include <nlohmann/json.hpp>
 
 #if defined(__clang__)
@@ -17,8 +20,10 @@
 #pragma clang diagnostic pop
 #endif
 
+#include <algorithm>
 #include <array>
-#include <fstream>
+#include <chrono>
+#include <unordered_set>
 
 ResourcesMgr::ResourcesMgr(const std::string& dataFolder, const std::string& shadersFolder)
     : m_dataFolder{dataFolder}
@@ -32,15 +37,17 @@ void ResourcesMgr::load(const std::string& xmlFile)
 {
     loadShaders(xmlFile);
 
-    nlohmann::json json;
-
-    {
-        std::ifstream f(m_dataFolder + xmlFile);
-        f >> json;
-    }
+    const FileData data = Vfs::global().read(m_dataFolder + xmlFile);
+    auto json           = nlohmann::json::parse(data.view().begin(), data.view().end());
 
     for (const auto& j : json["fonts"]) {
-        addFont(j["name"], j["file"]);
+        const std::string& name = j["name"];
+        const std::string& file = j["file"];
+
+        if (m_fonts.find(name))
+            addFont(name, file);
+        else
+            m_pendingFonts[name] = file;
     }
 
     loadMaterials(xmlFile);
@@ -50,59 +57,116 @@ void ResourcesMgr::load(const std::string& xmlFile)
 
 void ResourcesMgr::loadShaders(const std::string& xmlFile)
 {
-    nlohmann::json json;
-
-    {
-        std::ifstream f(m_dataFolder + xmlFile);
-        f >> json;
-    }
+    const FileData data = Vfs::global().read(m_dataFolder + xmlFile);
+    auto json           = nlohmann::json::parse(data.view().begin(), data.view().end());
 
     for (const auto& j : json["shaders"]) {
-        const std::string& name               = j.value("name", "");
-        const std::string& vertexShaderFile   = j.value("vertex", "");
-        const std::string& geometryShaderFile = j.value("geometry", "");
-        const std::string& fragmentShaderFile = j.value("fragment", "");
-
-        ShaderProgramData spData;
-        spData.name = name;
-
-        const auto extractSource = [](const std::string& filename) -> std::string {
-            std::string source;
-            std::ifstream f(filename.c_str());
-
-            if (f.is_open() == true) {
-                source.assign((std::istreambuf_iterator<char>(f)),
-                              (std::istreambuf_iterator<char>()));
-                f.close();
-            } else {
-                throw std::runtime_error{"File not found: " + filename};
-            }
-            return source;
-        };
-
-        if (!vertexShaderFile.empty())
-            spData.vertexSrc = extractSource(m_shadersFolder + vertexShaderFile);
-
-        if (!geometryShaderFile.empty())
-            spData.geometrySrc = extractSource(m_shadersFolder + geometryShaderFile);
-
-        if (!fragmentShaderFile.empty())
-            spData.fragmentSrc = extractSource(m_shadersFolder + fragmentShaderFile);
-
-        addShaderProgram(spData);
+        const std::string& name = j.value("name", "");
+
+        ShaderProgramFiles files;
+        files.vertex   = j.value("vertex", "");
+        files.geometry = j.value("geometry", "");
+        files.fragment = j.value("fragment", "");
+
+        if (m_shaderPrograms.find(name))
+            loadShaderProgram(name, files);
+        else
+            m_pendingShaderPrograms[name] = files;
     }
 }
 
 //------------------------------------------------------------------------------
 
-void ResourcesMgr::loadMaterials(const std::string& xmlFile)
+void ResourcesMgr::loadShaderProgram(const std::string& name, const ShaderProgramFiles& files)
+{
+    ShaderProgramData spData;
+    spData.name = name;
+
+    const auto extractSource = [](const std::string& filename) -> std::string {
+        if (!Vfs::global().exists(filename))
+            throw std::runtime_error{"File not found: " + filename};
+        return Vfs::global().readString(filename);
+    };
+
+    if (!files.vertex.empty()) spData.vertexSrc = extractSource(m_shadersFolder + files.vertex);
+
+    if (!files.geometry.empty())
+        spData.geometrySrc = extractSource(m_shadersFolder + files.geometry);
+
+    if (!files.fragment.empty())
+        spData.fragmentSrc = extractSource(m_shadersFolder + files.fragment);
+
+    addShaderProgram(spData);
+}
+
+//------------------------------------------------------------------------------
+
+template <typename T, typename Data, typename LoadFunc>
+Handle<T> ResourcesMgr::findOrLoad(Registry<T>& registry, std::map<std::string, Data>& pending,
+                                   const std::string& name, AssetType type, LoadFunc load)
+{
+    auto handle = registry.find(name);
+    if (handle) return handle;
+
+    auto it = pending.find(name);
+    if (it == std::end(pending)) return handle;
+
+    const auto start = std::chrono::steady_clock::now();
+    load(it->first, it->second);
+    const std::chrono::duration<float, std::milli> time = std::chrono::steady_clock::now() - start;
+
+    m_loadStats[type].count += 1;
+    m_loadStats[type].timeMs += time.count();
+    LOG_TRACE("Loaded {} on first use in {:.1f} ms", name, time.count());
+
+    pending.erase(it);
+    return registry.find(name);
+}
+
+//------------------------------------------------------------------------------
+
+void ResourcesMgr::preload(const AssetRefs& refs)
 {
-    nlohmann::json json;
+    const auto start = std::chrono::steady_clock::now();
 
-    {
-        std::ifstream f(m_dataFolder + xmlFile);
-        f >> json;
+    for (const auto& name : refs.shaderPrograms) {
+        if (!findShaderProgram(name)) LOG_WARNING("Shader program '{}' not registered", name);
+    }
+    for (const auto& name : refs.materials) {
+        if (!findMaterial(name)) LOG_WARNING("Material '{}' not registered", name);
     }
+    for (const auto& name : refs.fonts) {
+        if (!findFont(name)) LOG_WARNING("Font '{}' not registered", name);
+    }
+
+    const std::chrono::duration<float, std::milli> time = std::chrono::steady_clock::now() - start;
+    LOG_INFO("Preloaded {} referenced assets in {:.1f} ms", refs.size(), time.count());
+    LOG_INFO("{}", loadingReport());
+}
+
+//------------------------------------------------------------------------------
+
+std::string ResourcesMgr::loadingReport() const
+{
+    const auto line = [this](const char* category, AssetType type, std::size_t pending) {
+        const LoadStats& stats = m_loadStats[type];
+        return fmt::format("  {:<16} {:>4} loaded in {:>8.1f} ms, {:>4} not loaded yet\n", category,
+                           stats.count, stats.timeMs, pending);
+    };
+
+    std::string report = "Assets:\n";
+    report += line("shader programs", ShaderPrograms, m_pendingShaderPrograms.size());
+    report += line("materials", Materials, m_pendingMaterials.size());
+    report += line("fonts", Fonts, m_pendingFonts.size());
+    return report;
+}
+
+//------------------------------------------------------------------------------
+
+void ResourcesMgr::loadMaterials(const std::string& xmlFile)
+{
+    const FileData data = Vfs::global().read(m_dataFolder + xmlFile);
+    auto json           = nlohmann::json::parse(data.view().begin(), data.view().end());
 
     for (const auto& j : json["materials"]) {
 
@@ -110,8 +174,12 @@ void ResourcesMgr::loadMaterials(const std::string& xmlFile)
         MtlLoader mtlLoader;
         mtlLoader.load(m_dataFolder + file);
 
+        // Parsing is cheap, textures are loaded with the material
         for (const auto& mtl : mtlLoader.materials()) {
-            addMaterial(mtl);
+            if (m_materials.find(mtl.name))
+                addMaterial(mtl);
+            else
+                m_pendingMaterials[mtl.name] = mtl;
         }
     }
 }
@@ -130,26 +198,29 @@ void ResourcesMgr::addMaterial(const MaterialData& materialData)
         textures.push_back(getTexture(file));
     }
 
-    auto it = m_materials.find(materialData.name);
-    if (it == m_materials.end()) {
+    Material* material = get(m_materials.find(materialData.name));
+    if (!material) {
         LOG_TRACE("Adding Material: {}", materialData.name);
 
-        m_materials[materialData.name] = std::make_shared<Material>();
-        std::copy(std::cbegin(textures), std::cend(textures),
-                  std::begin(m_materials[materialData.name]->textures));
+        auto handle = m_materials.add(materialData.name, std::make_shared<Material>());
+        material    = get(handle);
     } else {
         LOG_TRACE("Reloading Material: {}", materialData.name);
-        std::copy(std::cbegin(textures), std::cend(textures), std::begin(it->second->textures));
     }
+    std::copy(std::cbegin(textures), std::cend(textures), std::begin(material->textures));
 }
 
-std::shared_ptr<gfx::Material> ResourcesMgr::getMaterial(const std::string& name) const
+std::shared_ptr<gfx::Material> ResourcesMgr::getMaterial(const std::string& name)
 {
-    auto it = m_materials.find(name);
-    if (it == std::end(m_materials))
-        throw std::runtime_error("Material '" + name + "' not loaded.");
-    else
-        return it->second;
+    auto sp = m_materials.pool.getShared(findMaterial(name));
+    if (!sp) throw std::runtime_error("Material '" + name + "' not loaded.");
+    return sp;
+}
+
+Handle<gfx::Material> ResourcesMgr::findMaterial(const std::string& name)
+{
+    return findOrLoad(m_materials, m_pendingMaterials, name, Materials,
+                      [this](const std::string&, const MaterialData& data) { addMaterial(data); });
 }
 
 //------------------------------------------------------------------------------
@@ -177,28 +248,33 @@ void ResourcesMgr::addShaderProgram(const ShaderProgramData& spData)
     std::transform(cbegin(shaders), cend(shaders), begin(shadersRaw),
                    [](const auto& p) { return p.get(); });
 
-    auto it = m_shaderPrograms.find(spData.name);
-    if (it == std::end(m_shaderPrograms)) {
-        LOG_TRACE("Adding ShaderProgram: {}", spData.name);
+    if (ShaderProgram* sp = get(m_shaderPrograms.find(spData.name))) {
+        LOG_TRACE("Reloading ShaderProgram: {}", spData.name);
 
-        auto sp = std::make_shared<ShaderProgram>();
         sp->link(shadersRaw);
-        sp->name                      = spData.name;
-        m_shaderPrograms[spData.name] = sp;
     } else {
-        LOG_TRACE("Reloading ShaderProgram: {}", spData.name);
+        LOG_TRACE("Adding ShaderProgram: {}", spData.name);
 
-        it->second->link(shadersRaw);
+        auto newSp = std::make_shared<ShaderProgram>();
+        newSp->link(shadersRaw);
+        newSp->name = spData.name;
+        m_shaderPrograms.add(spData.name, newSp);
     }
 }
 
-std::shared_ptr<gfx::ShaderProgram> ResourcesMgr::getShaderProgram(const std::string& name) const
+std::shared_ptr<gfx::ShaderProgram> ResourcesMgr::getShaderProgram(const std::string& name)
 {
-    auto it = m_shaderPrograms.find(name);
-    if (it == std::end(m_shaderPrograms))
-        throw std::runtime_error("Shader '" + name + "' not loaded.");
-    else
-        return it->second;
+    auto sp = m_shaderPrograms.pool.getShared(findShaderProgram(name));
+    if (!sp) throw std::runtime_error("Shader '" + name + "' not loaded.");
+    return sp;
+}
+
+Handle<gfx::ShaderProgram> ResourcesMgr::findShaderProgram(const std::string& name)
+{
+    return findOrLoad(m_shaderPrograms, m_pendingShaderPrograms, name, ShaderPrograms,
+                      [this](const std::string& name, const ShaderProgramFiles& files) {
+                          loadShaderProgram(name, files);
+                      });
 }
 
 //------------------------------------------------------------------------------
@@ -209,17 +285,20 @@ void ResourcesMgr::addTexture(const TextureData& texData)
 
     LOG_TRACE("Adding Texture: ", tmp.name);
 
-    tmp.filename         = m_dataFolder + tmp.filename;
-    m_textures[tmp.name] = std::make_shared<gfx::Texture>(tmp.filename.c_str());
+    tmp.filename = m_dataFolder + tmp.filename;
+    m_textures.add(tmp.name, std::make_shared<gfx::Texture>(tmp.filename.c_str()));
 }
 
 std::shared_ptr<gfx::Texture> ResourcesMgr::getTexture(const std::string& name) const
 {
-    auto it = m_textures.find(name);
-    if (it == std::end(m_textures))
-        throw std::runtime_error("Texture '" + name + "' not loaded.");
-    else
-        return it->second;
+    auto sp = m_textures.pool.getShared(findTexture(name));
+    if (!sp) throw std::runtime_error("Texture '" + name + "' not loaded.");
+    return sp;
+}
+
+Handle<gfx::Texture> ResourcesMgr::findTexture(const std::string& name) const
+{
+    return m_textures.find(name);
 }
 
 //------------------------------------------------------------------------------
@@ -260,32 +339,41 @@ void ResourcesMgr::addFont(const std::string& name, const std::string& filename)
     }
     font->setTextures(textures);
 
-    m_fonts[name] = font;
+    m_fonts.add(name, font);
 }
 
-std::shared_ptr<gfx::Font> ResourcesMgr::getFont(const std::string& name) const
+std::shared_ptr<gfx::Font> ResourcesMgr::getFont(const std::string& name)
 {
-    auto it = m_fonts.find(name);
-    if (it == std::end(m_fonts))
-        throw std::runtime_error("Font '" + name + "' not loaded.");
-    else
-        return it->second;
+    auto sp = m_fonts.pool.getShared(findFont(name));
+    if (!sp) throw std::runtime_error("Font '" + name + "' not loaded.");
+    return sp;
+}
+
+Handle<gfx::Font> ResourcesMgr::findFont(const std::string& name)
+{
+    return findOrLoad(m_fonts, m_pendingFonts, name, Fonts,
+                      [this](const std::string& name, const std::string& file) {
+                          addFont(name, file);
+                      });
 }
 
 //------------------------------------------------------------------------------
 
 void ResourcesMgr::addScript(const std::string& name, std::shared_ptr<Script> script)
 {
-    m_scripts[name] = script;
+    m_scripts.add(name, script);
 }
 
 std::shared_ptr<Script> ResourcesMgr::getScript(const std::string& name) const
 {
-    auto it = m_scripts.find(name);
-    if (it == std::end(m_scripts))
-        throw std::runtime_error("Script '" + name + "' not loaded.");
-    else
-        return it->second;
+    auto sp = m_scripts.pool.getShared(findScript(name));
+    if (!sp) throw std::runtime_error("Script '" + name + "' not loaded.");
+    return sp;
+}
+
+Handle<Script> ResourcesMgr::findScript(const std::string& name) const
+{
+    return m_scripts.find(name);
 }
 
 //------------------------------------------------------------------------------
@@ -296,7 +384,8 @@ void ResourcesMgr::addHeightfield(const std::string& name, const std::string& fi
     LOG_TRACE("Adding Heightfield: {}", name);
 
     const std::string filepath = m_dataFolder + filename;
-    gli::texture2d tex(gli::load(filepath));
+    const FileData data = Vfs::global().read(filepath);
+    gli::texture2d tex(gli::load(data.data(), data.size()));
 
     if (tex.empty()) {
         throw std::runtime_error{"Texture load error: " + filepath};
@@ -320,21 +409,118 @@ void ResourcesMgr::addHeightfield(const std::string& name, const std::string& fi
         }
     }
 
-    m_heightfields[name] = heightfield;
+    m_heightfields.add(name, heightfield);
 }
 
 std::shared_ptr<const Heightfield> ResourcesMgr::getHeightfield(const std::string& name) const
 {
-    auto it = m_heightfields.find(name);
+    auto sp = m_heightfields.pool.getShared(findHeightfield(name));
+    if (!sp) throw std::runtime_error("Heightfield '" + name + "' not loaded.");
+    return sp;
+}
 
+Handle<Heightfield> ResourcesMgr::findHeightfield(const std::string& name) const
+{
     auto sep = name.find_first_of(':');
-    if (sep != std::string::npos) {
-        auto sub = name.substr(sep + 1);
-        it       = m_heightfields.find(sub);
+    if (sep != std::string::npos) return m_heightfields.find(name.substr(sep + 1));
+
+    return m_heightfields.find(name);
+}
+
+//------------------------------------------------------------------------------
+
+void ResourcesMgr::track(const std::shared_ptr<gfx::Texture>& texture)
+{
+    if (texture && texture->isEvictable()) m_trackedTextures.push_back(texture);
+}
+
+//------------------------------------------------------------------------------
+
+std::vector<std::shared_ptr<gfx::Texture>> ResourcesMgr::collectTextures() const
+{
+    std::unordered_set<const gfx::Texture*> seen;
+    std::vector<std::shared_ptr<gfx::Texture>> textures;
+
+    const auto add = [&](const std::shared_ptr<gfx::Texture>& texture) {
+        if (texture && seen.insert(texture.get()).second) textures.push_back(texture);
+    };
+
+    m_textures.pool.forEach([&](auto, const auto& texture) { add(texture); });
+    m_materials.pool.forEach([&](auto, const auto& material) {
+        for (const auto& texture : material->textures)
+            add(texture);
+    });
+    m_fonts.pool.forEach([&](auto, const auto& font) {
+        for (std::size_t i = 0; i < font->getTexturesFilenames().size(); ++i)
+            add(font->getTexture(int(i)));
+    });
+
+    for (const auto& wp : m_trackedTextures)
+        add(wp.lock());
+
+    return textures;
+}
+
+//------------------------------------------------------------------------------
+
+void ResourcesMgr::enforceMemoryBudget()
+{
+    m_trackedTextures.erase(std::remove_if(m_trackedTextures.begin(), m_trackedTextures.end(),
+                                           [](const auto& wp) { return wp.expired(); }),
+                            m_trackedTextures.end());
+
+    if (m_memoryBudget == 0 || gfx::GpuMemory::used() <= m_memoryBudget) return;
+
+    // Handles and raw pointers keep no count, so only drawing tells which textures are in use
+    auto textures = collectTextures();
+    std::sort(textures.begin(), textures.end(), [](const auto& a, const auto& b) {
+        return a->lastUsed() < b->lastUsed();
+    });
+
+    const uint32_t frame     = gfx::GpuMemory::frame();
+    std::size_t evictedBytes = 0;
+    int evicted              = 0;
+
+    for (const auto& texture : textures) {
+        if (gfx::GpuMemory::used() <= m_memoryBudget) break;
+        if (texture->lastUsed() == frame) continue;
+
+        const std::size_t bytes = texture->byteSize();
+        if (texture->evict()) {
+            evictedBytes += bytes;
+            ++evicted;
+        }
     }
 
-    if (it == std::end(m_heightfields))
-        throw std::runtime_error("Heightfield '" + name + "' not loaded.");
-    else
-        return it->second;
+    if (evicted > 0) {
+        LOG_INFO("Evicted {} textures ({:.1f} MB), GPU memory {:.1f} / {:.1f} MB", evicted,
+                 evictedBytes / 1048576.0, gfx::GpuMemory::used() / 1048576.0,
+                 m_memoryBudget / 1048576.0);
+    }
+}
+
+//------------------------------------------------------------------------------
+
+std::string ResourcesMgr::residencyReport() const
+{
+    using gfx::GpuMemory;
+
+    auto textures = collectTextures();
+    std::sort(textures.begin(), textures.end(), [](const auto& a, const auto& b) {
+        return a->byteSize() > b->byteSize();
+    });
+
+    std::string report = fmt::format(
+        "GPU memory: textures {:.1f} MB, buffers {:.1f} MB, budget {}\n",
+        GpuMemory::used(GpuMemory::Textures) / 1048576.0,
+        GpuMemory::used(GpuMemory::Buffers) / 1048576.0,
+        m_memoryBudget ? fmt::format("{:.1f} MB", m_memoryBudget / 1048576.0) : "none");
+
+    for (const auto& texture : textures) {
+        const auto& t = *texture;
+        report += fmt::format("{:>8.2f} MB  {:<9} base {:>2}/{:<2} frame {:>7}  {}\n",
+                              t.byteSize() / 1048576.0, t.isResident() ? "resident" : "evicted",
+                              t.baseLevel(), t.levels(), t.lastUsed(), t.name);
+    }
+    return report;
 }
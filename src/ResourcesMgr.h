@@ -1,10 +1,12 @@
 #ifndef RESOURCESMGR_H
 #define RESOURCESMGR_H
 
+#include "AssetRefs.h"
 #include "loaders/FontLoader.h"
 #include "loaders/MeshData.h"
 #include "loaders/TextureData.h"
 #include "loaders/MaterialData.h"
+#include "Handle.h"
 #include "Heightfield.h"
 #include "Script.h"
 
@@ -14,8 +16,11 @@
 #include "gfx/ShaderProgram.h"
 #include "gfx/Texture.h"
 
+#include <array>
 #include <map>
+#include <memory>
 #include <string>
+#include <vector>
 
 struct ShaderProgramData
 {
@@ -25,46 +30,149 @@ struct ShaderProgramData
     std::string name;
 };
 
+/**
+ * @brief Owns resources shared by game systems.
+ *
+ * Resources are found by name once, when an actor or system is set up, and then accessed with
+ * typed handles in O(1). Getters taking a name throw if resource is not loaded, find* functions
+ * return null handle instead.
+ *
+ * Shader programs, materials and fonts listed in assets file are only registered by load().
+ * preload() loads the ones a scene references, the rest is loaded on first lookup.
+ */
 class ResourcesMgr
 {
   public:
     ResourcesMgr(const std::string& dataFolder, const std::string& shadersFolder);
 
+    /// Registers assets listed in file. Already loaded ones are reloaded.
     void load(const std::string& xmlFile);
     void loadShaders(const std::string& xmlFile);
     void loadMaterials(const std::string& xmlFile);
 
+    /// Loads referenced assets now and logs loading times
+    void preload(const AssetRefs& refs);
+    /// Number and loading time of assets per category
+    std::string loadingReport() const;
+
     void addShaderProgram(const ShaderProgramData& spData);
-    std::shared_ptr<gfx::ShaderProgram> getShaderProgram(const std::string& name) const;
+    std::shared_ptr<gfx::ShaderProgram> getShaderProgram(const std::string& name);
+    Handle<gfx::ShaderProgram> findShaderProgram(const std::string& name);
 
     void addTexture(const TextureData& texData);
     std::shared_ptr<gfx::Texture> getTexture(const std::string& name) const;
+    Handle<gfx::Texture> findTexture(const std::string& name) const;
 
     void addMaterial(const MaterialData& materialData);
-    std::shared_ptr<gfx::Material> getMaterial(const std::string& name) const;
+    std::shared_ptr<gfx::Material> getMaterial(const std::string& name);
+    Handle<gfx::Material> findMaterial(const std::string& name);
 
     void addMesh(const MeshData& meshData);
     std::shared_ptr<gfx::Mesh> getMesh(const std::string& name) const;
 
     void addFont(const std::string& name, const std::string& filename);
-    std::shared_ptr<gfx::Font> getFont(const std::string& name) const;
+    std::shared_ptr<gfx::Font> getFont(const std::string& name);
+    Handle<gfx::Font> findFont(const std::string& name);
 
     void addScript(const std::string& name, std::shared_ptr<Script> script);
     std::shared_ptr<Script> getScript(const std::string& name) const;
+    Handle<Script> findScript(const std::string& name) const;
 
     void addHeightfield(const std::string& name, const std::string& filename, float amplitude);
     std::shared_ptr<const Heightfield> getHeightfield(const std::string& name) const;
+    Handle<Heightfield> findHeightfield(const std::string& name) const;
+
+    /// nullptr for null handle or removed resource
+    gfx::ShaderProgram* get(Handle<gfx::ShaderProgram> h) const { return m_shaderPrograms.get(h); }
+    gfx::Texture* get(Handle<gfx::Texture> h) const { return m_textures.get(h); }
+    gfx::Material* get(Handle<gfx::Material> h) const { return m_materials.get(h); }
+    gfx::Font* get(Handle<gfx::Font> h) const { return m_fonts.get(h); }
+    Script* get(Handle<Script> h) const { return m_scripts.get(h); }
+    const Heightfield* get(Handle<Heightfield> h) const { return m_heightfields.get(h); }
+
+    /// GPU memory limit in bytes, 0 means no limit
+    void setMemoryBudget(std::size_t bytes) { m_memoryBudget = bytes; }
+    /// Texture owned elsewhere (e.g. by gfx::Model) that can be evicted too
+    void track(const std::shared_ptr<gfx::Texture>& texture);
+
+    /**
+     * @brief Evicts textures while GPU memory is over budget.
+     *
+     * The least recently drawn textures go first, ones drawn in the current frame are kept.
+     * Evicted texture is loaded again on its next bind. Should be called once per frame.
+     */
+    void enforceMemoryBudget();
+
+    /// Memory used by textures and buffers and list of textures, the biggest first
+    std::string residencyReport() const;
 
   private:
+    /// Objects with index of their names
+    template <typename T>
+    struct Registry
+    {
+        HandlePool<T> pool;
+        std::map<std::string, Handle<T>> names;
+
+        T* get(Handle<T> handle) const { return pool.get(handle); }
+
+        Handle<T> find(const std::string& name) const
+        {
+            auto it = names.find(name);
+            return it != std::end(names) ? it->second : Handle<T>{};
+        }
+
+        /// Replaces object with the same name in place, its handles stay valid
+        Handle<T> add(const std::string& name, std::shared_ptr<T> object)
+        {
+            auto& handle = names[name];
+            if (!pool.replace(handle, object)) handle = pool.add(std::move(object));
+            return handle;
+        }
+    };
+
+    enum AssetType { ShaderPrograms, Materials, Fonts, AssetTypesSize };
+
+    struct LoadStats
+    {
+        int count    = 0;
+        float timeMs = 0.0f;
+    };
+
+    struct ShaderProgramFiles
+    {
+        std::string vertex;
+        std::string geometry;
+        std::string fragment;
+    };
+
+    /// Handle of loaded asset. Pending one is loaded first.
+    template <typename T, typename Data, typename LoadFunc>
+    Handle<T> findOrLoad(Registry<T>& registry, std::map<std::string, Data>& pending,
+                         const std::string& name, AssetType type, LoadFunc load);
+
+    void loadShaderProgram(const std::string& name, const ShaderProgramFiles& files);
+
+    /// Textures of the manager, its materials and fonts and tracked ones, each once
+    std::vector<std::shared_ptr<gfx::Texture>> collectTextures() const;
+
     const std::string m_dataFolder, m_shadersFolder;
 
     std::map<std::string, std::shared_ptr<gfx::Mesh>> m_meshes;
-    std::map<std::string, std::shared_ptr<gfx::Texture>> m_textures;
-    std::map<std::string, std::shared_ptr<gfx::Font>> m_fonts;
-    std::map<std::string, std::shared_ptr<gfx::ShaderProgram>> m_shaderPrograms;
-    std::map<std::string, std::shared_ptr<gfx::Material>> m_materials;
-    std::map<std::string, std::shared_ptr<Script>> m_scripts;
-    std::map<std::string, std::shared_ptr<Heightfield>> m_heightfields;
+    Registry<gfx::Texture> m_textures;
+    Registry<gfx::Font> m_fonts;
+    Registry<gfx::ShaderProgram> m_shaderPrograms;
+    Registry<gfx::Material> m_materials;
+    Registry<Script> m_scripts;
+    Registry<Heightfield> m_heightfields;
+
+    std::map<std::string, ShaderProgramFiles> m_pendingShaderPrograms;
+    std::map<std::string, MaterialData> m_pendingMaterials;
+    std::map<std::string, std::string> m_pendingFonts;
+    std::array<LoadStats, AssetTypesSize> m_loadStats;
+
+    std::size_t m_memoryBudget = 0;
+    std::vector<std::weak_ptr<gfx::Texture>> m_trackedTextures;
 };
 
 #endif
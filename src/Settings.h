@@ -12,6 +12,17 @@ struct Settings
     int msaa                = 0;
     std::string dataFolder;
     std::string shadersFolder;
+    std::string cacheFolder;            //< Cooked assets, empty disables caching
+    std::string packFile;               //< Archive mounted at dataFolder, empty reads loose files
+    bool textureStreaming      = false; //< Load high resolution mips when they are visible
+    bool quantizeMeshes        = false; //< Store vertex attributes in 8 and 16-bit formats
+    int gpuMemoryBudget        = 0;     //< MB for textures and buffers, 0 means no limit
+    float physicsTickRate      = 60.0f; //< Fixed physics steps per second
+    int physicsMaxSubSteps     = 4;     //< Steps per frame, simulation slows down above that
+    int physicsThreads         = 0;     //< Threads stepping physics, 0 is single threaded world
+    float physicsActiveRadius  = 0.0f;  //< Full rate physics near cameras and players, 0 = all
+    float physicsReducedRadius = 0.0f;  //< Physics stepped at reduced rate up to this distance
+    int physicsReducedRate     = 4;     //< Ticks per step of reduced rate physics
 #ifndef NDEBUG
     std::string logLevel = "debug";
 #else
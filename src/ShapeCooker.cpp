@@ -0,0 +1,265 @@
+#include "ShapeCooker.h"
+
+#include "Logger.h"
+#include "Vfs.h"
+#include "loaders/TriangleMesh.h"
+
+#include <LinearMath/btConvexHull.h>
+#include <btBulletDynamicsCommon.h>
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+struct AlignedFree
+{
+    void operator()(void* ptr) const { btAlignedFree(ptr); }
+};
+
+using AlignedBuffer = std::unique_ptr<void, AlignedFree>;
+
+/// Mesh data for TriangleMeshShape, a base class so it is constructed before the shape
+struct TriangleMeshStorage
+{
+    TriangleMeshStorage(std::vector<btScalar> vertices, std::vector<int> indices)
+        : vertices{std::move(vertices)}
+        , indices{std::move(indices)}
+        , meshInterface{static_cast<int>(this->indices.size() / 3), this->indices.data(),
+                        3 * sizeof(int), static_cast<int>(this->vertices.size() / 3),
+                        this->vertices.data(), 3 * sizeof(btScalar)}
+    {
+    }
+
+    std::vector<btScalar> vertices; //< xyz
+    std::vector<int> indices;
+    AlignedBuffer bvhBuffer; //< Deserialized BVH lives in it
+    btTriangleIndexVertexArray meshInterface;
+};
+
+//==============================================================================
+
+/**
+ * @brief btBvhTriangleMeshShape with its own data.
+ *
+ * Cooked form is a header, vertices, indices and BVH serialized in place by Bullet. Loading copies
+ * the BVH to 16-byte aligned buffer and uses it there, nothing is rebuilt.
+ */
+class TriangleMeshShape final : private TriangleMeshStorage, public btBvhTriangleMeshShape
+{
+    struct Header
+    {
+        uint32_t vertexCount; //< Floats
+        uint32_t indexCount;
+        uint32_t bvhSize; //< Bytes
+        uint32_t padding;
+    };
+
+  public:
+    TriangleMeshShape(std::vector<btScalar> vertices, std::vector<int> indices, bool buildBvh)
+        : TriangleMeshStorage{std::move(vertices), std::move(indices)}
+        , btBvhTriangleMeshShape{&meshInterface, true, buildBvh}
+    {
+    }
+
+    /// nullptr if data is not valid
+    static std::unique_ptr<TriangleMeshShape> fromCooked(const std::vector<uint8_t>& cooked)
+    {
+        Header header;
+        if (cooked.size() < sizeof(header)) return {};
+        std::memcpy(&header, cooked.data(), sizeof(header));
+
+        const std::size_t vertexBytes = header.vertexCount * sizeof(btScalar);
+        const std::size_t indexBytes  = header.indexCount * sizeof(int);
+        if (cooked.size() != sizeof(header) + vertexBytes + indexBytes + header.bvhSize ||
+            header.indexCount == 0 || header.indexCount % 3 != 0 || header.vertexCount % 3 != 0)
+            return {};
+
+        const uint8_t* src = cooked.data() + sizeof(header);
+
+        std::vector<btScalar> vertices(header.vertexCount);
+        std::memcpy(vertices.data(), src, vertexBytes);
+        src += vertexBytes;
+
+        std::vector<int> indices(header.indexCount);
+        std::memcpy(indices.data(), src, indexBytes);
+        src += indexBytes;
+
+        const int positionCount = static_cast<int>(header.vertexCount / 3);
+        if (std::any_of(indices.cbegin(), indices.cend(),
+                        [positionCount](int i) { return i < 0 || i >= positionCount; }))
+            return {};
+
+        auto shape = std::make_unique<TriangleMeshShape>(std::move(vertices), std::move(indices),
+                                                         false);
+
+        shape->bvhBuffer.reset(btAlignedAlloc(header.bvhSize, 16));
+        std::memcpy(shape->bvhBuffer.get(), src, header.bvhSize);
+
+        auto bvh = btOptimizedBvh::deSerializeInPlace(shape->bvhBuffer.get(), header.bvhSize,
+                                                      false);
+        if (!bvh) return {};
+
+        shape->setOptimizedBvh(bvh);
+        return shape;
+    }
+
+    std::vector<uint8_t> cooked()
+    {
+        const btOptimizedBvh* bvh = getOptimizedBvh();
+
+        Header header{};
+        header.vertexCount = static_cast<uint32_t>(vertices.size());
+        header.indexCount  = static_cast<uint32_t>(indices.size());
+        header.bvhSize     = bvh->calculateSerializeBufferSize();
+
+        // Bullet requires aligned buffer for serialization too
+        AlignedBuffer bvhData{btAlignedAlloc(header.bvhSize, 16)};
+        if (!bvh->serializeInPlace(bvhData.get(), header.bvhSize, false))
+            throw std::runtime_error{"BVH serialization failed"};
+
+        const std::size_t vertexBytes = vertices.size() * sizeof(btScalar);
+        const std::size_t indexBytes  = indices.size() * sizeof(int);
+
+        std::vector<uint8_t> ans(sizeof(header) + vertexBytes + indexBytes + header.bvhSize);
+        uint8_t* dst = ans.data();
+        std::memcpy(dst, &header, sizeof(header));
+        std::memcpy(dst += sizeof(header), vertices.data(), vertexBytes);
+        std::memcpy(dst += vertexBytes, indices.data(), indexBytes);
+        std::memcpy(dst += indexBytes, bvhData.get(), header.bvhSize);
+        return ans;
+    }
+};
+
+//------------------------------------------------------------------------------
+
+/// Hull vertices chosen by Bullet HullLibrary (the one behind btShapeHull) with vertex limit
+std::vector<glm::vec3> reduceHull(const std::vector<glm::vec3>& points, int maxVertices)
+{
+    std::vector<btVector3> input;
+    input.reserve(points.size());
+    for (const auto& p : points)
+        input.emplace_back(p.x, p.y, p.z);
+
+    HullDesc desc{QF_TRIANGLES, static_cast<unsigned>(input.size()), input.data()};
+    desc.mMaxVertices = static_cast<unsigned>(maxVertices);
+
+    HullLibrary library;
+    HullResult result;
+    if (library.CreateConvexHull(desc, result) != QE_OK) {
+        LOG_WARNING("Convex hull reduction failed, using all {} points", points.size());
+        return points;
+    }
+
+    std::vector<glm::vec3> hull;
+    hull.reserve(result.mNumOutputVertices);
+    for (unsigned i = 0; i < result.mNumOutputVertices; ++i) {
+        const btVector3& v = result.m_OutputVertices[i];
+        hull.emplace_back(v.x(), v.y(), v.z());
+    }
+
+    library.ReleaseResult(result);
+    return hull;
+}
+
+} // namespace
+
+//==============================================================================
+
+ShapeCooker::ShapeCooker(std::filesystem::path dataFolder, std::filesystem::path cacheFolder,
+                         int maxHullVertices)
+    : m_dataFolder{std::move(dataFolder)}
+    , m_cache{std::move(cacheFolder)}
+    , m_maxHullVertices{maxHullVertices}
+{
+}
+
+//------------------------------------------------------------------------------
+
+std::unique_ptr<btConvexHullShape> ShapeCooker::convexHull(const std::string& file) const
+{
+    const auto path = m_dataFolder / file;
+
+    AssetCache::Hasher hasher{"convex-hull-1"};
+    addSource(hasher, path);
+    hasher.add(static_cast<std::size_t>(m_maxHullVertices));
+
+    std::vector<uint8_t> cooked;
+    if (!m_cache.load(hasher.value(), cooked) || cooked.empty() ||
+        cooked.size() % sizeof(glm::vec3) != 0) {
+        const auto mesh = loaders::loadTriangleMesh(path);
+        const auto hull = reduceHull(mesh.positions, m_maxHullVertices);
+
+        cooked.resize(hull.size() * sizeof(glm::vec3));
+        std::memcpy(cooked.data(), hull.data(), cooked.size());
+        m_cache.store(hasher.value(), cooked);
+
+        LOG_DEBUG("Cooked convex hull of {}: {} -> {} vertices", file, mesh.positions.size(),
+                  hull.size());
+    }
+
+    std::vector<glm::vec3> hull(cooked.size() / sizeof(glm::vec3));
+    std::memcpy(hull.data(), cooked.data(), cooked.size());
+
+    auto shape = std::make_unique<btConvexHullShape>();
+    for (const auto& p : hull)
+        shape->addPoint(btVector3{p.x, p.y, p.z}, false);
+    shape->recalcLocalAabb();
+    return shape;
+}
+
+//------------------------------------------------------------------------------
+
+void ShapeCooker::addSource(AssetCache::Hasher& hasher, const std::filesystem::path& file) const
+{
+    const auto& vfs     = Vfs::global();
+    const FileData data = vfs.read(file);
+    hasher.add(data.data(), data.size());
+
+    if (file.extension() != ".gltf") return;
+
+    const auto json = nlohmann::json::parse(data.view().begin(), data.view().end());
+    for (const auto& buffer : json.value("buffers", nlohmann::json::array())) {
+        const std::string uri = buffer.value("uri", "");
+        if (uri.empty() || uri.compare(0, 5, "data:") == 0) continue;
+
+        const FileData bin = vfs.read(file.parent_path() / uri);
+        hasher.add(bin.data(), bin.size());
+    }
+}
+
+//------------------------------------------------------------------------------
+
+std::unique_ptr<btBvhTriangleMeshShape> ShapeCooker::triangleMesh(const std::string& file) const
+{
+    const auto path = m_dataFolder / file;
+
+    AssetCache::Hasher hasher{"triangle-mesh-1"};
+    // Cooked BVH is loaded in place, its layout depends on scalar type and Bullet version
+    hasher.add(sizeof(btScalar));
+    hasher.add(static_cast<std::size_t>(BT_BULLET_VERSION));
+    addSource(hasher, path);
+
+    std::vector<uint8_t> cooked;
+    if (m_cache.load(hasher.value(), cooked)) {
+        if (auto shape = TriangleMeshShape::fromCooked(cooked)) return shape;
+        LOG_WARNING("Invalid cooked triangle mesh of {}, cooking again", file);
+    }
+
+    const auto mesh = loaders::loadTriangleMesh(path);
+    if (mesh.triangleCount() == 0) throw std::runtime_error{"No triangles in " + file};
+
+    std::vector<btScalar> vertices;
+    vertices.reserve(mesh.positions.size() * 3);
+    for (const auto& p : mesh.positions)
+        vertices.insert(vertices.end(), {p.x, p.y, p.z});
+
+    std::vector<int> indices(mesh.indices.begin(), mesh.indices.begin() + mesh.triangleCount() * 3);
+
+    auto shape = std::make_unique<TriangleMeshShape>(std::move(vertices), std::move(indices), true);
+    m_cache.store(hasher.value(), shape->cooked());
+
+    LOG_DEBUG("Cooked triangle mesh of {}: {} triangles", file, mesh.triangleCount());
+    return shape;
+}
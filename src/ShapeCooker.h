@@ -0,0 +1,43 @@
+#ifndef SHAPECOOKER_H
+#define SHAPECOOKER_H
+
+#include "AssetCache.h"
+
+#include <filesystem>
+#include <memory>
+#include <string>
+
+class btBvhTriangleMeshShape;
+class btConvexHullShape;
+
+/**
+ * @brief Builds collision shapes of model files for PhysicsSystem.
+ *
+ * Models are read on CPU, see loaders::loadTriangleMesh. Cooked shapes are stored in AssetCache
+ * under hash of source files, so following runs skip loading, hull and BVH building. Cooked data
+ * is not scaled, scale is set with btCollisionShape::setLocalScaling (triangle meshes should be
+ * wrapped in btScaledBvhTriangleMeshShape, scaling them directly rebuilds the BVH).
+ */
+class ShapeCooker final
+{
+  public:
+    ShapeCooker(std::filesystem::path dataFolder, std::filesystem::path cacheFolder,
+                int maxHullVertices);
+
+    /// Convex hull of all triangles in file (relative to data folder), maxHullVertices at most
+    std::unique_ptr<btConvexHullShape> convexHull(const std::string& file) const;
+
+    /// Static triangle mesh owning its triangles and quantized BVH. BVH is built only when cooking,
+    /// cached one is used in place of the loaded buffer.
+    std::unique_ptr<btBvhTriangleMeshShape> triangleMesh(const std::string& file) const;
+
+  private:
+    /// Hashes file with glTF buffers it references
+    void addSource(AssetCache::Hasher& hasher, const std::filesystem::path& file) const;
+
+    std::filesystem::path m_dataFolder;
+    AssetCache m_cache;
+    int m_maxHullVertices;
+};
+
+#endif // SHAPECOOKER_H
@@ -0,0 +1,131 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+
+ThreadPool::ThreadPool(unsigned threadCount)
+{
+    if (threadCount == 0) {
+        const unsigned hw = std::thread::hardware_concurrency();
+        threadCount       = hw > 1 ? hw - 1 : 1;
+    }
+
+    m_workers.reserve(threadCount);
+    for (unsigned i = 0; i < threadCount; ++i)
+        m_workers.emplace_back(&ThreadPool::workerLoop, this);
+}
+
+//------------------------------------------------------------------------------
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        m_stop = true;
+    }
+    m_cv.notify_all();
+
+    for (auto& worker : m_workers)
+        worker.join();
+}
+
+//------------------------------------------------------------------------------
+
+ThreadPool& ThreadPool::global()
+{
+    static ThreadPool pool;
+    return pool;
+}
+
+//------------------------------------------------------------------------------
+
+void ThreadPool::enqueue(std::function<void()> task)
+{
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        m_tasks.push_back(std::move(task));
+    }
+    m_cv.notify_one();
+}
+
+//------------------------------------------------------------------------------
+
+bool ThreadPool::runPendingTask()
+{
+    std::function<void()> task;
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        if (m_tasks.empty()) return false;
+        task = std::move(m_tasks.front());
+        m_tasks.pop_front();
+    }
+    task();
+    return true;
+}
+
+//------------------------------------------------------------------------------
+
+void ThreadPool::workerLoop()
+{
+    for (;;) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock{m_mutex};
+            m_cv.wait(lock, [this] { return m_stop || !m_tasks.empty(); });
+            if (m_stop && m_tasks.empty()) return;
+            task = std::move(m_tasks.front());
+            m_tasks.pop_front();
+        }
+        task();
+    }
+}
+
+//------------------------------------------------------------------------------
+
+void ThreadPool::parallelFor(std::size_t count, std::size_t grain,
+                             const std::function<void(std::size_t, std::size_t)>& func)
+{
+    if (count == 0) return;
+
+    grain = std::max<std::size_t>(grain, 1);
+    const std::size_t maxChunks = (count + grain - 1) / grain;
+    const std::size_t chunks    = std::min<std::size_t>(maxChunks, threadCount() + 1);
+
+    if (chunks <= 1) {
+        func(0, count);
+        return;
+    }
+
+    const std::size_t chunkSize = (count + chunks - 1) / chunks;
+
+    std::atomic<std::size_t> remaining{chunks - 1};
+    std::exception_ptr error;
+    std::mutex errorMutex;
+
+    const auto runChunk = [&](std::size_t chunk) {
+        const std::size_t begin = chunk * chunkSize;
+        const std::size_t end   = std::min(count, begin + chunkSize);
+        try {
+            if (begin < end) func(begin, end);
+        } catch (...) {
+            std::lock_guard<std::mutex> lock{errorMutex};
+            if (!error) error = std::current_exception();
+        }
+    };
+
+    for (std::size_t chunk = 1; chunk < chunks; ++chunk) {
+        enqueue([&, chunk]() {
+            runChunk(chunk);
+            --remaining;
+        });
+    }
+
+    runChunk(0);
+
+    // Help with queued work instead of sleeping
+    while (remaining > 0) {
+        if (!runPendingTask()) std::this_thread::yield();
+    }
+
+    if (error) std::rethrow_exception(error);
+}
@@ -0,0 +1,64 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Fixed number of worker threads executing queued tasks.
+ *
+ * Tasks must not block waiting for other tasks of the same pool. parallelFor is safe to call
+ * from a worker because the calling thread takes part in the work.
+ */
+class ThreadPool final
+{
+  public:
+    /// threadCount == 0 means hardware concurrency - 1
+    explicit ThreadPool(unsigned threadCount = 0);
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+    ~ThreadPool();
+
+    /// Pool shared by loaders and systems
+    static ThreadPool& global();
+
+    unsigned threadCount() const { return static_cast<unsigned>(m_workers.size()); }
+
+    template <typename F>
+    auto submit(F&& task) -> std::future<decltype(task())>
+    {
+        using R = decltype(task());
+
+        auto packaged = std::make_shared<std::packaged_task<R()>>(std::forward<F>(task));
+        auto future   = packaged->get_future();
+        enqueue([packaged]() { (*packaged)(); });
+        return future;
+    }
+
+    /**
+     * @brief Calls func(begin, end) for consecutive ranges of [0, count).
+     *
+     * Ranges have at least grain elements. Blocks until all ranges are done. First exception
+     * thrown by func is rethrown.
+     */
+    void parallelFor(std::size_t count, std::size_t grain,
+                     const std::function<void(std::size_t, std::size_t)>& func);
+
+  private:
+    void enqueue(std::function<void()> task);
+    bool runPendingTask();
+    void workerLoop();
+
+    std::vector<std::thread> m_workers;
+    std::deque<std::function<void()>> m_tasks;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    bool m_stop = false;
+};
+
+#endif // THREADPOOL_H
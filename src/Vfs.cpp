@@ -0,0 +1,84 @@
+#include "Vfs.h"
+
+#include "Logger.h"
+
+std::string_view FileData::view() const
+{
+    struct Visitor
+    {
+        std::string_view operator()(std::string_view v) const { return v; }
+        std::string_view operator()(const MappedFile& f) const { return f.view(); }
+        std::string_view operator()(const std::string& s) const { return s; }
+    };
+    return std::visit(Visitor{}, m_source);
+}
+
+//==============================================================================
+
+Vfs& Vfs::global()
+{
+    static Vfs vfs;
+    return vfs;
+}
+
+//------------------------------------------------------------------------------
+
+void Vfs::mount(const std::filesystem::path& packFile, const std::filesystem::path& mountPoint)
+{
+    auto pack = std::make_unique<PackFile>(packFile);
+    LOG_INFO("Mounted {} ({} files) at {}", packFile.string(), pack->size(), mountPoint.string());
+
+    // Trailing separator would make every path relative to it start with ".."
+    auto normal = mountPoint.lexically_normal();
+    if (!normal.has_filename()) normal = normal.parent_path();
+
+    m_mounts.push_back({std::move(pack), normal});
+}
+
+//------------------------------------------------------------------------------
+
+std::pair<const PackFile*, const PackFile::Entry*>
+Vfs::find(const std::filesystem::path& file) const
+{
+    if (m_mounts.empty()) return {nullptr, nullptr};
+
+    const auto normal = file.lexically_normal();
+
+    for (auto it = m_mounts.rbegin(); it != m_mounts.rend(); ++it) {
+        const auto relative = normal.lexically_relative(it->mountPoint);
+        if (relative.empty() || *relative.begin() == "..") continue;
+
+        const auto key = relative.generic_string();
+        if (auto entry = it->pack->find(key)) return {it->pack.get(), entry};
+    }
+    return {nullptr, nullptr};
+}
+
+//------------------------------------------------------------------------------
+
+FileData Vfs::read(const std::filesystem::path& file) const
+{
+    auto [pack, entry] = find(file);
+    if (!pack) return FileData{MappedFile{file}};
+
+    if (entry->compression == PackFile::Compression::None) return FileData{pack->stored(*entry)};
+    return FileData{pack->read(*entry)};
+}
+
+//------------------------------------------------------------------------------
+
+std::string Vfs::readString(const std::filesystem::path& file) const
+{
+    return std::string{read(file).view()};
+}
+
+//------------------------------------------------------------------------------
+
+bool Vfs::exists(const std::filesystem::path& file) const
+{
+    return isPacked(file) || std::filesystem::exists(file);
+}
+
+//------------------------------------------------------------------------------
+
+bool Vfs::isPacked(const std::filesystem::path& file) const { return find(file).first != nullptr; }
@@ -0,0 +1,78 @@
+#ifndef VFS_H
+#define VFS_H
+
+#include "MappedFile.h"
+#include "PackFile.h"
+
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+/**
+ * @brief Contents of a file read through Vfs.
+ *
+ * Keeps the data alive: view into a pack, mapping of a loose file or inflated copy.
+ */
+class FileData final
+{
+  public:
+    const char* data() const { return view().data(); }
+    std::size_t size() const { return view().size(); }
+    std::string_view view() const;
+
+  private:
+    friend class Vfs;
+
+    template <typename T>
+    explicit FileData(T&& source)
+        : m_source{std::forward<T>(source)}
+    {
+    }
+
+    std::variant<std::string_view, MappedFile, std::string> m_source;
+};
+
+//==============================================================================
+
+/**
+ * @brief Virtual file system in front of all asset reads.
+ *
+ * Packs are mounted at a folder (usually Settings::dataFolder). Paths inside that folder are
+ * served from the pack, other paths and files missing in packs from the disk. Mount packs before
+ * loading starts, reading is thread safe.
+ */
+class Vfs final
+{
+  public:
+    /// Used by loaders
+    static Vfs& global();
+
+    /// Later mounts take precedence. Throws std::runtime_error if pack cannot be opened.
+    void mount(const std::filesystem::path& packFile, const std::filesystem::path& mountPoint);
+
+    /// Throws std::runtime_error if file is neither packed nor on disk
+    FileData read(const std::filesystem::path& file) const;
+    std::string readString(const std::filesystem::path& file) const;
+
+    bool exists(const std::filesystem::path& file) const;
+    /// File is served from a pack
+    bool isPacked(const std::filesystem::path& file) const;
+
+  private:
+    struct Mount
+    {
+        std::unique_ptr<PackFile> pack;
+        std::filesystem::path mountPoint;
+    };
+
+    /// Pack containing file and its entry or {nullptr, nullptr}
+    std::pair<const PackFile*, const PackFile::Entry*>
+    find(const std::filesystem::path& file) const;
+
+    std::vector<Mount> m_mounts;
+};
+
+#endif // VFS_H
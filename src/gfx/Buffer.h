@@ -27,6 +27,7 @@ class Buffer final
 
     void bind(GLenum target);
 
+    /// Size is accounted in GpuMemory
     void loadData(const void* data, std::size_t size, GLenum usage = GL_STATIC_DRAW);
     void getData(void* data, std::size_t size, std::ptrdiff_t byteOffset = 0) const;
 
@@ -82,7 +83,8 @@ struct Accessor final
         case GL_BYTE:
         case GL_UNSIGNED_BYTE: return 1;
         case GL_SHORT:
-        case GL_UNSIGNED_SHORT: return 2;
+        case GL_UNSIGNED_SHORT:
+        case GL_HALF_FLOAT: return 2;
         default: return 4;
         }
     }
@@ -115,11 +117,6 @@ template <> inline GLenum Accessor::glTypeToEnum<glm::mat3>() const { return GL_
 template <> inline GLenum Accessor::glTypeToEnum<glm::mat4>() const { return GL_FLOAT; }
 // clang-format on
 
-//------------------------------------------------------------------------------
-
-Accessor calculateTangents(const std::array<Accessor, Accessor::Attribute::Size>& attributes,
-                           const Accessor& indices);
-
 } // namespace gfx
 
 #endif // GFX_BUFFER_H
@@ -1,36 +1,109 @@
-#include "Font.h"
-
-namespace gfx {
-
-Font::Font() {}
-
-std::vector<std::string> Font::getTexturesFilenames() const { return m_pages; }
-
-void Font::setTextures(const std::vector<std::shared_ptr<Texture>>& textures)
-{
-    m_textures = textures;
-}
-
-std::shared_ptr<Texture> Font::getTexture(const Char& c) const { return m_textures.at(c.page); }
-
-std::shared_ptr<Texture> Font::getTexture(int page) const { return m_textures.at(page); }
-
-Font::Char Font::getChar(char c) const { return m_chars.at(c); }
-
-unsigned Font::getLineHeight() const { return m_common.lineHeight; }
-
-int Font::getKerning(char prev, char next) const
-{
-    const std::pair<uint32_t, uint32_t> key{prev, next};
-    const auto& it = m_kerning.find(key);
-    if (it != std::end(m_kerning))
-        return it->second;
-    else
-        return 0;
-}
-
-unsigned Font::getScaleW() const { return m_common.scaleW; }
-
-unsigned Font::getScaleH() const { return m_common.scaleH; }
-
-} // namespace gfx
+#include "Font.h"
+
+#include <algorithm>
+
+namespace gfx {
+
+Font::Font() {}
+
+std::vector<std::string> Font::getTexturesFilenames() const { return m_pages; }
+
+void Font::setTextures(const std::vector<std::shared_ptr<Texture>>& textures)
+{
+    m_textures = textures;
+}
+
+std::shared_ptr<Texture> Font::getTexture(const Char& c) const { return m_textures.at(c.page); }
+
+std::shared_ptr<Texture> Font::getTexture(int page) const { return m_textures.at(page); }
+
+const Font::Char& Font::getSparseChar(uint32_t codepoint) const
+{
+    static const Char empty{};
+
+    auto it = m_sparseGlyphs.find(codepoint);
+    return it != std::end(m_sparseGlyphs) ? it->second : empty;
+}
+
+void Font::addChar(const Char& c)
+{
+    // Repeated id replaces the glyph, it is counted once
+    if (c.id < DenseRange) {
+        if (c.id >= m_glyphs.size()) {
+            m_glyphs.resize(c.id + 1);
+            m_hasGlyph.resize(c.id + 1);
+        }
+        m_glyphs[c.id] = c;
+        if (!m_hasGlyph[c.id]) ++m_charsCount;
+        m_hasGlyph[c.id] = true;
+    } else {
+        if (m_sparseGlyphs.insert_or_assign(c.id, c).second) ++m_charsCount;
+    }
+}
+
+unsigned Font::getLineHeight() const { return m_common.lineHeight; }
+
+//------------------------------------------------------------------------------
+
+static std::size_t kerningSlot(uint64_t key, std::size_t mask)
+{
+    return static_cast<std::size_t>((key * 0x9E3779B97F4A7C15ull) >> 32) & mask;
+}
+
+int Font::getKerning(uint32_t prev, uint32_t next) const
+{
+    if (m_kerningCount == 0) return 0;
+
+    const uint64_t key     = uint64_t(prev) << 32 | next;
+    const std::size_t mask = m_kerning.size() - 1;
+
+    for (std::size_t i = kerningSlot(key, mask);; i = (i + 1) & mask) {
+        const KerningEntry& entry = m_kerning[i];
+        if (entry.key == key) return entry.amount;
+        if (entry.key == EmptyKey) return 0;
+    }
+}
+
+void Font::addKerning(uint32_t first, uint32_t second, int16_t amount)
+{
+    // Keep load factor under 1/2
+    if ((m_kerningCount + 1) * 2 > m_kerning.size())
+        rehashKerning(std::max<std::size_t>(16, m_kerning.size() * 2));
+
+    const uint64_t key     = uint64_t(first) << 32 | second;
+    const std::size_t mask = m_kerning.size() - 1;
+
+    for (std::size_t i = kerningSlot(key, mask);; i = (i + 1) & mask) {
+        KerningEntry& entry = m_kerning[i];
+        if (entry.key == key) {
+            entry.amount = amount;
+            return;
+        }
+        if (entry.key == EmptyKey) {
+            entry.key    = key;
+            entry.amount = amount;
+            ++m_kerningCount;
+            return;
+        }
+    }
+}
+
+void Font::rehashKerning(std::size_t capacity)
+{
+    std::vector<KerningEntry> old(capacity);
+    std::swap(old, m_kerning);
+    m_kerningCount = 0;
+
+    for (const auto& entry : old) {
+        if (entry.key != EmptyKey)
+            addKerning(uint32_t(entry.key >> 32), uint32_t(entry.key), entry.amount);
+    }
+}
+
+//------------------------------------------------------------------------------
+
+unsigned Font::getScaleW() const { return m_common.scaleW; }
+
+unsigned Font::getScaleH() const { return m_common.scaleH; }
+
+} // namespace gfx
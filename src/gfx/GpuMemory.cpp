@@ -0,0 +1,8 @@
+#include "GpuMemory.h"
+
+namespace gfx {
+
+std::array<std::atomic<std::size_t>, GpuMemory::Kind::Size> GpuMemory::s_used{};
+uint32_t GpuMemory::s_frame = 0;
+
+} // namespace gfx
@@ -0,0 +1,38 @@
+#ifndef GFX_GPUMEMORY_H
+#define GFX_GPUMEMORY_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace gfx {
+
+/**
+ * @brief Bytes of GPU memory held by Textures and Buffers.
+ *
+ * Sizes are what was passed to GL, driver overhead and padding are not included. Frame counter
+ * is used to find least recently drawn resources.
+ */
+class GpuMemory final
+{
+  public:
+    enum Kind { Textures, Buffers, Size };
+
+    static void allocated(Kind kind, std::size_t bytes) { s_used[kind] += bytes; }
+    static void released(Kind kind, std::size_t bytes) { s_used[kind] -= bytes; }
+
+    static std::size_t used(Kind kind) { return s_used[kind]; }
+    static std::size_t used() { return s_used[Textures] + s_used[Buffers]; }
+
+    static void nextFrame() { ++s_frame; }
+    static uint32_t frame() { return s_frame; }
+
+  private:
+    static std::array<std::atomic<std::size_t>, Kind::Size> s_used;
+    static uint32_t s_frame;
+};
+
+} // namespace gfx
+
+#endif // GFX_GPUMEMORY_H
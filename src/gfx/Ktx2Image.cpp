@@ -0,0 +1,107 @@
+#include "Ktx2Image.h"
+
+#include "../Logger.h"
+#include "../Vfs.h"
+
+#include <basisu_transcoder.h>
+
+#include <mutex>
+#include <numeric>
+#include <stdexcept>
+
+namespace gfx {
+
+TextureCaps TextureCaps::query()
+{
+    TextureCaps caps;
+    caps.bptc = GLEW_ARB_texture_compression_bptc || GLEW_VERSION_4_2;
+    caps.s3tc = GLEW_EXT_texture_compression_s3tc;
+    return caps;
+}
+
+//==============================================================================
+
+namespace {
+
+struct TargetFormat
+{
+    basist::transcoder_texture_format basis;
+    GLenum internalFormat;
+    GLenum format;
+    GLenum type;
+};
+
+TargetFormat chooseFormat(TextureCaps caps, bool hasAlpha)
+{
+    using Fmt = basist::transcoder_texture_format;
+
+    if (caps.bptc) return {Fmt::cTFBC7_RGBA, GL_COMPRESSED_RGBA_BPTC_UNORM, 0, 0};
+    if (caps.s3tc && hasAlpha) return {Fmt::cTFBC3_RGBA, GL_COMPRESSED_RGBA_S3TC_DXT5_EXT, 0, 0};
+    if (caps.s3tc) return {Fmt::cTFBC1_RGB, GL_COMPRESSED_RGB_S3TC_DXT1_EXT, 0, 0};
+    return {Fmt::cTFRGBA32, GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE};
+}
+
+} // namespace
+
+//------------------------------------------------------------------------------
+
+std::size_t Ktx2Image::byteSize() const
+{
+    return std::accumulate(levels.cbegin(), levels.cend(), std::size_t{0},
+                           [](std::size_t sum, const auto& level) { return sum + level.size(); });
+}
+
+//------------------------------------------------------------------------------
+
+Ktx2Image Ktx2Image::transcode(const std::filesystem::path& file, TextureCaps caps)
+{
+    static std::once_flag initFlag;
+    std::call_once(initFlag, basist::basisu_transcoder_init);
+
+    const auto error = [&file](const char* what) {
+        return std::runtime_error{"KTX2 " + file.string() + ": " + what};
+    };
+
+    const FileData data = Vfs::global().read(file);
+
+    basist::ktx2_transcoder transcoder;
+    if (!transcoder.init(data.data(), static_cast<uint32_t>(data.size())))
+        throw error("not a Basis Universal KTX2 file");
+    if (transcoder.get_layers() > 1 || transcoder.get_faces() > 1)
+        throw error("only 2D textures are supported");
+    if (!transcoder.start_transcoding()) throw error("cannot start transcoding");
+
+    const TargetFormat target    = chooseFormat(caps, transcoder.get_has_alpha());
+    const uint32_t bytesPerBlock = basist::basis_get_bytes_per_block_or_pixel(target.basis);
+    const bool uncompressed      = basist::basis_transcoder_format_is_uncompressed(target.basis);
+
+    Ktx2Image image;
+    image.internalFormat = target.internalFormat;
+    image.format         = target.format;
+    image.type           = target.type;
+    image.width          = static_cast<int>(transcoder.get_width());
+    image.height         = static_cast<int>(transcoder.get_height());
+    image.levels.resize(transcoder.get_levels());
+
+    for (uint32_t level = 0; level < transcoder.get_levels(); ++level) {
+        basist::ktx2_image_level_info info;
+        if (!transcoder.get_image_level_info(info, level, 0, 0)) throw error("bad level info");
+
+        // Uncompressed formats are sized in pixels, block formats in blocks
+        const uint32_t units =
+            uncompressed ? info.m_orig_width * info.m_orig_height : info.m_total_blocks;
+
+        auto& out = image.levels[level];
+        out.resize(std::size_t(units) * bytesPerBlock);
+        if (!transcoder.transcode_image_level(level, 0, 0, out.data(), units, target.basis))
+            throw error("transcoding failed");
+    }
+
+    LOG_TRACE("Transcoded {} ({}, {} levels) to {}", file.string(),
+              transcoder.is_etc1s() ? "ETC1S" : "UASTC", image.levels.size(),
+              basist::basis_get_format_name(target.basis));
+
+    return image;
+}
+
+} // namespace gfx
@@ -0,0 +1,52 @@
+#ifndef GFX_KTX2IMAGE_H
+#define GFX_KTX2IMAGE_H
+
+#include <GL/glew.h>
+
+#include <filesystem>
+#include <vector>
+
+namespace gfx {
+
+/// Compressed formats supported by the current GL context
+struct TextureCaps
+{
+    bool bptc = false; //< BC7
+    bool s3tc = false; //< BC1, BC3
+
+    /// Must be called on the thread with GL context
+    static TextureCaps query();
+};
+
+//==============================================================================
+
+/**
+ * @brief 2D image transcoded from KTX2 file with Basis Universal (ETC1S or UASTC) payload.
+ *
+ * Target is BC7 if supported, then BC3 (BC1 for opaque images), then uncompressed RGBA8.
+ * Transcoding does not touch GL so it can run on worker threads, the result is uploaded by
+ * Texture. Data is UNORM, shaders convert sRGB themselves.
+ */
+struct Ktx2Image
+{
+    GLenum internalFormat = 0;
+    GLenum format         = 0; //< 0 for compressed formats
+    GLenum type           = 0; //< 0 for compressed formats
+
+    int width  = 0;
+    int height = 0;
+
+    std::vector<std::vector<char>> levels;
+
+    bool isCompressed() const { return type == 0; }
+    std::size_t byteSize() const;
+
+    /// Reads file through Vfs. Throws std::runtime_error if file cannot be transcoded.
+    static Ktx2Image transcode(const std::filesystem::path& file, TextureCaps caps);
+
+    static bool isKtx2(const std::filesystem::path& file) { return file.extension() == ".ktx2"; }
+};
+
+} // namespace gfx
+
+#endif // GFX_KTX2IMAGE_H
@@ -0,0 +1,83 @@
+#include "KtxFile.h"
+
+#include <array>
+#include <cstring>
+#include <stdexcept>
+
+namespace gfx {
+
+namespace {
+
+const std::array<uint8_t, 12> KtxIdentifier = {
+    {0xAB, 0x4B, 0x54, 0x58, 0x20, 0x31, 0x31, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A}};
+
+struct KtxHeader
+{
+    uint32_t endianness;
+    uint32_t glType;
+    uint32_t glTypeSize;
+    uint32_t glFormat;
+    uint32_t glInternalFormat;
+    uint32_t glBaseInternalFormat;
+    uint32_t pixelWidth;
+    uint32_t pixelHeight;
+    uint32_t pixelDepth;
+    uint32_t numberOfArrayElements;
+    uint32_t numberOfFaces;
+    uint32_t numberOfMipmapLevels;
+    uint32_t bytesOfKeyValueData;
+};
+
+std::size_t align4(std::size_t size) { return (size + 3) & ~std::size_t(3); }
+
+} // namespace
+
+KtxFile::KtxFile(const std::filesystem::path& file)
+    : m_file{Vfs::global().read(file)}
+{
+    const auto error = [&file](const char* what) {
+        return std::runtime_error{"KTX " + file.string() + ": " + what};
+    };
+
+    const char* data = m_file.data();
+    std::size_t size = m_file.size();
+
+    if (size < KtxIdentifier.size() + sizeof(KtxHeader) ||
+        std::memcmp(data, KtxIdentifier.data(), KtxIdentifier.size()) != 0)
+        throw error("not a KTX 1.1 file");
+
+    KtxHeader header;
+    std::memcpy(&header, data + KtxIdentifier.size(), sizeof(header));
+    if (header.endianness != 0x04030201) throw error("unsupported endianness");
+
+    m_glType           = header.glType;
+    m_glFormat         = header.glFormat;
+    m_glInternalFormat = header.glInternalFormat;
+    m_width            = static_cast<int>(header.pixelWidth);
+    m_height           = static_cast<int>(std::max(1u, header.pixelHeight));
+    m_is2D = header.pixelHeight > 0 && header.pixelDepth == 0 &&
+             header.numberOfArrayElements == 0 && header.numberOfFaces == 1;
+
+    const std::size_t faces = std::max(1u, header.numberOfFaces);
+    const bool cube         = faces == 6 && header.numberOfArrayElements == 0;
+
+    std::size_t offset =
+        KtxIdentifier.size() + sizeof(KtxHeader) + std::size_t(header.bytesOfKeyValueData);
+
+    const uint32_t levels = std::max(1u, header.numberOfMipmapLevels);
+    for (uint32_t level = 0; level < levels; ++level) {
+        uint32_t imageSize = 0;
+        if (offset + sizeof(imageSize) > size) throw error("truncated");
+        std::memcpy(&imageSize, data + offset, sizeof(imageSize));
+        offset += sizeof(imageSize);
+
+        // Non-array cube map stores imageSize of one face, every face is padded
+        const std::size_t levelSize = cube ? faces * align4(imageSize) : align4(imageSize);
+        if (offset + imageSize > size) throw error("truncated");
+
+        m_levels.emplace_back(data + offset, imageSize);
+        offset += levelSize;
+    }
+}
+
+} // namespace gfx
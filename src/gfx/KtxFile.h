@@ -0,0 +1,60 @@
+#ifndef GFX_KTXFILE_H
+#define GFX_KTXFILE_H
+
+#include "../Vfs.h"
+
+#include <GL/glew.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <string_view>
+#include <vector>
+
+namespace gfx {
+
+/**
+ * @brief KTX 1.1 file read through Vfs with index of its mip levels.
+ *
+ * Only header and level sizes are read on open, pixel data is touched when a level is accessed.
+ * Throws std::runtime_error for files that are not KTX 1.1 or are truncated.
+ */
+class KtxFile final
+{
+  public:
+    explicit KtxFile(const std::filesystem::path& file);
+
+    GLenum glType() const { return m_glType; }
+    GLenum glFormat() const { return m_glFormat; }
+    GLenum glInternalFormat() const { return m_glInternalFormat; }
+    bool isCompressed() const { return m_glType == 0; }
+
+    int width() const { return m_width; }
+    int height() const { return m_height; }
+    int levels() const { return static_cast<int>(m_levels.size()); }
+
+    int width(int level) const { return std::max(1, m_width >> level); }
+    int height(int level) const { return std::max(1, m_height >> level); }
+
+    /// Plain 2D texture (no array, cube map or depth). Only those can be streamed.
+    bool is2D() const { return m_is2D; }
+
+    /// Image data of given level (first face and layer)
+    std::string_view level(int level) const { return m_levels.at(level); }
+
+  private:
+    FileData m_file;
+
+    GLenum m_glType           = 0;
+    GLenum m_glFormat         = 0;
+    GLenum m_glInternalFormat = 0;
+    int m_width               = 0;
+    int m_height              = 0;
+    bool m_is2D               = false;
+
+    std::vector<std::string_view> m_levels;
+};
+
+} // namespace gfx
+
+#endif // GFX_KTXFILE_H
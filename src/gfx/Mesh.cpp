@@ -2,6 +2,7 @@
 
 #include "../Logger.h"
 
+#include <algorithm>
 #include <array>
 #include <cstring>
 #include <limits>
@@ -53,6 +54,11 @@ Primitive::Primitive(Primitive&& other)
     std::swap(m_activeTargets, other.m_activeTargets);
     std::swap(m_activeTargetsDirty, other.m_activeTargetsDirty);
     std::swap(m_material, other.m_material);
+    std::swap(m_uvDensity, other.m_uvDensity);
+    std::swap(m_dequantization, other.m_dequantization);
+    std::swap(m_meshlets, other.m_meshlets);
+    std::swap(m_drawCounts, other.m_drawCounts);
+    std::swap(m_drawOffsets, other.m_drawOffsets);
 }
 
 //------------------------------------------------------------------------------
@@ -67,7 +73,7 @@ Primitive::~Primitive()
 
 //------------------------------------------------------------------------------
 
-void Primitive::draw(ShaderProgram* shaderProgram)
+void Primitive::draw(ShaderProgram* shaderProgram, const Culling* culling)
 {
     shaderProgram->use();
     m_material.applyTo(shaderProgram);
@@ -81,6 +87,11 @@ void Primitive::draw(ShaderProgram* shaderProgram)
 
     if (m_indices.count == 0) {
         glDrawArrays(m_mode, 0, m_attributes[Accessor::Attribute::Position].count);
+    } else if (culling && !m_meshlets.empty()) {
+        cull(*culling);
+        if (!m_drawCounts.empty())
+            glMultiDrawElements(m_mode, m_drawCounts.data(), m_indices.type, m_drawOffsets.data(),
+                                static_cast<GLsizei>(m_drawCounts.size()));
     } else {
         glDrawElements(m_mode, m_indices.count, m_indices.type, (const void*)m_indices.byteOffset);
     }
@@ -90,9 +101,46 @@ void Primitive::draw(ShaderProgram* shaderProgram)
 
 //------------------------------------------------------------------------------
 
+/// Component of normalized or integer attribute converted to float
+static float readComponent(const uint8_t* ptr, GLenum type, bool normalized)
+{
+    const auto read = [ptr](auto value) {
+        std::memcpy(&value, ptr, sizeof(value));
+        return static_cast<float>(value);
+    };
+
+    switch (type) {
+    case GL_BYTE: return normalized ? std::max(read(int8_t{}) / 127.0f, -1.0f) : read(int8_t{});
+    case GL_UNSIGNED_BYTE: return normalized ? read(uint8_t{}) / 255.0f : read(uint8_t{});
+    case GL_SHORT:
+        return normalized ? std::max(read(int16_t{}) / 32767.0f, -1.0f) : read(int16_t{});
+    case GL_UNSIGNED_SHORT: return normalized ? read(uint16_t{}) / 65535.0f : read(uint16_t{});
+    default: return read(float{});
+    }
+}
+
 std::vector<glm::vec3> Primitive::positions() const
 {
-    return m_attributes[Accessor::Attribute::Position].getData<glm::vec3>();
+    const Accessor& acc = m_attributes[Accessor::Attribute::Position];
+    if (acc.count == 0) return {};
+    if (acc.type == GL_FLOAT && acc.size == 3 && m_dequantization == glm::mat4{1.0f})
+        return acc.getData<glm::vec3>();
+
+    const std::size_t elementSize = acc.typeSize() * acc.size;
+    const std::size_t byteStride  = acc.buffer->m_byteStride;
+    const std::size_t stride      = byteStride ? byteStride : elementSize;
+
+    std::vector<uint8_t> raw(stride * (acc.count - 1) + elementSize);
+    acc.buffer->getData(raw.data(), raw.size(), acc.byteOffset);
+
+    std::vector<glm::vec3> ans(acc.count);
+    for (std::size_t i = 0; i < ans.size(); ++i) {
+        glm::vec3 p;
+        for (unsigned c = 0; c < 3; ++c)
+            p[c] = readComponent(&raw[i * stride + c * acc.typeSize()], acc.type, acc.normalized);
+        ans[i] = glm::vec3{m_dequantization * glm::vec4{p, 1.0f}};
+    }
+    return ans;
 }
 
 //------------------------------------------------------------------------------
@@ -102,16 +150,94 @@ Aabb Primitive::aabb(const glm::mat4& transformation) const
     auto minPos = m_attributes[Accessor::Attribute::Position].min;
     auto maxPos = m_attributes[Accessor::Attribute::Position].max;
 
-    return transformation *
+    return transformation * m_dequantization *
            Aabb{{minPos[0], minPos[1], minPos[2]}, {maxPos[0], maxPos[1], maxPos[2]}};
 }
 
 //------------------------------------------------------------------------------
 
+void Primitive::requestTextureDetail(const glm::mat4& modelView, float pixelScale) const
+{
+    if (m_uvDensity <= 0.0f) return;
+
+    // Distance from camera to the closest point of bounding box
+    const Aabb& box          = aabb(modelView);
+    const glm::vec3& closest = glm::clamp(glm::vec3{0.0f}, box.minimum, box.maximum);
+    const float distance     = std::max(glm::length(closest), 0.1f);
+
+    // Largest scale of model view matrix gives the most detailed request
+    const float scale = std::max({glm::length(glm::vec3{modelView[0]}),
+                                  glm::length(glm::vec3{modelView[1]}),
+                                  glm::length(glm::vec3{modelView[2]})});
+    if (scale <= 0.0f) return;
+
+    const float uvPerPixel = m_uvDensity * distance / (pixelScale * scale);
+
+    for (const auto& texture : m_material.textures) {
+        if (texture && texture->isStreamed()) texture->requestDetail(uvPerPixel);
+    }
+}
+
+//------------------------------------------------------------------------------
+
 void Primitive::setMaterial(const Material& material) { m_material = material; }
 
 //------------------------------------------------------------------------------
 
+void Primitive::cull(const Culling& culling)
+{
+    const glm::mat4& modelView = culling.modelView;
+    // Back faces of double sided material are visible
+    const bool backFaces = culling.backFaces && !m_material.doubleSided;
+
+    // Frustum planes in view space (Gribb, Hartmann), normalized for sphere distance
+    const glm::mat4 P = glm::transpose(culling.projection);
+
+    std::array<glm::vec4, 6> planes = {P[3] + P[0], P[3] - P[0], P[3] + P[1],
+                                       P[3] - P[1], P[3] + P[2], P[3] - P[2]};
+    for (auto& plane : planes)
+        plane /= glm::length(glm::vec3{plane});
+
+    const glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3{modelView}));
+
+    const float scale = std::max({glm::length(glm::vec3{modelView[0]}),
+                                  glm::length(glm::vec3{modelView[1]}),
+                                  glm::length(glm::vec3{modelView[2]})});
+
+    const std::size_t indexSize = m_indices.typeSize();
+    m_drawCounts.clear();
+    m_drawOffsets.clear();
+    uint32_t rangeEnd = ~0u;
+
+    for (const Meshlet& meshlet : m_meshlets) {
+        const glm::vec3 center = glm::vec3{modelView * glm::vec4{meshlet.center, 1.0f}};
+        const float radius     = meshlet.radius * scale;
+
+        const bool outside = std::any_of(planes.cbegin(), planes.cend(), [&](const glm::vec4& p) {
+            return glm::dot(glm::vec3{p}, center) + p.w < -radius;
+        });
+        if (outside) continue;
+
+        // Camera is at origin of view space
+        if (backFaces && meshlet.coneCutoff < 1.0f) {
+            const glm::vec3 apex = glm::vec3{modelView * glm::vec4{meshlet.coneApex, 1.0f}};
+            const glm::vec3 axis = glm::normalize(normalMatrix * meshlet.coneAxis);
+            if (glm::dot(glm::normalize(apex), axis) >= meshlet.coneCutoff) continue;
+        }
+
+        if (meshlet.firstIndex == rangeEnd) {
+            m_drawCounts.back() += meshlet.indexCount;
+        } else {
+            m_drawCounts.push_back(meshlet.indexCount);
+            m_drawOffsets.push_back(reinterpret_cast<const void*>(
+                m_indices.byteOffset + std::ptrdiff_t(meshlet.firstIndex * indexSize)));
+        }
+        rangeEnd = meshlet.firstIndex + meshlet.indexCount;
+    }
+}
+
+//------------------------------------------------------------------------------
+
 void Primitive::setActiveTargets(const std::array<int, 3>& targets)
 {
     if (m_activeTargets != targets) {
@@ -174,11 +300,15 @@ Mesh::Mesh(Mesh&& other)
 
 //------------------------------------------------------------------------------
 
-void Mesh::draw(ShaderProgram* shaderProgram) { draw(shaderProgram, m_weights); }
+void Mesh::draw(ShaderProgram* shaderProgram, const Culling* culling)
+{
+    draw(shaderProgram, m_weights, culling);
+}
 
 //------------------------------------------------------------------------------
 
-void Mesh::draw(ShaderProgram* shaderProgram, const std::vector<float>& weights)
+void Mesh::draw(ShaderProgram* shaderProgram, const std::vector<float>& weights,
+                const Culling* culling)
 {
     shaderProgram->use();
 
@@ -193,7 +323,7 @@ void Mesh::draw(ShaderProgram* shaderProgram, const std::vector<float>& weights)
 
     for (auto& primitive : m_primitives) {
         primitive.setActiveTargets(activeTargets);
-        primitive.draw(shaderProgram);
+        primitive.draw(shaderProgram, culling);
     }
 }
 
@@ -221,6 +351,22 @@ Aabb Mesh::aabb(const glm::mat4& transformation) const
 
 //------------------------------------------------------------------------------
 
+const glm::mat4& Mesh::dequantization() const
+{
+    static const glm::mat4 identity{1.0f};
+    return m_primitives.empty() ? identity : m_primitives.front().dequantization();
+}
+
+//------------------------------------------------------------------------------
+
+void Mesh::requestTextureDetail(const glm::mat4& modelView, float pixelScale) const
+{
+    for (const auto& primitive : m_primitives)
+        primitive.requestTextureDetail(modelView, pixelScale);
+}
+
+//------------------------------------------------------------------------------
+
 void Mesh::setWeights(const std::vector<float>& weights) { m_weights = weights; }
 
 //------------------------------------------------------------------------------
@@ -11,6 +11,30 @@
 
 namespace gfx {
 
+/// Cluster of triangles stored in continuous range of index buffer
+struct Meshlet
+{
+    uint32_t firstIndex = 0;
+    uint32_t indexCount = 0;
+
+    glm::vec3 center{0.0f}; //< Bounding sphere in model space
+    float radius = 0.0f;
+
+    glm::vec3 coneApex{0.0f}; //< Normal cone for back-face test
+    glm::vec3 coneAxis{0.0f};
+    float coneCutoff = 1.0f; //< Back-facing when dot(normalize(apex - eye), axis) >= cutoff
+};
+
+/// View meshlets are culled against while drawing
+struct Culling
+{
+    glm::mat4 projection{1.0f};
+    glm::mat4 modelView{1.0f}; //< Set by Node for each instance it draws
+    bool backFaces = true;     //< Normal cone test, off when back faces are visible
+};
+
+//------------------------------------------------------------------------------
+
 class Primitive final
 {
     OSTREAM_FRIEND(Primitive);
@@ -29,18 +53,43 @@ class Primitive final
 
     ~Primitive();
 
-    void draw(ShaderProgram* shaderProgram);
+    /**
+     * @brief Draws whole primitive or, with culling, its visible meshlets.
+     *
+     * Rejects meshlets outside of view frustum and, unless material is double sided, back-facing
+     * ones. Adjacent ranges are merged and drawn with one glMultiDrawElements.
+     */
+    void draw(ShaderProgram* shaderProgram, const Culling* culling = nullptr);
 
+    /// Model space positions, dequantized
     std::vector<glm::vec3> positions() const;
     Aabb aabb(const glm::mat4& transformation) const;
 
+    /// Transformation of quantized positions to model space, identity for float positions
+    void setDequantization(const glm::mat4& dequantization) { m_dequantization = dequantization; }
+    const glm::mat4& dequantization() const { return m_dequantization; }
+
+    /// Passes on-screen texture detail to streamed textures of material. pixelScale is
+    /// projection scale in pixels at unit distance.
+    void requestTextureDetail(const glm::mat4& modelView, float pixelScale) const;
+
     void setMaterial(const Material& material);
 
+    /// Ranges of indices for culling, empty draws all indices
+    void setMeshlets(std::vector<Meshlet> meshlets) { m_meshlets = std::move(meshlets); }
+    std::size_t meshletsSize() const { return m_meshlets.size(); }
+
+    /// Texture coordinate units per model space unit, 0 if unknown
+    void setUvDensity(float uvDensity) { m_uvDensity = uvDensity; }
+    float uvDensity() const { return m_uvDensity; }
+
     std::size_t targetsSize() const { return m_targets.size(); }
     // Sets indices of active morph targets.
     void setActiveTargets(const std::array<int, 3>& targets);
 
   private:
+    /// Fills m_drawCounts and m_drawOffsets with visible ranges
+    void cull(const Culling& culling);
     void setVertexAttribute(int index, const Accessor& acc);
     void updateActiveTargets();
 
@@ -51,10 +100,16 @@ class Primitive final
     GLenum m_mode = GL_TRIANGLES;
 
     Material m_material;
+    float m_uvDensity = 0.0f;
+    glm::mat4 m_dequantization{1.0f};
 
     std::vector<MorphTarget> m_targets;
     std::array<int, 3> m_activeTargets;
     bool m_activeTargetsDirty = true;
+
+    std::vector<Meshlet> m_meshlets;
+    std::vector<GLsizei> m_drawCounts; //< Filled by cull() and drawn in the same draw()
+    std::vector<const void*> m_drawOffsets;
 };
 
 OSTREAM_IMPL_1(gfx::Primitive, m_vao)
@@ -75,12 +130,18 @@ class Mesh final
     Mesh& operator=(const Mesh&) = delete;
     Mesh& operator=(Mesh&&) = delete;
 
-    void draw(ShaderProgram* shaderProgram);
-    void draw(ShaderProgram* shaderProgram, const std::vector<float>& weights);
+    void draw(ShaderProgram* shaderProgram, const Culling* culling = nullptr);
+    void draw(ShaderProgram* shaderProgram, const std::vector<float>& weights,
+              const Culling* culling = nullptr);
 
     std::vector<glm::vec3> positions() const;
     Aabb aabb(const glm::mat4& transformation) const;
 
+    /// Applied before model view matrix, all primitives of a mesh share it
+    const glm::mat4& dequantization() const;
+
+    void requestTextureDetail(const glm::mat4& modelView, float pixelScale) const;
+
     void setWeights(const std::vector<float>& weights);
     std::size_t getWeightsSize() const;
 
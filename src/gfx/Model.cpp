@@ -3,7 +3,8 @@
 namespace gfx {
 
 void Model::draw(const glm::mat4& transformation, ShaderProgram* shaderProgram,
-                 std::array<Light*, 8>& lights, const TexturePack& environment)
+                 std::array<Light*, 8>& lights, const TexturePack& environment,
+                 const Culling* culling)
 {
     shaderProgram->use();
 
@@ -22,7 +23,7 @@ void Model::draw(const glm::mat4& transformation, ShaderProgram* shaderProgram,
 
     for (const auto& scene : m_scenes)
         for (auto rootIdx : scene)
-            getNode(rootIdx)->draw(transformation, shaderProgram, lights);
+            getNode(rootIdx)->draw(transformation, shaderProgram, lights, culling);
 }
 
 void Model::drawAabb(const glm::mat4& transformation, ShaderProgram* shaderProgram)
@@ -62,6 +63,13 @@ Aabb Model::aabb(const glm::mat4& transformation) const
     return aabb;
 }
 
+void Model::requestTextureDetail(const glm::mat4& modelView, float pixelScale) const
+{
+    for (const auto& scene : m_scenes)
+        for (auto rootIdx : scene)
+            getNode(rootIdx)->requestTextureDetail(modelView, pixelScale);
+}
+
 int Model::addNode(Node node, Node* parent)
 {
     if (parent->getModel() != this) throw std::invalid_argument{"parent not part of model"};
@@ -11,6 +11,7 @@
 
 namespace loaders {
 class GltfLoader;
+class ObjLoader;
 } // namespace loaders
 
 namespace gfx {
@@ -18,15 +19,22 @@ namespace gfx {
 class Model final
 {
     friend class loaders::GltfLoader;
+    friend class loaders::ObjLoader;
 
   public:
     void update(float delta);
     void draw(const glm::mat4& transformation, ShaderProgram* shaderProgram,
-              std::array<Light*, 8>& lights, const TexturePack& environment);
+              std::array<Light*, 8>& lights, const TexturePack& environment,
+              const Culling* culling = nullptr);
     void drawAabb(const glm::mat4& transformation, ShaderProgram* shaderProgram);
 
     Aabb aabb(const glm::mat4& transformation) const;
 
+    /// Draw feedback for texture streaming, see Primitive::requestTextureDetail
+    void requestTextureDetail(const glm::mat4& modelView, float pixelScale) const;
+
+    const std::vector<std::shared_ptr<Texture>>& textures() const { return m_textures; }
+
     Buffer* getBuffer(int idx) { return m_buffers.at(idx).get(); }
     Sampler* getSampler(int idx) { return m_samplers.at(idx).get(); }
     Texture* getTexture(int idx) { return m_textures.at(idx).get(); }
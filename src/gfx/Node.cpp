@@ -72,13 +72,15 @@ void Node::setModelMatrix(const glm::mat4& mtx)
 //------------------------------------------------------------------------------
 
 void Node::draw(const glm::mat4& transformation, ShaderProgram* shaderProgram,
-                std::array<Light*, 8>& lights) const
+                std::array<Light*, 8>& lights, const Culling* culling) const
 {
     const auto& worldMatrix  = transformation * m_modelMatrix;
     const auto& normalMatrix = glm::transpose(glm::inverse(glm::mat3(worldMatrix)));
 
     if (m_model && m_mesh != -1) {
         auto mesh = m_model->getMesh(m_mesh);
+        // Normal matrix stays without it, quantized normals are in model space
+        const auto& dequantization = mesh->dequantization();
 
         shaderProgram->use();
 
@@ -89,7 +91,8 @@ void Node::draw(const glm::mat4& transformation, ShaderProgram* shaderProgram,
 
                 const auto& lightMVPIndex = "lightMVP[" + std::to_string(i) + "]";
                 shaderProgram->setUniform(lightMVPIndex, light.projectionMatrix() *
-                                                             light.viewMatrix() * m_modelMatrix);
+                                                             light.viewMatrix() * m_modelMatrix *
+                                                             dequantization);
             }
         }
 
@@ -107,18 +110,26 @@ void Node::draw(const glm::mat4& transformation, ShaderProgram* shaderProgram,
             shaderProgram->setUniform(jointMatIndex, jointMatrices[i]);
         }
 
-        shaderProgram->setUniform("modelViewMatrix", worldMatrix);
+        shaderProgram->setUniform("modelViewMatrix", worldMatrix * dequantization);
         shaderProgram->setUniform("normalMatrix", normalMatrix);
 
+        // Mesh can be shared by many nodes, each instance is culled with its own matrix
+        Culling instanceCulling;
+        if (culling) {
+            instanceCulling           = *culling;
+            instanceCulling.modelView = worldMatrix;
+        }
+        const Culling* meshCulling = culling ? &instanceCulling : nullptr;
+
         if (!m_weights.empty())
-            mesh->draw(shaderProgram, m_weights);
+            mesh->draw(shaderProgram, m_weights, meshCulling);
         else
-            mesh->draw(shaderProgram); // draw with default weights
+            mesh->draw(shaderProgram, meshCulling); // draw with default weights
     }
 
     for (auto child : m_children) {
         auto n = m_model->getNode(child);
-        n->draw(worldMatrix, shaderProgram, lights);
+        n->draw(worldMatrix, shaderProgram, lights, culling);
     }
 }
 
@@ -160,6 +171,20 @@ Aabb Node::aabb(const glm::mat4& transformation) const
 
 //------------------------------------------------------------------------------
 
+void Node::requestTextureDetail(const glm::mat4& transformation, float pixelScale) const
+{
+    const auto& tm = transformation * m_modelMatrix;
+
+    if (m_model && m_mesh != -1) m_model->getMesh(m_mesh)->requestTextureDetail(tm, pixelScale);
+
+    for (auto child : m_children) {
+        auto n = m_model->getNode(child);
+        n->requestTextureDetail(tm, pixelScale);
+    }
+}
+
+//------------------------------------------------------------------------------
+
 void Node::drawAabb(const glm::mat4& transformation, ShaderProgram* shaderProgram) const
 {
     const auto& worldMatrix  = transformation * m_modelMatrix;
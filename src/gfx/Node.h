@@ -16,6 +16,7 @@ namespace gfx {
 class Model;
 class Camera;
 class Light;
+struct Culling;
 
 class Node final
 {
@@ -42,8 +43,9 @@ class Node final
     glm::mat4 getModelMatrix() const { return m_modelMatrix; }
     glm::mat4 getWorldMatrix() const { return m_worldMatrix; }
 
+    /// With culling, meshlets of each mesh instance are culled right before it is drawn
     void draw(const glm::mat4& transformation, ShaderProgram* shaderProgram,
-              std::array<Light*, 8>& lights) const;
+              std::array<Light*, 8>& lights, const Culling* culling = nullptr) const;
 
     void drawAabb(const glm::mat4& transformation, ShaderProgram* shaderProgram) const;
 
@@ -51,6 +53,8 @@ class Node final
 
     Aabb aabb(const glm::mat4& transformation) const;
 
+    void requestTextureDetail(const glm::mat4& transformation, float pixelScale) const;
+
     void setCastShadows(bool castsShadows) { m_castsShadows = castsShadows; }
     bool castsShadows() const { return m_castsShadows; }
 
@@ -1,5 +1,10 @@
 #include "Texture.h"
 
+#include "../Vfs.h"
+#include "GpuMemory.h"
+#include "Ktx2Image.h"
+#include "KtxFile.h"
+
 #include <gli/gl.hpp>
 #include <gli/gli.hpp>
 #include <glm/glm.hpp>
@@ -7,6 +12,7 @@
 #include <glm/gtx/string_cast.hpp>
 
 #include <array>
+#include <cmath>
 #include <map>
 
 namespace gfx {
@@ -92,7 +98,16 @@ Texture::Texture(GLenum target, const std::string& _name)
 Texture::Texture(const std::filesystem::path& file, const std::string& _name)
     : Texture{GL_TEXTURE_2D, _name.empty() ? file.filename().string() : _name}
 {
-    createTexture(file.string().c_str());
+    m_file = file;
+    createTexture(m_file.string().c_str());
+}
+
+Texture::Texture(const Ktx2Image& image, const std::filesystem::path& file,
+                 const std::string& _name)
+    : Texture{GL_TEXTURE_2D, _name.empty() ? file.filename().string() : _name}
+{
+    m_file = file;
+    createTexture(image);
 }
 
 Texture::Texture(glm::vec3 color)
@@ -101,6 +116,7 @@ Texture::Texture(glm::vec3 color)
     m_w = m_h = 1;
     glBindTexture(m_target, m_textureId);
     glTexImage2D(m_target, 0, GL_RGB, m_w, m_h, 0, GL_RGB, GL_FLOAT, glm::value_ptr(color));
+    addBytes(3);
 }
 
 Texture::Texture(Texture&& other)
@@ -109,6 +125,14 @@ Texture::Texture(Texture&& other)
     std::swap(m_textureId, other.m_textureId);
     std::swap(m_w, other.m_w);
     std::swap(m_h, other.m_h);
+    std::swap(m_levels, other.m_levels);
+    std::swap(m_ktx, other.m_ktx);
+    std::swap(m_baseLevel, other.m_baseLevel);
+    std::swap(m_requestedLevel, other.m_requestedLevel);
+    std::swap(m_file, other.m_file);
+    std::swap(m_residentSize, other.m_residentSize);
+    std::swap(m_byteSize, other.m_byteSize);
+    std::swap(m_lastUsed, other.m_lastUsed);
     std::swap(m_sampler, other.m_sampler);
     std::swap(name, other.name);
 }
@@ -118,6 +142,7 @@ Texture::Texture(Texture&& other)
 Texture::~Texture()
 {
     glDeleteTextures(1, &m_textureId);
+    GpuMemory::released(GpuMemory::Textures, m_byteSize);
 
     if (m_textureId) LOG_RELEASED;
 }
@@ -131,6 +156,7 @@ Texture Texture::createShadowMap(glm::ivec2 size)
     glBindTexture(tex.m_target, tex.m_textureId);
     glTexImage2D(tex.m_target, 0, GL_DEPTH_COMPONENT16, size.x, size.y, 0, GL_DEPTH_COMPONENT,
                  GL_FLOAT, NULL);
+    tex.addBytes(std::size_t(size.x) * size.y * 2);
 
     auto sampler = std::make_shared<Sampler>();
 
@@ -150,6 +176,7 @@ Texture Texture::createShadowMap(glm::ivec3 size)
     glBindTexture(tex.m_target, tex.m_textureId);
     glTexImage3D(tex.m_target, 0, GL_DEPTH_COMPONENT16, size.x, size.y, size.z, 0,
                  GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+    tex.addBytes(std::size_t(size.x) * size.y * size.z * 2);
 
     auto sampler = std::make_shared<Sampler>();
 
@@ -164,6 +191,154 @@ Texture Texture::createShadowMap(glm::ivec3 size)
 
 //------------------------------------------------------------------------------
 
+Texture Texture::createStreamed(const std::filesystem::path& file, const std::string& name,
+                                int residentSize)
+{
+    Texture tex{GL_TEXTURE_2D, name.empty() ? file.filename().string() : name};
+    tex.m_file         = file;
+    tex.m_residentSize = std::max(1, residentSize);
+    tex.loadStreamed();
+    return tex;
+}
+
+void Texture::loadStreamed()
+{
+    std::shared_ptr<const KtxFile> ktx;
+    if (m_file.extension() == ".ktx") {
+        try {
+            ktx = std::make_shared<KtxFile>(m_file);
+        } catch (const std::runtime_error& e) {
+            LOG_WARNING("{}", e.what());
+        }
+    }
+
+    if (!ktx || !ktx->is2D() || ktx->levels() == 1) {
+        createTexture(m_file.string().c_str());
+        return;
+    }
+
+    m_target = GL_TEXTURE_2D;
+    m_w      = ktx->width();
+    m_h      = ktx->height();
+    m_levels = ktx->levels();
+    m_ktx    = ktx;
+
+    int first = m_levels - 1;
+    while (first > 0 && std::max(ktx->width(first - 1), ktx->height(first - 1)) <= m_residentSize)
+        --first;
+
+    // Mutable storage, levels that were never uploaded take no memory
+    glBindTexture(m_target, m_textureId);
+    glTexParameteri(m_target, GL_TEXTURE_MAX_LEVEL, m_levels - 1);
+
+    m_baseLevel      = m_levels;
+    m_requestedLevel = m_levels;
+    for (int level = m_levels - 1; level >= first; --level) {
+        const auto data = ktx->level(level);
+        uploadLevel(level, data.data(), data.size());
+    }
+    m_baseLevel = first;
+    glTexParameteri(m_target, GL_TEXTURE_BASE_LEVEL, first);
+
+    if (first == 0) finishStreaming();
+}
+
+//------------------------------------------------------------------------------
+
+bool Texture::evict()
+{
+    if (!isEvictable() || !isResident()) return false;
+
+    glDeleteTextures(1, &m_textureId);
+    m_textureId = 0;
+
+    GpuMemory::released(GpuMemory::Textures, m_byteSize);
+    m_byteSize = 0;
+    m_ktx.reset();
+
+    LOG_DEBUG("Evicted texture {}", name);
+    return true;
+}
+
+void Texture::reload()
+{
+    LOG_DEBUG("Reloading texture {}", name);
+
+    glGenTextures(1, &m_textureId);
+    try {
+        if (m_residentSize > 0)
+            loadStreamed();
+        else
+            createTexture(m_file.string().c_str());
+    } catch (const std::runtime_error& e) {
+        // Keep empty texture, do not try again every frame
+        LOG_ERROR("{}", e.what());
+        m_file.clear();
+    }
+}
+
+void Texture::addBytes(std::size_t bytes)
+{
+    m_byteSize += bytes;
+    GpuMemory::allocated(GpuMemory::Textures, bytes);
+}
+
+//------------------------------------------------------------------------------
+
+void Texture::requestDetail(float uvPerPixel)
+{
+    const float texelsPerPixel = uvPerPixel * std::max(m_w, m_h);
+    const int level =
+        texelsPerPixel > 1.0f ? static_cast<int>(std::floor(std::log2(texelsPerPixel))) : 0;
+
+    m_requestedLevel = std::min(m_requestedLevel, std::min(level, m_levels - 1));
+}
+
+int Texture::takeRequestedLevel()
+{
+    const int level  = m_requestedLevel;
+    m_requestedLevel = m_levels;
+    return level;
+}
+
+void Texture::uploadLevels(int first, const std::vector<std::vector<char>>& data)
+{
+    // Evicted while levels were being read
+    if (!isResident() || !isStreamed()) return;
+
+    const int last = std::min(first + static_cast<int>(data.size()), m_baseLevel);
+    if (first >= last) return;
+
+    glBindTexture(m_target, m_textureId);
+    // Levels go from the smallest so texture stays complete
+    for (int level = last - 1; level >= first; --level) {
+        const auto& levelData = data[level - first];
+        uploadLevel(level, levelData.data(), levelData.size());
+    }
+
+    m_baseLevel = first;
+    glTexParameteri(m_target, GL_TEXTURE_BASE_LEVEL, m_baseLevel);
+
+    if (m_baseLevel == 0) finishStreaming();
+}
+
+void Texture::uploadLevel(int level, const char* data, std::size_t size)
+{
+    const GLsizei w = std::max(1, m_w >> level);
+    const GLsizei h = std::max(1, m_h >> level);
+
+    if (m_ktx->isCompressed())
+        glCompressedTexImage2D(m_target, level, m_ktx->glInternalFormat(), w, h, 0,
+                               static_cast<GLsizei>(size), data);
+    else
+        glTexImage2D(m_target, level, m_ktx->glInternalFormat(), w, h, 0, m_ktx->glFormat(),
+                     m_ktx->glType(), data);
+
+    addBytes(size);
+}
+
+//------------------------------------------------------------------------------
+
 // std::shared_ptr<Texture> Texture::getOnePixel(glm::vec3 color)
 // {
 //     static std::map<std::string, std::weak_ptr<Texture>> onePixTexMap;
@@ -182,6 +357,9 @@ Texture Texture::createShadowMap(glm::ivec3 size)
 
 void Texture::bind(int textureUnit)
 {
+    if (!isResident() && isEvictable()) reload();
+    m_lastUsed = GpuMemory::frame();
+
     if (!m_sampler) m_sampler = Sampler::getDefault(m_levels > 1);
 
     m_sampler->bind(textureUnit);
@@ -191,10 +369,16 @@ void Texture::bind(int textureUnit)
 
 //------------------------------------------------------------------------------
 
-// Filename can be KTX or DDS files
+// Filename can be KTX, KTX2 (Basis Universal) or DDS files
 void Texture::createTexture(const char* filename)
 {
-    gli::texture tex = gli::load(filename);
+    if (Ktx2Image::isKtx2(filename)) {
+        createTexture(Ktx2Image::transcode(filename, TextureCaps::query()));
+        return;
+    }
+
+    const FileData data = Vfs::global().read(filename);
+    gli::texture tex    = gli::load(data.data(), data.size());
     if (tex.empty()) throw std::runtime_error("Texture load error: " + std::string(filename));
 
     gli::gl GL(gli::gl::PROFILE_GL33);
@@ -216,6 +400,7 @@ void Texture::createTexture(const char* filename)
     m_w      = extent.x;
     m_h      = extent.y;
     m_levels = tex.levels();
+    addBytes(tex.size());
 
     switch (tex.target()) {
     case gli::TARGET_1D:
@@ -290,4 +475,31 @@ void Texture::createTexture(const char* filename)
     }
 }
 
+void Texture::createTexture(const Ktx2Image& image)
+{
+    m_target = GL_TEXTURE_2D;
+    m_w      = image.width;
+    m_h      = image.height;
+    m_levels = static_cast<int>(image.levels.size());
+
+    glBindTexture(m_target, m_textureId);
+    glTexParameteri(m_target, GL_TEXTURE_BASE_LEVEL, 0);
+    glTexParameteri(m_target, GL_TEXTURE_MAX_LEVEL, m_levels - 1);
+    glTexStorage2D(m_target, m_levels, image.internalFormat, m_w, m_h);
+
+    for (int level = 0; level < m_levels; ++level) {
+        const auto& data = image.levels[level];
+        const GLsizei w  = std::max(1, m_w >> level);
+        const GLsizei h  = std::max(1, m_h >> level);
+
+        if (image.isCompressed())
+            glCompressedTexSubImage2D(m_target, level, 0, 0, w, h, image.internalFormat,
+                                      static_cast<GLsizei>(data.size()), data.data());
+        else
+            glTexSubImage2D(m_target, level, 0, 0, w, h, image.format, image.type, data.data());
+    }
+
+    addBytes(image.byteSize());
+}
+
 } // namespace gfx
@@ -10,9 +10,13 @@
 #include <filesystem>
 #include <memory>
 #include <string>
+#include <vector>
 
 namespace gfx {
 
+class KtxFile;
+struct Ktx2Image;
+
 class Sampler final
 {
     OSTREAM_FRIEND(Sampler);
@@ -52,6 +56,9 @@ class Texture final
 
   public:
     Texture(const std::filesystem::path& file, const std::string& name = "");
+    /// Uploads image transcoded from file, file is used for reload after eviction
+    Texture(const Ktx2Image& image, const std::filesystem::path& file,
+            const std::string& name = "");
     // Creates one pixel texture
     Texture(glm::vec3 color);
     Texture(const Texture&) = delete;
@@ -63,10 +70,47 @@ class Texture final
     static Texture createShadowMap(glm::ivec2 size);
     static Texture createShadowMap(glm::ivec3 size);
 
+    /**
+     * @brief Creates texture with only low resolution mips resident.
+     *
+     * Levels not bigger than residentSize are uploaded now, the rest is loaded on request by
+     * TextureStreamer. Sampling is clamped to resident levels with GL_TEXTURE_BASE_LEVEL. Files
+     * other than 2D KTX 1.1 (including KTX2) are loaded fully.
+     */
+    static Texture createStreamed(const std::filesystem::path& file, const std::string& name = "",
+                                  int residentSize = 128);
+
     void bind(int textureUnit);
 
     int width() const { return m_w; }
     int height() const { return m_h; }
+    int levels() const { return m_levels; }
+
+    bool isStreamed() const { return m_ktx != nullptr; }
+    /// Most detailed resident level
+    int baseLevel() const { return m_baseLevel; }
+
+    /// Draw feedback. uvPerPixel is change of texture coordinates between screen pixels.
+    void requestDetail(float uvPerPixel);
+    /// Most detailed level requested since last call, levels() if none
+    int takeRequestedLevel();
+
+    const std::shared_ptr<const KtxFile>& ktxFile() const { return m_ktx; }
+    /// Uploads levels [first, baseLevel()) and makes them resident. data[i] is level first + i.
+    void uploadLevels(int first, const std::vector<std::vector<char>>& data);
+    /// Stops streaming, resident levels stay as they are
+    void finishStreaming() { m_ktx.reset(); }
+
+    /// Bytes of GPU memory of uploaded levels
+    std::size_t byteSize() const { return m_byteSize; }
+    /// GpuMemory::frame() of the last bind
+    uint32_t lastUsed() const { return m_lastUsed; }
+
+    /// Texture loaded from file can release its GPU memory, it is loaded again on next bind
+    bool isEvictable() const { return !m_file.empty(); }
+    bool isResident() const { return m_textureId != 0; }
+    /// Returns false if texture is not evictable or already evicted
+    bool evict();
 
     void setSampler(std::shared_ptr<Sampler> sampler) { m_sampler = sampler; }
     std::shared_ptr<Sampler> sampler() { return m_sampler; }
@@ -75,6 +119,11 @@ class Texture final
 
   private:
     void createTexture(const char* filename);
+    void createTexture(const Ktx2Image& image);
+    void loadStreamed();
+    void reload();
+    void uploadLevel(int level, const char* data, std::size_t size);
+    void addBytes(std::size_t bytes);
 
     Texture(GLenum target, const std::string& name = "");
 
@@ -85,6 +134,15 @@ class Texture final
     int m_h      = -1;
     int m_levels = 1;
 
+    std::shared_ptr<const KtxFile> m_ktx; //< Source of not resident levels, null if not streamed
+    int m_baseLevel      = 0;
+    int m_requestedLevel = 0;
+
+    std::filesystem::path m_file; //< Source for reload after eviction
+    int m_residentSize     = 0;   //< Streamed when > 0, see createStreamed
+    std::size_t m_byteSize = 0;
+    uint32_t m_lastUsed    = 0;
+
     std::shared_ptr<Sampler> m_sampler;
 };
 
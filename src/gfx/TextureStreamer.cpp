@@ -0,0 +1,133 @@
+#include "TextureStreamer.h"
+
+#include "../Logger.h"
+#include "../ThreadPool.h"
+#include "KtxFile.h"
+#include "Texture.h"
+
+#include <algorithm>
+
+namespace gfx {
+
+TextureStreamer::TextureStreamer(std::size_t uploadBudget)
+    : m_uploadBudget{uploadBudget}
+{
+}
+
+TextureStreamer::~TextureStreamer()
+{
+    for (auto& load : m_loads)
+        load.wait();
+}
+
+//------------------------------------------------------------------------------
+
+void TextureStreamer::add(const std::shared_ptr<Texture>& texture)
+{
+    if (!texture || !texture->isStreamed()) return;
+
+    const auto alreadyAdded = std::any_of(m_textures.cbegin(), m_textures.cend(),
+                                          [&](const auto& wp) { return wp.lock() == texture; });
+    if (!alreadyAdded) m_textures.push_back(texture);
+}
+
+//------------------------------------------------------------------------------
+
+void TextureStreamer::update()
+{
+    uploadLoaded();
+    requestLoads();
+
+    m_loads.erase(std::remove_if(m_loads.begin(), m_loads.end(),
+                                 [](const auto& load) {
+                                     return load.wait_for(std::chrono::seconds{0}) ==
+                                            std::future_status::ready;
+                                 }),
+                  m_loads.end());
+}
+
+//------------------------------------------------------------------------------
+
+void TextureStreamer::uploadLoaded()
+{
+    std::vector<LoadedLevels> loaded;
+    {
+        std::lock_guard<std::mutex> lock{m_loadedMutex};
+        std::swap(loaded, m_loaded);
+    }
+
+    std::size_t uploaded = 0;
+    auto it              = loaded.begin();
+    for (; it != loaded.end() && (uploaded == 0 || uploaded < m_uploadBudget); ++it) {
+        m_loading.erase(it->texture);
+
+        auto texture = it->texture.lock();
+        if (!texture) continue;
+
+        if (it->data.empty()) {
+            LOG_ERROR("Streaming of {} failed, keeping resident levels", texture->name);
+            texture->finishStreaming();
+            continue;
+        }
+
+        texture->uploadLevels(it->first, it->data);
+        for (const auto& level : it->data)
+            uploaded += level.size();
+
+        LOG_TRACE("Streamed {} levels {}-{}", texture->name, it->first,
+                  it->first + it->data.size() - 1);
+    }
+
+    // Over budget, rest waits for next update
+    if (it != loaded.end()) {
+        std::lock_guard<std::mutex> lock{m_loadedMutex};
+        m_loaded.insert(m_loaded.begin(), std::make_move_iterator(it),
+                        std::make_move_iterator(loaded.end()));
+    }
+}
+
+//------------------------------------------------------------------------------
+
+void TextureStreamer::requestLoads()
+{
+    auto it = m_textures.begin();
+    while (it != m_textures.end()) {
+        auto texture = it->lock();
+        if (!texture) {
+            it = m_textures.erase(it);
+            continue;
+        }
+        ++it;
+
+        // Fully loaded or evicted, streaming starts again after reload
+        if (!texture->isStreamed()) continue;
+
+        const int requested = texture->takeRequestedLevel();
+        const int base      = texture->baseLevel();
+        if (requested >= base || m_loading.count(texture) > 0 ||
+            m_loading.size() >= MaxLoadsInFlight)
+            continue;
+
+        m_loading.insert(texture);
+
+        // Mapped file keeps data valid even if texture is released in the meantime
+        m_loads.push_back(ThreadPool::global().submit(
+            [this, weak = std::weak_ptr<Texture>{texture}, ktx = texture->ktxFile(),
+             first = requested, last = base]() {
+                LoadedLevels loaded{weak, first, {}};
+                try {
+                    for (int level = first; level < last; ++level) {
+                        const auto data = ktx->level(level);
+                        loaded.data.emplace_back(data.begin(), data.end());
+                    }
+                } catch (const std::exception&) {
+                    loaded.data.clear();
+                }
+
+                std::lock_guard<std::mutex> lock{m_loadedMutex};
+                m_loaded.push_back(std::move(loaded));
+            }));
+    }
+}
+
+} // namespace gfx
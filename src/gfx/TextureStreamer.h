@@ -0,0 +1,65 @@
+#ifndef GFX_TEXTURESTREAMER_H
+#define GFX_TEXTURESTREAMER_H
+
+#include <future>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <vector>
+
+namespace gfx {
+
+class Texture;
+
+/**
+ * @brief Loads missing mip levels of streamed textures.
+ *
+ * Textures collect requested level from draw feedback during the frame. update() starts a read
+ * of missing levels on ThreadPool::global() and uploads levels read earlier. GL calls are made
+ * only from update(), so it has to be called from the thread owning GL context.
+ */
+class TextureStreamer final
+{
+  public:
+    /// uploadBudget is number of bytes uploaded per update, at least one texture is uploaded
+    explicit TextureStreamer(std::size_t uploadBudget = 16 * 1024 * 1024);
+    TextureStreamer(const TextureStreamer&) = delete;
+    TextureStreamer& operator=(const TextureStreamer&) = delete;
+    /// Waits for pending reads
+    ~TextureStreamer();
+
+    /// Textures that are not streamed now are ignored
+    void add(const std::shared_ptr<Texture>& texture);
+    bool empty() const { return m_textures.empty(); }
+
+    void update();
+
+  private:
+    struct LoadedLevels
+    {
+        std::weak_ptr<Texture> texture;
+        int first;
+        std::vector<std::vector<char>> data; //< Empty on read error
+    };
+
+    void uploadLoaded();
+    void requestLoads();
+
+    static constexpr std::size_t MaxLoadsInFlight = 8;
+
+    std::size_t m_uploadBudget;
+
+    std::vector<std::weak_ptr<Texture>> m_textures;
+    /// Textures with read in progress, owner order so released texture is never confused with
+    /// a new one at the same address
+    std::set<std::weak_ptr<Texture>, std::owner_less<>> m_loading;
+
+    std::vector<std::future<void>> m_loads;
+
+    std::mutex m_loadedMutex;
+    std::vector<LoadedLevels> m_loaded; //< Filled by workers
+};
+
+} // namespace gfx
+
+#endif // GFX_TEXTURESTREAMER_H
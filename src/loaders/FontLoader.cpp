@@ -1,141 +1,317 @@
 #include "FontLoader.h"
 
 #include "../Logger.h"
-#include "../Util.h"
 
-#include <boost/algorithm/string/trim.hpp>
 #include <boost/numeric/conversion/cast.hpp>
 
-static void removeQuotes(std::string& s)
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+// Binary format blocks as described in AngelCode BMFont documentation. All values are little
+// endian.
+#pragma pack(push, 1)
+struct BinaryInfo
+{
+    int16_t fontSize;
+    uint8_t bitField;
+    uint8_t charSet;
+    uint16_t stretchH;
+    uint8_t aa;
+    uint8_t padding[4];
+    uint8_t spacing[2];
+    uint8_t outline;
+    // followed by null terminated font name
+};
+
+struct BinaryCommon
+{
+    uint16_t lineHeight;
+    uint16_t base;
+    uint16_t scaleW;
+    uint16_t scaleH;
+    uint16_t pages;
+    uint8_t bitField;
+    uint8_t alphaChnl;
+    uint8_t redChnl;
+    uint8_t greenChnl;
+    uint8_t blueChnl;
+};
+
+struct BinaryChar
+{
+    uint32_t id;
+    uint16_t x;
+    uint16_t y;
+    uint16_t width;
+    uint16_t height;
+    int16_t xoffset;
+    int16_t yoffset;
+    int16_t xadvance;
+    uint8_t page;
+    uint8_t chnl;
+};
+
+struct BinaryKerning
+{
+    uint32_t first;
+    uint32_t second;
+    int16_t amount;
+};
+#pragma pack(pop)
+
+static_assert(sizeof(BinaryInfo) == 14, "Unexpected BMFont info block size");
+static_assert(sizeof(BinaryCommon) == 15, "Unexpected BMFont common block size");
+static_assert(sizeof(BinaryChar) == 20, "Unexpected BMFont char size");
+static_assert(sizeof(BinaryKerning) == 10, "Unexpected BMFont kerning pair size");
+
+template <typename T>
+T readBlock(const char* data)
+{
+    T value;
+    std::memcpy(&value, data, sizeof(T));
+    return value;
+}
+
+// Null terminated string limited to block end
+std::string_view readString(const char* first, const char* last)
+{
+    const void* end = std::memchr(first, '\0', last - first);
+    return {first, std::size_t((end ? static_cast<const char*>(end) : last) - first)};
+}
+
+struct KeyVal
+{
+    std::string_view key;
+    std::string_view val;
+};
+
+// key=value or key="value"
+KeyVal splitKeyVal(std::string_view arg)
 {
-    using namespace boost::algorithm;
+    KeyVal kv;
+    const auto eq = arg.find('=');
+    kv.key        = arg.substr(0, eq);
+    if (eq == std::string_view::npos) return kv;
 
-    trim_if(s, is_any_of("\""));
+    kv.val = arg.substr(eq + 1);
+    if (kv.val.size() >= 2 && kv.val.front() == '"' && kv.val.back() == '"')
+        kv.val = kv.val.substr(1, kv.val.size() - 2);
+    return kv;
 }
 
+// Calls func for every comma separated element
+template <typename F>
+void forEachElement(std::string_view list, F func)
+{
+    std::size_t i = 0;
+    for (;;) {
+        const auto comma = list.find(',');
+        func(i++, list.substr(0, comma));
+        if (comma == std::string_view::npos) break;
+        list.remove_prefix(comma + 1);
+    }
+}
+
+} // namespace
+
 template <typename T>
-T to_int(const std::string& s)
+T FontLoader::to_int(std::string_view s)
 {
-    return boost::numeric_cast<T>(std::stol(s));
+    return boost::numeric_cast<T>(toLong(s));
 }
 
 gfx::Font FontLoader::getFont() { return m_font; }
 
-void FontLoader::command(const std::string& cmd, const std::vector<std::string>& args)
+void FontLoader::loadFromMemory(std::string_view source)
 {
-    std::vector<std::string> keyVal;
+    if (source.size() >= 4 && source.compare(0, 3, "BMF") == 0)
+        loadBinary(source);
+    else
+        Loader::loadFromMemory(source);
+}
+
+void FontLoader::loadBinary(std::string_view source)
+{
+    const uint8_t version = source[3];
+    if (version != 3)
+        throw std::runtime_error{"Unsupported binary BMFont version: " + std::to_string(version)};
+
+    const char* p    = source.data() + 4;
+    const char* last = source.data() + source.size();
+
+    while (last - p >= 5) {
+        const uint8_t type = *p;
+        const auto size    = readBlock<uint32_t>(p + 1);
+        p += 5;
 
+        if (size > std::size_t(last - p)) throw std::runtime_error{"Truncated BMFont block"};
+        const char* blockEnd = p + size;
+
+        switch (type) {
+        case 1: {
+            if (size < sizeof(BinaryInfo)) throw std::runtime_error{"Invalid BMFont info block"};
+            const auto b          = readBlock<BinaryInfo>(p);
+            gfx::Font::Info& info = m_font.m_info;
+            info.size             = uint16_t(b.fontSize < 0 ? -b.fontSize : b.fontSize);
+            info.bitField         = b.bitField;
+            info.charset          = b.charSet;
+            info.strechH          = b.stretchH;
+            info.aa               = b.aa;
+            std::memcpy(info.padding, b.padding, sizeof(info.padding));
+            info.spacing[0] = int8_t(b.spacing[0]);
+            info.spacing[1] = int8_t(b.spacing[1]);
+            info.outline    = b.outline;
+            info.face       = std::string{readString(p + sizeof(BinaryInfo), blockEnd)};
+        } break;
+        case 2: {
+            if (size < sizeof(BinaryCommon))
+                throw std::runtime_error{"Invalid BMFont common block"};
+            const auto b              = readBlock<BinaryCommon>(p);
+            gfx::Font::Common& common = m_font.m_common;
+            common.lineHeight         = b.lineHeight;
+            common.base               = b.base;
+            common.scaleW             = b.scaleW;
+            common.scaleH             = b.scaleH;
+            common.pages              = b.pages;
+            common.bitField           = b.bitField;
+        } break;
+        case 3: {
+            m_font.m_pages.clear();
+            for (const char* name = p; name < blockEnd;) {
+                const std::string_view page = readString(name, blockEnd);
+                m_font.m_pages.emplace_back(page);
+                name += page.size() + 1;
+            }
+        } break;
+        case 4: {
+            for (const char* c = p; blockEnd - c >= std::ptrdiff_t(sizeof(BinaryChar));
+                 c += sizeof(BinaryChar)) {
+                const auto b = readBlock<BinaryChar>(c);
+                gfx::Font::Char ch;
+                ch.id       = b.id;
+                ch.x        = b.x;
+                ch.y        = b.y;
+                ch.width    = b.width;
+                ch.height   = b.height;
+                ch.xoffset  = b.xoffset;
+                ch.yoffset  = b.yoffset;
+                ch.xadvance = b.xadvance;
+                ch.page     = b.page;
+                ch.chnl     = b.chnl;
+                m_font.addChar(ch);
+            }
+        } break;
+        case 5: {
+            for (const char* k = p; blockEnd - k >= std::ptrdiff_t(sizeof(BinaryKerning));
+                 k += sizeof(BinaryKerning)) {
+                const auto b = readBlock<BinaryKerning>(k);
+                m_font.addKerning(b.first, b.second, b.amount);
+            }
+        } break;
+        default:
+            LOG_WARNING("Unknown BMFont block type: {}", type);
+        }
+
+        p = blockEnd;
+    }
+}
+
+void FontLoader::command(std::string_view cmd, Args args)
+{
     if (cmd == "info") {
         for (const auto& arg : args) {
             gfx::Font::Info& info = m_font.m_info;
-            keyVal.clear();
-            split(arg, '=', keyVal);
-            removeQuotes(keyVal[1]);
-            if (keyVal[0] == "size")
-                info.size = to_int<uint16_t>(keyVal[1]);
-            else if (keyVal[0] == "smooth" && keyVal[1] == "1")
-                info.bitField |= 1 >> 0;
-            else if (keyVal[0] == "unicode" && keyVal[1] == "1")
-                info.bitField |= 1 >> 1;
-            else if (keyVal[0] == "italic" && keyVal[1] == "1")
-                info.bitField |= 1 >> 2;
-            else if (keyVal[0] == "bold" && keyVal[1] == "1")
-                info.bitField |= 1 >> 3;
-            else if (keyVal[0] == "fixedHeight" && keyVal[1] == "1")
-                info.bitField |= 1 >> 4;
-            else if (keyVal[0] == "charset" && !keyVal[1].empty())
-                info.charset = to_int<uint8_t>(keyVal[1]);
-            else if (keyVal[0] == "strechH")
-                info.strechH = to_int<uint16_t>(keyVal[1]);
-            else if (keyVal[0] == "aa")
-                info.strechH = to_int<uint8_t>(keyVal[1]);
-            else if (keyVal[0] == "padding") {
-                std::vector<std::string> v;
-                split(keyVal[1], ',', v);
-                assert(v.size() == 4);
-                for (size_t i = 0; i < v.size(); ++i) {
-                    info.padding[i] = to_int<uint8_t>(v.at(i));
-                }
-            } else if (keyVal[0] == "spacing") {
-                std::vector<std::string> v;
-                split(keyVal[1], ',', v);
-                assert(v.size() == 2);
-                for (size_t i = 0; i < v.size(); ++i) {
-                    info.spacing[i] = to_int<int8_t>(v.at(i));
-                }
-            } else if (keyVal[0] == "outline")
-                info.outline = to_int<uint8_t>(keyVal[1]);
-            else if (keyVal[0] == "face")
-                info.face = keyVal[1];
+            const KeyVal kv = splitKeyVal(arg);
+            if (kv.key == "size")
+                info.size = to_int<uint16_t>(kv.val);
+            else if (kv.key == "smooth" && kv.val == "1")
+                info.bitField |= 1 << 0;
+            else if (kv.key == "unicode" && kv.val == "1")
+                info.bitField |= 1 << 1;
+            else if (kv.key == "italic" && kv.val == "1")
+                info.bitField |= 1 << 2;
+            else if (kv.key == "bold" && kv.val == "1")
+                info.bitField |= 1 << 3;
+            else if (kv.key == "fixedHeight" && kv.val == "1")
+                info.bitField |= 1 << 4;
+            else if (kv.key == "charset" && !kv.val.empty())
+                info.charset = to_int<uint8_t>(kv.val);
+            else if (kv.key == "strechH")
+                info.strechH = to_int<uint16_t>(kv.val);
+            else if (kv.key == "aa")
+                info.aa = to_int<uint8_t>(kv.val);
+            else if (kv.key == "padding") {
+                forEachElement(kv.val, [&info](std::size_t i, std::string_view v) {
+                    if (i < 4) info.padding[i] = to_int<uint8_t>(v);
+                });
+            } else if (kv.key == "spacing") {
+                forEachElement(kv.val, [&info](std::size_t i, std::string_view v) {
+                    if (i < 2) info.spacing[i] = to_int<int8_t>(v);
+                });
+            } else if (kv.key == "outline")
+                info.outline = to_int<uint8_t>(kv.val);
+            else if (kv.key == "face")
+                info.face = std::string{kv.val};
         }
     } else if (cmd == "common") {
         for (const auto& arg : args) {
             gfx::Font::Common& common = m_font.m_common;
-            keyVal.clear();
-            split(arg, '=', keyVal);
-            removeQuotes(keyVal[1]);
-            if (keyVal[0] == "lineHeight")
-                common.lineHeight = to_int<uint16_t>(keyVal[1]);
-            else if (keyVal[0] == "base")
-                common.base = to_int<uint16_t>(keyVal[1]);
-            else if (keyVal[0] == "scaleW")
-                common.scaleW = to_int<uint16_t>(keyVal[1]);
-            else if (keyVal[0] == "scaleH")
-                common.scaleH = to_int<uint16_t>(keyVal[1]);
-            else if (keyVal[0] == "pages")
-                common.pages = to_int<uint16_t>(keyVal[1]);
-            else if (keyVal[0] == "packed" && keyVal[1] == "1")
-                common.bitField |= 1 >> 7;
+            const KeyVal kv = splitKeyVal(arg);
+            if (kv.key == "lineHeight")
+                common.lineHeight = to_int<uint16_t>(kv.val);
+            else if (kv.key == "base")
+                common.base = to_int<uint16_t>(kv.val);
+            else if (kv.key == "scaleW")
+                common.scaleW = to_int<uint16_t>(kv.val);
+            else if (kv.key == "scaleH")
+                common.scaleH = to_int<uint16_t>(kv.val);
+            else if (kv.key == "pages")
+                common.pages = to_int<uint16_t>(kv.val);
+            else if (kv.key == "packed" && kv.val == "1")
+                common.bitField |= 1 << 7;
         }
     } else if (cmd == "page") {
         m_font.m_pages.resize(m_font.m_common.pages);
         size_t id = 0;
         std::string file;
         for (const auto& arg : args) {
-            keyVal.clear();
-            split(arg, '=', keyVal);
-            removeQuotes(keyVal[1]);
-            if (keyVal[0] == "id")
-                id = to_int<size_t>(keyVal[1]);
-            else if (keyVal[0] == "file")
-                file = keyVal[1];
+            const KeyVal kv = splitKeyVal(arg);
+            if (kv.key == "id")
+                id = to_int<size_t>(kv.val);
+            else if (kv.key == "file")
+                file = std::string{kv.val};
         }
         m_font.m_pages[id] = file;
     } else if (cmd == "chars") {
-        /*
-          keyVal.clear();
-          split(args[0], '=', keyVal);
-          if (keyVal[0] == "count")
-          m_font.m_chars.reserve(to_int<size_t>(keyVal[1]));
-        */
+        // Glyphs are stored by codepoint, nothing to reserve
     } else if (cmd == "char") {
         gfx::Font::Char c;
         for (const auto& arg : args) {
-            keyVal.clear();
-            split(arg, '=', keyVal);
-            removeQuotes(keyVal[1]);
-            if (keyVal[0] == "id")
-                c.id = to_int<uint32_t>(keyVal[1]);
-            else if (keyVal[0] == "x")
-                c.x = to_int<uint16_t>(keyVal[1]);
-            else if (keyVal[0] == "y")
-                c.y = to_int<uint16_t>(keyVal[1]);
-            else if (keyVal[0] == "width")
-                c.width = to_int<uint16_t>(keyVal[1]);
-            else if (keyVal[0] == "height")
-                c.height = to_int<uint16_t>(keyVal[1]);
-            else if (keyVal[0] == "xoffset")
-                c.xoffset = to_int<int16_t>(keyVal[1]);
-            else if (keyVal[0] == "yoffset")
-                c.yoffset = to_int<int16_t>(keyVal[1]);
-            else if (keyVal[0] == "xadvance")
-                c.xadvance = to_int<int16_t>(keyVal[1]);
-            else if (keyVal[0] == "page")
-                c.page = to_int<uint8_t>(keyVal[1]);
-            else if (keyVal[0] == "chnl")
-                c.page = to_int<uint8_t>(keyVal[1]);
+            const KeyVal kv = splitKeyVal(arg);
+            if (kv.key == "id")
+                c.id = to_int<uint32_t>(kv.val);
+            else if (kv.key == "x")
+                c.x = to_int<uint16_t>(kv.val);
+            else if (kv.key == "y")
+                c.y = to_int<uint16_t>(kv.val);
+            else if (kv.key == "width")
+                c.width = to_int<uint16_t>(kv.val);
+            else if (kv.key == "height")
+                c.height = to_int<uint16_t>(kv.val);
+            else if (kv.key == "xoffset")
+                c.xoffset = to_int<int16_t>(kv.val);
+            else if (kv.key == "yoffset")
+                c.yoffset = to_int<int16_t>(kv.val);
+            else if (kv.key == "xadvance")
+                c.xadvance = to_int<int16_t>(kv.val);
+            else if (kv.key == "page")
+                c.page = to_int<uint8_t>(kv.val);
+            else if (kv.key == "chnl")
+                c.chnl = to_int<uint8_t>(kv.val);
         }
-        m_font.m_chars[c.id] = c;
+        m_font.addChar(c);
     } else if (cmd == "kernings") {
         // same as in case of chars
     } else if (cmd == "kerning") {
@@ -143,19 +319,17 @@ void FontLoader::command(const std::string& cmd, const std::vector<std::string>&
         uint32_t second = 0;
         int16_t amount  = 0;
         for (const auto& arg : args) {
-            keyVal.clear();
-            split(arg, '=', keyVal);
-            removeQuotes(keyVal[1]);
-            if (keyVal[0] == "first") first = to_int<uint32_t>(keyVal[1]);
-            if (keyVal[0] == "second") second = to_int<uint32_t>(keyVal[1]);
-            if (keyVal[0] == "amount") amount = to_int<int16_t>(keyVal[1]);
+            const KeyVal kv = splitKeyVal(arg);
+            if (kv.key == "first") first = to_int<uint32_t>(kv.val);
+            if (kv.key == "second") second = to_int<uint32_t>(kv.val);
+            if (kv.key == "amount") amount = to_int<int16_t>(kv.val);
         }
-        m_font.m_kerning[std::make_pair(first, second)] = amount;
+        m_font.addKerning(first, second, amount);
     }
 }
 
 void FontLoader::fileLoaded()
 {
     LOG_INFO("Loaded: fontFace: {}, chars: {}, kernings: {}", m_font.m_info.face,
-             m_font.m_chars.size(), m_font.m_kerning.size());
+             m_font.charsCount(), m_font.kerningsCount());
 }
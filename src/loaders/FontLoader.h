@@ -9,11 +9,19 @@ class FontLoader : public Loader
   public:
     gfx::Font getFont();
 
+    /// Detects binary BMFont (version 3) by its "BMF" header, text format otherwise
+    void loadFromMemory(std::string_view source) override;
+
   protected:
-    void command(const std::string& cmd, const std::vector<std::string>& args) override;
+    void command(std::string_view cmd, Args args) override;
     void fileLoaded() override;
 
   private:
+    void loadBinary(std::string_view source);
+
+    template <typename T>
+    static T to_int(std::string_view s);
+
     gfx::Font m_font;
 };
 
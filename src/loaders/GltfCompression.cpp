@@ -0,0 +1,219 @@
+#include "GltfCompression.h"
+
+#include "../ThreadPool.h"
+#include "GltfUtils.h"
+#include "config.h"
+
+#include <fx/gltf.h>
+#include <meshoptimizer.h>
+
+#ifdef NBD_WITH_DRACO
+#include <draco/compression/decode.h>
+#endif
+
+#include <stdexcept>
+
+namespace loaders {
+
+namespace {
+
+/// Extension object from extensionsAndExtras of any glTF element, nullptr if missing
+const nlohmann::json* findExtension(const nlohmann::json& extensionsAndExtras, const char* name)
+{
+    const auto extensions = extensionsAndExtras.find("extensions");
+    if (extensions == extensionsAndExtras.end()) return nullptr;
+
+    const auto extension = extensions->find(name);
+    return extension == extensions->end() ? nullptr : &*extension;
+}
+
+const char* const MeshoptExtension = "EXT_meshopt_compression";
+const char* const DracoExtension   = "KHR_draco_mesh_compression";
+
+//------------------------------------------------------------------------------
+
+struct MeshoptView
+{
+    const uint8_t* source  = nullptr;
+    std::size_t sourceSize = 0;
+    uint8_t* destination   = nullptr;
+    std::size_t count      = 0;
+    std::size_t stride     = 0;
+    std::string mode;
+    std::string filter;
+};
+
+void decode(const MeshoptView& view)
+{
+    int result = -1;
+    if (view.mode == "ATTRIBUTES")
+        result = meshopt_decodeVertexBuffer(view.destination, view.count, view.stride, view.source,
+                                            view.sourceSize);
+    else if (view.mode == "TRIANGLES")
+        result = meshopt_decodeIndexBuffer(view.destination, view.count, view.stride, view.source,
+                                           view.sourceSize);
+    else if (view.mode == "INDICES")
+        result = meshopt_decodeIndexSequence(view.destination, view.count, view.stride,
+                                             view.source, view.sourceSize);
+
+    if (result != 0) throw std::runtime_error{"meshopt: cannot decode " + view.mode + " view"};
+
+    if (view.filter == "OCTAHEDRAL")
+        meshopt_decodeFilterOct(view.destination, view.count, view.stride);
+    else if (view.filter == "QUATERNION")
+        meshopt_decodeFilterQuat(view.destination, view.count, view.stride);
+    else if (view.filter == "EXPONENTIAL")
+        meshopt_decodeFilterExp(view.destination, view.count, view.stride);
+}
+
+} // namespace
+
+//------------------------------------------------------------------------------
+
+bool isMeshoptFallback(const fx::gltf::Document& doc, uint32_t buffer)
+{
+    const auto* ext = findExtension(doc.buffers.at(buffer).extensionsAndExtras, MeshoptExtension);
+    return ext && ext->value("fallback", false);
+}
+
+//------------------------------------------------------------------------------
+
+std::size_t decodeMeshopt(fx::gltf::Document& doc)
+{
+    for (uint32_t i = 0; i < doc.buffers.size(); ++i) {
+        if (isMeshoptFallback(doc, i)) doc.buffers[i].data.assign(doc.buffers[i].byteLength, 0);
+    }
+
+    std::vector<MeshoptView> views;
+    for (const auto& bv : doc.bufferViews) {
+        const auto* ext = findExtension(bv.extensionsAndExtras, MeshoptExtension);
+        if (!ext) continue;
+
+        const auto& source      = doc.buffers.at(ext->at("buffer").get<uint32_t>()).data;
+        const auto sourceOffset = ext->value("byteOffset", std::size_t{0});
+
+        MeshoptView view;
+        view.sourceSize = ext->at("byteLength").get<std::size_t>();
+        view.count      = ext->at("count").get<std::size_t>();
+        view.stride     = ext->at("byteStride").get<std::size_t>();
+        view.mode       = ext->at("mode").get<std::string>();
+        view.filter     = ext->value("filter", std::string{"NONE"});
+
+        auto& destination = doc.buffers.at(bv.buffer).data;
+        if (sourceOffset + view.sourceSize > source.size() ||
+            bv.byteOffset + view.count * view.stride > destination.size())
+            throw std::out_of_range{"meshopt: buffer view " + bv.name + " exceeds buffer"};
+
+        view.source      = source.data() + sourceOffset;
+        view.destination = destination.data() + bv.byteOffset;
+        views.push_back(std::move(view));
+    }
+
+    ThreadPool::global().parallelFor(views.size(), 1, [&views](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i)
+            decode(views[i]);
+    });
+
+    return views.size();
+}
+
+//------------------------------------------------------------------------------
+
+bool isDracoCompressed(const fx::gltf::Primitive& primitive)
+{
+    return findExtension(primitive.extensionsAndExtras, DracoExtension) != nullptr;
+}
+
+//------------------------------------------------------------------------------
+
+#ifdef NBD_WITH_DRACO
+
+template <typename T>
+static void convertAttribute(const draco::Mesh& mesh, const draco::PointAttribute& source,
+                             AttributeData& attribute)
+{
+    auto out = attribute.as<T>();
+    for (draco::PointIndex i{0}; i < mesh.num_points(); ++i) {
+        source.ConvertValue<T>(source.mapped_index(i), static_cast<int8_t>(attribute.size),
+                               out + i.value() * attribute.size);
+    }
+}
+
+PrimitiveData decodeDraco(const fx::gltf::Document& doc, const fx::gltf::Primitive& primitive)
+{
+    using Attribute = PrimitiveData::Attribute;
+
+    static const std::array<std::pair<const char*, Attribute>, 7> attributeNames{{
+        {"POSITION", Attribute::Position},
+        {"NORMAL", Attribute::Normal},
+        {"TANGENT", Attribute::Tangent},
+        {"TEXCOORD_0", Attribute::TexCoord_0},
+        {"COLOR_0", Attribute::Color_0},
+        {"JOINTS_0", Attribute::Joints_0},
+        {"WEIGHTS_0", Attribute::Weights_0},
+    }};
+
+    const auto& ext = *findExtension(primitive.extensionsAndExtras, DracoExtension);
+    const auto& bv  = doc.bufferViews.at(ext.at("bufferView").get<uint32_t>());
+    const auto& buf = doc.buffers.at(bv.buffer);
+
+    draco::DecoderBuffer buffer;
+    buffer.Init(reinterpret_cast<const char*>(buf.data.data()) + bv.byteOffset, bv.byteLength);
+
+    draco::Decoder decoder;
+    auto decoded = decoder.DecodeMeshFromBuffer(&buffer);
+    if (!decoded.ok()) throw std::runtime_error{"Draco: " + decoded.status().error_msg_string()};
+    const std::unique_ptr<draco::Mesh> mesh = std::move(decoded).value();
+
+    PrimitiveData data;
+    data.mode = GL_TRIANGLES;
+
+    const auto& ids = ext.at("attributes");
+    for (const auto& name : attributeNames) {
+        const auto id       = ids.find(name.first);
+        const auto accessor = primitive.attributes.find(name.first);
+        if (id == ids.end() || accessor == primitive.attributes.end()) continue;
+
+        const auto* source = mesh->GetAttributeByUniqueId(id->get<uint32_t>());
+        if (!source)
+            throw std::runtime_error{"Draco: missing attribute " + std::string{name.first}};
+
+        const fx::gltf::Accessor& acc = doc.accessors.at(accessor->second);
+
+        AttributeData& attribute = data.attributes[name.second];
+        attribute.count          = mesh->num_points();
+        attribute.size           = typeToSize(acc.type);
+        attribute.type           = static_cast<GLenum>(acc.componentType);
+        attribute.normalized     = acc.normalized;
+        attribute.data.resize(attribute.count * attribute.elementSize());
+
+        switch (attribute.type) {
+        case GL_BYTE: convertAttribute<int8_t>(*mesh, *source, attribute); break;
+        case GL_UNSIGNED_BYTE: convertAttribute<uint8_t>(*mesh, *source, attribute); break;
+        case GL_SHORT: convertAttribute<int16_t>(*mesh, *source, attribute); break;
+        case GL_UNSIGNED_SHORT: convertAttribute<uint16_t>(*mesh, *source, attribute); break;
+        case GL_UNSIGNED_INT: convertAttribute<uint32_t>(*mesh, *source, attribute); break;
+        default: convertAttribute<float>(*mesh, *source, attribute); break;
+        }
+    }
+
+    data.indices.resize(std::size_t(mesh->num_faces()) * 3);
+    for (draco::FaceIndex f{0}; f < mesh->num_faces(); ++f) {
+        const auto& face = mesh->face(f);
+        for (int i = 0; i < 3; ++i)
+            data.indices[f.value() * 3 + i] = face[i].value();
+    }
+
+    return data;
+}
+
+#else
+
+PrimitiveData decodeDraco(const fx::gltf::Document&, const fx::gltf::Primitive&)
+{
+    throw std::runtime_error{"KHR_draco_mesh_compression requires build with NBD_WITH_DRACO"};
+}
+
+#endif
+
+} // namespace loaders
@@ -0,0 +1,41 @@
+#ifndef LOADERS_GLTFCOMPRESSION_H
+#define LOADERS_GLTFCOMPRESSION_H
+
+#include "PrimitiveData.h"
+
+namespace fx {
+namespace gltf {
+struct Document;
+struct Primitive;
+} // namespace gltf
+} // namespace fx
+
+namespace loaders {
+
+/**
+ * @brief Decodes EXT_meshopt_compression buffer views in place.
+ *
+ * Decoded data is written where the uncompressed buffer view points to (fallback buffers are
+ * allocated zeroed), so the rest of the loader reads regular buffer views. Views are decoded in
+ * parallel on ThreadPool::global(). Returns number of decoded views.
+ */
+std::size_t decodeMeshopt(fx::gltf::Document& doc);
+
+/// True if meshopt fallback buffer, it has no data of its own
+bool isMeshoptFallback(const fx::gltf::Document& doc, uint32_t buffer);
+
+/// True if primitive uses KHR_draco_mesh_compression
+bool isDracoCompressed(const fx::gltf::Primitive& primitive);
+
+/**
+ * @brief Decodes KHR_draco_mesh_compression primitive.
+ *
+ * Attributes get component types of their glTF accessors. Does not touch GL, safe to call from
+ * worker threads. Throws std::runtime_error on decoding errors or if built without
+ * NBD_WITH_DRACO.
+ */
+PrimitiveData decodeDraco(const fx::gltf::Document& doc, const fx::gltf::Primitive& primitive);
+
+} // namespace loaders
+
+#endif // LOADERS_GLTFCOMPRESSION_H
@@ -1,6 +1,26 @@
 #include "GltfLoader.h"
 
+#include "../Logger.h"
+#include "../ThreadPool.h"
+#include "../Vfs.h"
+#include "../gfx/Ktx2Image.h"
+#include "GltfCompression.h"
+#include "GltfUtils.h"
+#include "MeshOptimizer.h"
+#include "MeshQuantizer.h"
+#include "Meshlets.h"
+#include "PrimitiveData.h"
+#include "Tangents.h"
+#include "config.h"
+
 #include <fx/gltf.h>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <cstring>
+#include <functional>
+#include <map>
+#include <numeric> // iota
+#include <set>
 
 namespace loaders {
 
@@ -21,11 +41,125 @@ int typeToSize(fx::gltf::Accessor::Type type)
 
 //------------------------------------------------------------------------------
 
+/// Copies accessor data to CPU memory removing byteStride.
+static AttributeData readAccessor(const fx::gltf::Document& doc, uint32_t accessorIdx)
+{
+    const fx::gltf::Accessor& acc = doc.accessors.at(accessorIdx);
+
+    AttributeData attribute;
+    attribute.count      = acc.count;
+    attribute.size       = typeToSize(acc.type);
+    attribute.type       = static_cast<GLenum>(acc.componentType);
+    attribute.normalized = acc.normalized;
+
+    const std::size_t elementSize = attribute.elementSize();
+    attribute.data.resize(attribute.count * elementSize);
+
+    if (!acc.sparse.empty()) LOG_WARNING("Sparse accessors are not supported: {}", acc.name);
+
+    // Accessor without buffer view is initialized with zeros
+    if (acc.bufferView == -1 || attribute.count == 0) return attribute;
+
+    const fx::gltf::BufferView& bv = doc.bufferViews.at(acc.bufferView);
+    const fx::gltf::Buffer& buf    = doc.buffers.at(bv.buffer);
+
+    const std::size_t stride = bv.byteStride ? bv.byteStride : elementSize;
+    const std::size_t offset = std::size_t(bv.byteOffset) + acc.byteOffset;
+
+    if (offset + stride * (attribute.count - 1) + elementSize > buf.data.size()) {
+        throw std::out_of_range{"Accessor " + std::to_string(accessorIdx) + " exceeds buffer"};
+    }
+
+    const uint8_t* src = buf.data.data() + offset;
+    for (std::size_t i = 0; i < attribute.count; ++i)
+        std::memcpy(&attribute.data[i * elementSize], src + i * stride, elementSize);
+
+    return attribute;
+}
+
+//------------------------------------------------------------------------------
+
+static std::vector<uint32_t> readIndices(const fx::gltf::Document& doc, uint32_t accessorIdx)
+{
+    const AttributeData attribute = readAccessor(doc, accessorIdx);
+
+    std::vector<uint32_t> indices(attribute.count);
+
+    switch (attribute.type) {
+    case GL_UNSIGNED_BYTE:
+        std::copy_n(attribute.as<uint8_t>(), attribute.count, std::begin(indices));
+        break;
+    case GL_UNSIGNED_SHORT:
+        std::copy_n(attribute.as<uint16_t>(), attribute.count, std::begin(indices));
+        break;
+    case GL_UNSIGNED_INT:
+        std::copy_n(attribute.as<uint32_t>(), attribute.count, std::begin(indices));
+        break;
+    default: throw std::invalid_argument{"Unknown indices type"};
+    }
+
+    return indices;
+}
+
+//------------------------------------------------------------------------------
+
+/// Buffers are read through Vfs, meshopt fallback buffers are left for decodeMeshopt
+static fx::gltf::Document loadDocument(const std::filesystem::path& file)
+{
+    const auto& vfs     = Vfs::global();
+    const FileData text = vfs.read(file);
+
+    fx::gltf::Document doc = nlohmann::json::parse(text.view().begin(), text.view().end());
+
+    for (uint32_t i = 0; i < doc.buffers.size(); ++i) {
+        auto& buffer = doc.buffers[i];
+        if (isMeshoptFallback(doc, i)) continue;
+
+        if (buffer.IsEmbeddedResource()) {
+            if (!fx::base64::TryDecode(buffer.uri.substr(buffer.uri.find(',') + 1), buffer.data))
+                throw std::runtime_error{"Invalid embedded buffer in " + file.string()};
+        } else {
+            const FileData data    = vfs.read(file.parent_path() / buffer.uri);
+            const std::size_t size = std::min<std::size_t>(data.size(), buffer.byteLength);
+            buffer.data.assign(data.data(), data.data() + size);
+        }
+
+        if (buffer.data.size() < buffer.byteLength)
+            throw std::runtime_error{"Buffer too small: " + buffer.uri};
+    }
+    return doc;
+}
+
+//------------------------------------------------------------------------------
+
+GltfLoader::GltfLoader(Options options)
+    : m_options{std::move(options)}
+    , m_cache{m_options.cacheFolder}
+{
+}
+
+//------------------------------------------------------------------------------
+
 void GltfLoader::load(const std::filesystem::path& file)
 {
     using namespace gfx;
 
-    fx::gltf::Document doc = fx::gltf::LoadFromText(file.string());
+    fx::gltf::Document doc = loadDocument(file);
+
+    // Quantized attributes are read with their component types, dequantization is in nodes
+    static const std::set<std::string> supportedExtensions{
+        "KHR_mesh_quantization", "EXT_meshopt_compression",
+#ifdef NBD_WITH_DRACO
+        "KHR_draco_mesh_compression",
+#endif
+    };
+    for (const auto& extension : doc.extensionsRequired) {
+        if (supportedExtensions.count(extension) == 0)
+            LOG_WARNING("Unsupported glTF extension {} required by {}", extension, file.string());
+    }
+
+    if (const auto views = decodeMeshopt(doc))
+        LOG_DEBUG("Decoded {} meshopt compressed buffer views of {}", views, file.string());
 
     loadBuffers(doc);
     loadAccessors(doc);
@@ -72,7 +206,30 @@ std::shared_ptr<gfx::Model> GltfLoader::model() const
 
 void GltfLoader::loadBuffers(const fx::gltf::Document& doc)
 {
-    for (auto& bv : doc.bufferViews) {
+    // Meshes are uploaded from CPU copies after optimization. Only buffer views used by other
+    // accessors (animations, skins) go to GPU as they are.
+    std::set<int32_t> usedAccessors;
+    for (const auto& animation : doc.animations) {
+        for (const auto& sampler : animation.samplers) {
+            usedAccessors.insert(sampler.input);
+            usedAccessors.insert(sampler.output);
+        }
+    }
+    for (const auto& skin : doc.skins)
+        usedAccessors.insert(skin.inverseBindMatrices);
+
+    std::set<int32_t> usedBufferViews;
+    for (auto accessorIdx : usedAccessors) {
+        if (accessorIdx >= 0 && accessorIdx < int32_t(doc.accessors.size()))
+            usedBufferViews.insert(doc.accessors[accessorIdx].bufferView);
+    }
+
+    m_buffers.resize(doc.bufferViews.size());
+
+    for (int32_t i = 0; i < int32_t(doc.bufferViews.size()); ++i) {
+        if (usedBufferViews.count(i) == 0) continue;
+
+        const auto& bv = doc.bufferViews[i];
         auto gpuBuffer = std::make_shared<gfx::Buffer>();
 
         gpuBuffer->loadData(reinterpret_cast<const uint8_t*>(doc.buffers[bv.buffer].data.data()) +
@@ -80,7 +237,7 @@ void GltfLoader::loadBuffers(const fx::gltf::Document& doc)
                             bv.byteLength);
         gpuBuffer->m_byteStride = bv.byteStride;
 
-        m_buffers.push_back(gpuBuffer);
+        m_buffers[i] = gpuBuffer;
     }
 }
 
@@ -91,7 +248,7 @@ void GltfLoader::loadAccessors(const fx::gltf::Document& doc)
     for (auto& acc : doc.accessors) {
         gfx::Accessor accessor;
 
-        accessor.buffer     = m_buffers[acc.bufferView];
+        if (acc.bufferView != -1) accessor.buffer = m_buffers[acc.bufferView];
         accessor.byteOffset = acc.byteOffset;
         accessor.count      = acc.count;
         accessor.size       = typeToSize(acc.type);
@@ -126,12 +283,36 @@ void GltfLoader::loadSamplers(const fx::gltf::Document& doc)
 
 void GltfLoader::loadTextures(const fx::gltf::Document& doc, const std::filesystem::path& file)
 {
-    for (auto& txr : doc.textures) {
-        const auto filename =
-            file.parent_path() /
-            std::filesystem::path(doc.images[txr.source].uri).replace_extension(".ktx");
+    const gfx::TextureCaps caps = gfx::TextureCaps::query();
+
+    // KTX2 files are preferred and transcoded on worker threads, GL upload stays on this thread
+    std::vector<std::filesystem::path> filenames;
+    std::vector<std::future<gfx::Ktx2Image>> transcoded(doc.textures.size());
+    for (std::size_t i = 0; i < doc.textures.size(); ++i) {
+        auto uri      = std::filesystem::path(doc.images[doc.textures[i].source].uri);
+        auto filename = file.parent_path() / uri.replace_extension(".ktx2");
+
+        if (Vfs::global().exists(filename))
+            transcoded[i] = ThreadPool::global().submit(
+                [filename, caps]() { return gfx::Ktx2Image::transcode(filename, caps); });
+        else
+            filename.replace_extension(".ktx");
+
+        filenames.push_back(filename);
+    }
 
-        auto texture = std::make_shared<gfx::Texture>(filename, txr.name);
+    for (std::size_t i = 0; i < doc.textures.size(); ++i) {
+        const auto& txr      = doc.textures[i];
+        const auto& filename = filenames[i];
+
+        std::shared_ptr<gfx::Texture> texture;
+        if (transcoded[i].valid())
+            texture = std::make_shared<gfx::Texture>(transcoded[i].get(), filename, txr.name);
+        else if (m_options.streamTextures)
+            texture =
+                std::make_shared<gfx::Texture>(gfx::Texture::createStreamed(filename, txr.name));
+        else
+            texture = std::make_shared<gfx::Texture>(filename, txr.name);
 
         if (txr.sampler != -1) {
             texture->setSampler(m_samplers[txr.sampler]);
@@ -193,7 +374,8 @@ void GltfLoader::loadMaterials(const fx::gltf::Document& doc)
             material.textures[TextureUnit::Emissive] = m_textures.at(mtl.emissiveTexture.index);
         }
 
-        material.name = mtl.name;
+        material.doubleSided = mtl.doubleSided;
+        material.name        = mtl.name;
 
         m_materials.push_back(material);
     }
@@ -204,73 +386,132 @@ void GltfLoader::loadMaterials(const fx::gltf::Document& doc)
 void GltfLoader::loadMeshes(const fx::gltf::Document& doc)
 {
     using namespace gfx;
+    using Attribute = PrimitiveData::Attribute;
+
+    static const std::array<std::pair<const char*, Attribute>, 7> attributeNames{{
+        {"POSITION", Attribute::Position},
+        {"NORMAL", Attribute::Normal},
+        {"TANGENT", Attribute::Tangent},
+        {"TEXCOORD_0", Attribute::TexCoord_0},
+        {"COLOR_0", Attribute::Color_0},
+        {"JOINTS_0", Attribute::Joints_0},
+        {"WEIGHTS_0", Attribute::Weights_0},
+    }};
+
+    // Smaller primitives are drawn whole, culling them would cost more than it saves
+    constexpr std::size_t MinMeshletIndices = 3 * 512;
+
+    OptimizationReport total;
+    QuantizationReport quantized;
+    std::size_t meshlets = 0;
+
+    // Draco primitives are decoded on worker threads, meanwhile the rest is read here
+    std::map<const fx::gltf::Primitive*, std::future<PrimitiveData>> dracoPrimitives;
+    for (auto& mesh : doc.meshes) {
+        for (auto& prim : mesh.primitives) {
+            if (isDracoCompressed(prim))
+                dracoPrimitives[&prim] =
+                    ThreadPool::global().submit([&doc, &prim]() { return decodeDraco(doc, prim); });
+        }
+    }
+
+    // Tasks reference doc, they must not outlive this function when reading throws
+    struct WaitForTasks
+    {
+        std::map<const fx::gltf::Primitive*, std::future<PrimitiveData>>& tasks;
+        ~WaitForTasks()
+        {
+            for (auto& task : tasks)
+                if (task.second.valid()) task.second.wait();
+        }
+    } waitForTasks{dracoPrimitives};
 
     for (auto& mesh : doc.meshes) {
 
-        std::vector<Primitive> primitives;
+        std::vector<PrimitiveData> primitivesData;
 
         for (auto& prim : mesh.primitives) {
 
-            std::array<Accessor, Accessor::Attribute::Size> attributes{};
-            auto primitive = static_cast<GLenum>(prim.mode);
+            PrimitiveData data;
 
-            Accessor& indices = m_accessors[prim.indices];
+            auto draco = dracoPrimitives.find(&prim);
+            if (draco != std::end(dracoPrimitives)) {
+                data = draco->second.get();
+            } else {
+                data.mode = static_cast<GLenum>(prim.mode);
 
-            auto attr = prim.attributes.find("POSITION");
-            if (attr != std::end(prim.attributes))
-                attributes[Accessor::Attribute::Position] = m_accessors[attr->second];
-
-            attr = prim.attributes.find("NORMAL");
-            if (attr != std::end(prim.attributes))
-                attributes[Accessor::Attribute::Normal] = m_accessors[attr->second];
+                for (const auto& name : attributeNames) {
+                    auto attr = prim.attributes.find(name.first);
+                    if (attr != std::end(prim.attributes))
+                        data.attributes[name.second] = readAccessor(doc, attr->second);
+                }
 
-            attr = prim.attributes.find("TANGENT");
-            if (attr != std::end(prim.attributes)) {
-                attributes[Accessor::Attribute::Tangent] = m_accessors[attr->second];
+                if (prim.indices != -1) {
+                    data.indices = readIndices(doc, prim.indices);
+                } else if (data.mode == GL_TRIANGLES) {
+                    data.indices.resize(data.vertexCount());
+                    std::iota(std::begin(data.indices), std::end(data.indices), 0);
+                }
             }
 
-            attr = prim.attributes.find("TEXCOORD_0");
-            if (attr != std::end(prim.attributes))
-                attributes[Accessor::Attribute::TexCoord_0] = m_accessors[attr->second];
-
-            attr = prim.attributes.find("COLOR_0");
-            if (attr != std::end(prim.attributes))
-                attributes[Accessor::Attribute::Color_0] = m_accessors[attr->second];
-
-            attr = prim.attributes.find("JOINTS_0");
-            if (attr != std::end(prim.attributes))
-                attributes[Accessor::Attribute::Joints_0] = m_accessors[attr->second];
+            for (auto& target : prim.targets) {
+                PrimitiveData::MorphTarget morphTarget{};
 
-            attr = prim.attributes.find("WEIGHTS_0");
-            if (attr != std::end(prim.attributes))
-                attributes[Accessor::Attribute::Weights_0] = m_accessors[attr->second];
+                for (const auto& name : attributeNames) {
+                    if (name.second >= morphTarget.size()) break;
 
-            // Missing tangent vectors!
-            if (!attributes[Accessor::Attribute::Tangent].buffer)
-                attributes[Accessor::Attribute::Tangent] = calculateTangents(attributes, indices);
+                    auto attr = target.find(name.first);
+                    if (attr != std::end(target))
+                        morphTarget[name.second] = readAccessor(doc, attr->second);
+                }
 
-            std::vector<std::array<Accessor, 3>> targets;
+                data.targets.push_back(morphTarget);
+            }
 
-            for (auto& target : prim.targets) {
-                std::array<Accessor, 3> attributes{};
+            if (m_options.optimizeMeshes) {
+                const OptimizationReport report = optimizeMesh(data);
+                if (report.triangles > 0) {
+                    LOG_DEBUG("Optimized primitive of {}: {} triangles, ACMR {:.3f} -> {:.3f}, "
+                              "ATVR {:.3f} -> {:.3f}",
+                              mesh.name, report.triangles, report.before.acmr, report.after.acmr,
+                              report.before.atvr, report.after.atvr);
+
+                    const auto accumulate = [](VertexCacheStats& sum, const VertexCacheStats& s,
+                                               std::size_t triangles) {
+                        sum.acmr += s.acmr * triangles;
+                        sum.atvr += s.atvr * triangles;
+                    };
+                    accumulate(total.before, report.before, report.triangles);
+                    accumulate(total.after, report.after, report.triangles);
+                    total.triangles += report.triangles;
+                }
+            }
 
-                auto attr = target.find("POSITION");
-                if (attr != std::end(target))
-                    attributes[Accessor::Attribute::Position] = m_accessors[attr->second];
+            // Missing tangent vectors!
+            if (data.attributes[Attribute::Tangent].empty()) generateTangents(data);
+
+            // Bounds of animated primitives are not known at import
+            const bool animated =
+                !data.targets.empty() || !data.attributes[Attribute::Joints_0].empty();
+            if (m_options.buildMeshlets && !animated && data.indices.size() >= MinMeshletIndices) {
+                data.meshlets = buildMeshlets(data);
+                meshlets += data.meshlets.size();
+            }
 
-                attr = target.find("NORMAL");
-                if (attr != std::end(target))
-                    attributes[Accessor::Attribute::Normal] = m_accessors[attr->second];
+            primitivesData.push_back(std::move(data));
+        }
 
-                attr = target.find("TANGENT");
-                if (attr != std::end(target)) {
-                    attributes[Accessor::Attribute::Tangent] = m_accessors[attr->second];
-                }
+        if (m_options.quantizeMeshes) {
+            const QuantizationReport report = quantizeMesh(primitivesData);
+            quantized.bytesBefore += report.bytesBefore;
+            quantized.bytesAfter += report.bytesAfter;
+        }
 
-                targets.push_back(attributes);
-            }
+        std::vector<Primitive> primitives;
+        for (std::size_t i = 0; i < primitivesData.size(); ++i) {
+            primitives.push_back(primitivesData[i].upload());
 
-            primitives.emplace_back(attributes, indices, primitive, targets);
+            const auto& prim = mesh.primitives[i];
             if (prim.material != -1) {
                 primitives.back().setMaterial(m_materials.at(prim.material));
             }
@@ -280,6 +521,54 @@ void GltfLoader::loadMeshes(const fx::gltf::Document& doc)
         m_meshes.push_back(m);
         m_meshes.back()->name = mesh.name;
     }
+
+    if (total.triangles > 0) {
+        const float triangles = float(total.triangles);
+        LOG_INFO("Mesh optimization: {} triangles, ACMR {:.3f} -> {:.3f}, ATVR {:.3f} -> {:.3f}",
+                 total.triangles, total.before.acmr / triangles, total.after.acmr / triangles,
+                 total.before.atvr / triangles, total.after.atvr / triangles);
+    }
+
+    if (meshlets > 0) LOG_DEBUG("Built {} meshlets for culling", meshlets);
+
+    if (quantized.bytesBefore > 0) {
+        LOG_INFO("Mesh quantization: vertex data {} KB -> {} KB", quantized.bytesBefore / 1024,
+                 quantized.bytesAfter / 1024);
+    }
+}
+
+//------------------------------------------------------------------------------
+
+void GltfLoader::generateTangents(PrimitiveData& primitive) const
+{
+    using Attribute = PrimitiveData::Attribute;
+
+    AttributeData& tangents = primitive.attributes[Attribute::Tangent];
+
+    // Tangents depend on final vertex order, so key is calculated after optimization
+    AssetCache::Hasher hasher{"tangents-2"};
+    if (m_cache.enabled()) {
+        for (auto attribute : {Attribute::Position, Attribute::Normal, Attribute::TexCoord_0}) {
+            const AttributeData& attr = primitive.attributes[attribute];
+            hasher.add(attr.type);
+            hasher.add(attr.size);
+            hasher.add(attr.normalized);
+            hasher.add(attr.data);
+        }
+        hasher.add(primitive.indices);
+
+        if (m_cache.load(hasher.value(), tangents.data) &&
+            tangents.data.size() == primitive.vertexCount() * sizeof(glm::vec4)) {
+            tangents.count = static_cast<unsigned>(primitive.vertexCount());
+            tangents.size  = 4;
+            tangents.type  = GL_FLOAT;
+            return;
+        }
+    }
+
+    tangents = calculateTangents(primitive);
+
+    if (!tangents.empty()) m_cache.store(hasher.value(), tangents.data);
 }
 
 //------------------------------------------------------------------------------
@@ -384,4 +673,83 @@ void GltfLoader::loadSkins(const fx::gltf::Document& doc)
     }
 }
 
+//==============================================================================
+
+static glm::mat4 nodeMatrix(const fx::gltf::Node& node)
+{
+    static const std::array<float, 16> identity{1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1};
+    if (node.matrix != identity) return glm::make_mat4(node.matrix.data());
+
+    const auto& t = node.translation;
+    const auto& r = node.rotation;
+    const auto& s = node.scale;
+
+    const auto T = glm::translate(glm::mat4(1.f), {t[0], t[1], t[2]});
+    const auto R = glm::toMat4(glm::quat{r[3], r[0], r[1], r[2]});
+    const auto S = glm::scale(glm::mat4(1.f), {s[0], s[1], s[2]});
+    return T * R * S;
+}
+
+//------------------------------------------------------------------------------
+
+TriangleMesh loadGltfTriangles(const std::filesystem::path& file)
+{
+    using Attribute = PrimitiveData::Attribute;
+
+    fx::gltf::Document doc = loadDocument(file);
+    decodeMeshopt(doc);
+
+    TriangleMesh ans;
+
+    const auto addMesh = [&](int32_t meshIdx, const glm::mat4& transformation) {
+        for (const auto& prim : doc.meshes.at(meshIdx).primitives) {
+            PrimitiveData data;
+
+            if (isDracoCompressed(prim)) {
+                data = decodeDraco(doc, prim);
+            } else {
+                auto position = prim.attributes.find("POSITION");
+                if (position == std::end(prim.attributes)) continue;
+
+                data.mode                            = static_cast<GLenum>(prim.mode);
+                data.attributes[Attribute::Position] = readAccessor(doc, position->second);
+                if (prim.indices != -1) data.indices = readIndices(doc, prim.indices);
+            }
+
+            if (data.mode != GL_TRIANGLES) continue;
+            if (data.indices.empty()) {
+                data.indices.resize(data.vertexCount());
+                std::iota(std::begin(data.indices), std::end(data.indices), 0);
+            }
+
+            const auto base = static_cast<uint32_t>(ans.positions.size());
+            for (const auto& p : data.positions())
+                ans.positions.push_back(glm::vec3{transformation * glm::vec4{p, 1.0f}});
+            for (auto index : data.indices)
+                ans.indices.push_back(base + index);
+        }
+    };
+
+    std::function<void(int32_t, const glm::mat4&)> addNode = [&](int32_t nodeIdx,
+                                                                 const glm::mat4& parent) {
+        const fx::gltf::Node& node     = doc.nodes.at(nodeIdx);
+        const glm::mat4 transformation = parent * nodeMatrix(node);
+
+        if (node.mesh != -1) addMesh(node.mesh, transformation);
+        for (auto child : node.children)
+            addNode(child, transformation);
+    };
+
+    if (doc.scenes.empty()) {
+        for (int32_t i = 0; i < static_cast<int32_t>(doc.meshes.size()); ++i)
+            addMesh(i, glm::mat4{1.0f});
+    } else {
+        const auto& scene = doc.scenes.at(doc.scene != -1 ? doc.scene : 0);
+        for (auto nodeIdx : scene.nodes)
+            addNode(nodeIdx, glm::mat4{1.0f});
+    }
+
+    return ans;
+}
+
 } // namespace loaders
@@ -5,7 +5,9 @@
 #include <memory>
 #include <vector>
 
+#include "../AssetCache.h"
 #include "../gfx/Model.h"
+#include "TriangleMesh.h"
 
 namespace fx {
 namespace gltf {
@@ -15,9 +17,23 @@ struct Document;
 
 namespace loaders {
 
+struct PrimitiveData;
+
 class GltfLoader final
 {
   public:
+    struct Options
+    {
+        bool optimizeMeshes = true;        //< Reorder indices and vertices for GPU caches
+        std::filesystem::path cacheFolder; //< Cooked data (tangents etc.), empty disables
+        bool streamTextures = false;       //< Load only low mips, see gfx::TextureStreamer
+        bool quantizeMeshes = false;       //< Compact vertex formats, see quantizeMesh
+        bool buildMeshlets  = true;        //< Split big primitives for gfx::Primitive::cull
+    };
+
+    GltfLoader() = default;
+    explicit GltfLoader(Options options);
+
     void load(const std::filesystem::path& file);
     std::shared_ptr<gfx::Model> model() const;
 
@@ -33,6 +49,11 @@ class GltfLoader final
     void loadNodes(const fx::gltf::Document& doc);
     void loadSkins(const fx::gltf::Document& doc);
 
+    void generateTangents(PrimitiveData& primitive) const;
+
+    Options m_options;
+    AssetCache m_cache;
+
     std::vector<std::shared_ptr<gfx::Buffer>> m_buffers;
     std::vector<std::shared_ptr<gfx::Sampler>> m_samplers;
     std::vector<std::shared_ptr<gfx::Texture>> m_textures;
@@ -49,6 +70,12 @@ class GltfLoader final
     std::string m_name;
 };
 
+//==============================================================================
+
+/// Triangles of default scene meshes with node transformations applied. Only CPU side data is
+/// read. Skins, morph targets and non triangle primitives are ignored.
+TriangleMesh loadGltfTriangles(const std::filesystem::path& file);
+
 } // namespace loaders
 
 #endif // LOADERS_GLTFLOADER_H
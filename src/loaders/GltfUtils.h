@@ -0,0 +1,13 @@
+#ifndef LOADERS_GLTFUTILS_H
+#define LOADERS_GLTFUTILS_H
+
+#include <fx/gltf.h>
+
+namespace loaders {
+
+/// Components of accessor type, e.g. 3 for Vec3. Defined in GltfLoader.cpp.
+int typeToSize(fx::gltf::Accessor::Type type);
+
+} // namespace loaders
+
+#endif // LOADERS_GLTFUTILS_H
@@ -1,23 +1,30 @@
 #include "Loader.h"
 
-#include <boost/algorithm/string.hpp>
-#include <boost/tokenizer.hpp>
+#include "../Logger.h"
+#include "../Vfs.h"
+#include "Parse.h"
 
-#include <filesystem>
-#include <fstream>
-#include <iostream>
+#include <iterator>
+#include <stdexcept>
 
-void Loader::load(const std::filesystem::path& file)
+namespace parse = loaders::parse;
+
+const std::string_view& Loader::Args::at(std::size_t i) const
 {
-    using namespace std;
+    if (i >= m_size) throw std::out_of_range{"Missing argument"};
+    return m_data[i];
+}
 
-    ifstream f(file);
+//------------------------------------------------------------------------------
 
-    if (f.is_open() == true) {
-        load(f);
-        f.close();
+void Loader::load(const std::filesystem::path& file)
+{
+    // Missing file is reported like before, parse errors reach the caller
+    if (Vfs::global().exists(file)) {
+        const FileData data = Vfs::global().read(file);
+        loadFromMemory(data.view());
     } else {
-        cerr << "Error: unable to open " << file.string() << endl;
+        LOG_ERROR("Unable to open {}", file.string());
     }
 
     fileLoaded();
@@ -25,40 +32,72 @@ void Loader::load(const std::filesystem::path& file)
 
 void Loader::load(std::istream& stream)
 {
-    std::string tmp;
+    const std::string buffer{std::istreambuf_iterator<char>{stream},
+                             std::istreambuf_iterator<char>{}};
+    loadFromMemory(buffer);
+}
+
+void Loader::loadFromMemory(std::string_view source)
+{
+    const char* first = source.data();
+    const char* last  = first + source.size();
+
+    while (first != last) {
+        const char* eol = static_cast<const char*>(std::memchr(first, '\n', last - first));
+        if (!eol) eol = last;
+
+        parseLine(std::string_view{first, std::size_t(eol - first)});
 
-    while (stream.good()) {
-        getline(stream, tmp);
-        boost::algorithm::trim(tmp);
-        parseLine(tmp);
+        first = eol == last ? last : eol + 1;
     }
 }
 
-void Loader::parseLine(const std::string& line)
+void Loader::parseLine(std::string_view line)
 {
-    using namespace boost;
+    m_tokens.clear();
 
-    // Ignore lines
-    if (line.empty() || algorithm::starts_with(line, "#")) return;
+    const char* p    = line.data();
+    const char* last = p + line.size();
 
-    typedef tokenizer<char_separator<char>> tokenizer;
+    for (p = parse::skipSpaces(p, last); p != last; p = parse::skipSpaces(p, last)) {
+        // Ignore comments
+        if (m_tokens.empty() && *p == '#') return;
 
-    char_separator<char> sep(" ");
-    tokenizer tokens(line, sep);
+        const char* begin = p;
+        bool quoted       = false;
+        while (p != last && (quoted || !parse::isSpace(*p))) {
+            if (*p == '"') quoted = !quoted;
+            ++p;
+        }
 
-    tokenizer::iterator it = tokens.begin();
-    const std::string cmd  = *it;
-    ++it; // skip command;
-
-    std::vector<std::string> args;
-    for (; it != tokens.end(); ++it) {
-        args.push_back(*it);
+        m_tokens.emplace_back(begin, std::size_t(p - begin));
     }
 
-    command(cmd, args);
+    // Ignore empty lines
+    if (m_tokens.empty()) return;
+
+    command(m_tokens.front(), Args{m_tokens.data() + 1, m_tokens.size() - 1});
 }
 
 void Loader::fileLoaded()
 {
     // Do nothing by default
 }
+
+//------------------------------------------------------------------------------
+
+float Loader::toFloat(std::string_view str)
+{
+    float value = 0.0f;
+    if (!parse::number(str, value))
+        throw std::invalid_argument{"Not a number: " + std::string{str}};
+    return value;
+}
+
+long Loader::toLong(std::string_view str)
+{
+    long value = 0;
+    if (!parse::number(str.data(), str.data() + str.size(), value))
+        throw std::invalid_argument{"Not a number: " + std::string{str}};
+    return value;
+}
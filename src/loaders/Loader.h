@@ -1,29 +1,68 @@
 #ifndef LOADER_H
 #define LOADER_H
 
+#include <filesystem>
 #include <istream>
 #include <string>
+#include <string_view>
 #include <vector>
-#include <filesystem>
 
 /**
  * @brief Base class for Loaders
  *
  * Obj, Mtl, Map or any other file loader can inherit from this class.
+ *
+ * Input is split into lines and whitespace separated tokens without copying. Tokens are views
+ * into the loaded buffer and are valid only during command() call. Double quotes group tokens
+ * with spaces, e.g. face="Times New Roman" is one token.
  */
 class Loader
 {
   public:
-    Loader() = default;
+    /// Tokens of one line (poor man's std::span)
+    class Args final
+    {
+      public:
+        Args(const std::string_view* data, std::size_t size)
+            : m_data{data}
+            , m_size{size}
+        {
+        }
+
+        std::size_t size() const { return m_size; }
+        bool empty() const { return m_size == 0; }
+
+        const std::string_view& operator[](std::size_t i) const { return m_data[i]; }
+        const std::string_view& at(std::size_t i) const;
+
+        const std::string_view* begin() const { return m_data; }
+        const std::string_view* end() const { return m_data + m_size; }
+
+      private:
+        const std::string_view* m_data;
+        std::size_t m_size;
+    };
+
+    Loader()          = default;
     virtual ~Loader() = default;
 
+    /// File is read through Vfs (memory mapped or from a pack). Parse errors are thrown.
     void load(const std::filesystem::path& file);
     void load(std::istream& stream);
+    /// Splits source into lines. Binary formats can override it.
+    virtual void loadFromMemory(std::string_view source);
 
   protected:
-    virtual void command(const std::string& cmd, const std::vector<std::string>& args) = 0;
+    virtual void command(std::string_view cmd, Args args) = 0;
     virtual void fileLoaded();
-    virtual void parseLine(const std::string& line);
+    virtual void parseLine(std::string_view line);
+
+    /// Number parsing helpers. Throw std::invalid_argument like std::stof.
+    static float toFloat(std::string_view str);
+    static long toLong(std::string_view str);
+
+  private:
+    std::vector<std::string_view> m_tokens; //< Reused between lines
 };
 
 #endif // LOADER_H
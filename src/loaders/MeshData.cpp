@@ -56,7 +56,7 @@ MeshData MeshData::fromWavefrontObj(const std::string& objfileName)
     MeshData meshData;
 
     loaders::ObjLoader objLoader;
-    objLoader.load(objfileName);
+    objLoader.load(std::filesystem::path{objfileName});
 
     meshData.primitive = GLenum(objLoader.primitive());
     meshData.positions = objLoader.positions();
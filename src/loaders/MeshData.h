@@ -4,6 +4,7 @@
 #include <GL/glew.h>
 #include <glm/glm.hpp>
 
+#include <cstdint>
 #include <string>
 #include <vector>
 
@@ -13,7 +14,7 @@ struct MeshData final
     std::vector<glm::vec3> positions;
     std::vector<glm::vec3> normals;
     std::vector<glm::vec2> texcoords;
-    std::vector<unsigned short> indices;
+    std::vector<uint32_t> indices;
     std::string name;
 
     static MeshData fromWavefrontObj(const std::string& objfileName);
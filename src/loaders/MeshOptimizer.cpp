@@ -0,0 +1,348 @@
+#include "MeshOptimizer.h"
+
+#include "../Logger.h"
+#include "PrimitiveData.h"
+
+#include <algorithm>
+#include <numeric> // iota
+
+namespace loaders {
+
+namespace {
+
+// Vertex -> triangles adjacency in compressed (CSR) form
+struct Adjacency
+{
+    std::vector<uint32_t> offsets; //< vertexCount + 1 entries
+    std::vector<uint32_t> triangles;
+
+    uint32_t degree(std::size_t vertex) const { return offsets[vertex + 1] - offsets[vertex]; }
+};
+
+Adjacency buildAdjacency(const std::vector<uint32_t>& indices, std::size_t vertexCount)
+{
+    Adjacency adj;
+    adj.offsets.assign(vertexCount + 1, 0);
+
+    for (auto index : indices)
+        ++adj.offsets[index + 1];
+
+    std::partial_sum(std::begin(adj.offsets), std::end(adj.offsets), std::begin(adj.offsets));
+
+    adj.triangles.resize(indices.size());
+    std::vector<uint32_t> cursor{std::cbegin(adj.offsets), std::cend(adj.offsets) - 1};
+
+    for (std::size_t i = 0; i < indices.size(); ++i)
+        adj.triangles[cursor[indices[i]]++] = static_cast<uint32_t>(i / 3);
+
+    return adj;
+}
+
+// FIFO cache simulation with timestamps. Vertex is in cache if it was inserted during last
+// cacheSize insertions.
+class CacheSimulator
+{
+  public:
+    CacheSimulator(std::size_t vertexCount, unsigned cacheSize)
+        : m_cacheTime(vertexCount, 0)
+        , m_cacheSize{cacheSize}
+        , m_timestamp{cacheSize + 1}
+    {
+    }
+
+    bool access(uint32_t vertex)
+    {
+        if (m_timestamp - m_cacheTime[vertex] > m_cacheSize) {
+            m_cacheTime[vertex] = m_timestamp++;
+            return true; // miss
+        }
+        return false;
+    }
+
+    unsigned triangleMisses(const std::vector<uint32_t>& indices, std::size_t triangle)
+    {
+        return access(indices[triangle * 3 + 0]) + access(indices[triangle * 3 + 1]) +
+               access(indices[triangle * 3 + 2]);
+    }
+
+    void flush() { m_timestamp += m_cacheSize + 1; }
+
+    bool wasReferenced(uint32_t vertex) const { return m_cacheTime[vertex] != 0; }
+
+  private:
+    std::vector<uint32_t> m_cacheTime;
+    const unsigned m_cacheSize;
+    uint32_t m_timestamp;
+};
+
+} // namespace
+
+//------------------------------------------------------------------------------
+
+VertexCacheStats analyzeVertexCache(const std::vector<uint32_t>& indices, std::size_t vertexCount,
+                                    unsigned cacheSize)
+{
+    VertexCacheStats stats;
+
+    if (indices.size() < 3) return stats;
+
+    CacheSimulator cache{vertexCount, cacheSize};
+
+    std::size_t misses = 0;
+    for (auto index : indices)
+        misses += cache.access(index);
+
+    std::size_t referenced = 0;
+    for (std::size_t v = 0; v < vertexCount; ++v)
+        referenced += cache.wasReferenced(static_cast<uint32_t>(v));
+
+    stats.acmr = float(misses) / (indices.size() / 3);
+    stats.atvr = referenced ? float(misses) / referenced : 0.0f;
+
+    return stats;
+}
+
+//------------------------------------------------------------------------------
+
+std::vector<uint32_t> optimizeVertexCache(const std::vector<uint32_t>& indices,
+                                          std::size_t vertexCount, unsigned cacheSize,
+                                          std::vector<uint32_t>* clusters)
+{
+    const std::size_t triangleCount = indices.size() / 3;
+    const Adjacency adj             = buildAdjacency(indices, vertexCount);
+
+    std::vector<uint32_t> liveTriangles(vertexCount);
+    for (std::size_t v = 0; v < vertexCount; ++v)
+        liveTriangles[v] = adj.degree(v);
+
+    std::vector<uint32_t> cacheTime(vertexCount, 0);
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<uint32_t> deadEnd;
+    std::vector<uint32_t> candidates;
+    deadEnd.reserve(indices.size());
+
+    std::vector<uint32_t> result;
+    result.reserve(triangleCount * 3);
+
+    if (clusters) clusters->clear();
+
+    uint32_t timestamp = cacheSize + 1;
+    std::size_t cursor = 0;
+
+    const auto skipDeadEnd = [&]() -> int64_t {
+        // Recently used vertices first
+        while (!deadEnd.empty()) {
+            const uint32_t v = deadEnd.back();
+            deadEnd.pop_back();
+            if (liveTriangles[v] > 0) return v;
+        }
+        // Then any vertex in input order
+        for (; cursor < vertexCount; ++cursor) {
+            if (liveTriangles[cursor] > 0) return static_cast<int64_t>(cursor);
+        }
+        return -1;
+    };
+
+    int64_t fanning = skipDeadEnd();
+    bool jumped     = true;
+
+    while (fanning >= 0) {
+        if (jumped && clusters) clusters->push_back(static_cast<uint32_t>(result.size() / 3));
+
+        candidates.clear();
+
+        for (uint32_t i = adj.offsets[fanning]; i < adj.offsets[fanning + 1]; ++i) {
+            const uint32_t t = adj.triangles[i];
+            if (emitted[t]) continue;
+
+            for (int j = 0; j < 3; ++j) {
+                const uint32_t v = indices[t * 3 + j];
+                result.push_back(v);
+                deadEnd.push_back(v);
+                candidates.push_back(v);
+                --liveTriangles[v];
+
+                if (timestamp - cacheTime[v] > cacheSize) cacheTime[v] = timestamp++;
+            }
+            emitted[t] = true;
+        }
+
+        // Select 1-ring vertex that will still be in cache after its fan is emitted
+        int64_t next         = -1;
+        int64_t bestPriority = -1;
+        for (auto v : candidates) {
+            if (liveTriangles[v] == 0) continue;
+
+            int64_t priority = 0;
+            const int64_t age = int64_t(timestamp) - cacheTime[v];
+            if (age + 2 * int64_t(liveTriangles[v]) <= cacheSize) priority = age;
+
+            if (priority > bestPriority) {
+                bestPriority = priority;
+                next         = v;
+            }
+        }
+
+        jumped = next == -1;
+        if (jumped) next = skipDeadEnd();
+
+        fanning = next;
+    }
+
+    return result;
+}
+
+//------------------------------------------------------------------------------
+
+std::vector<uint32_t> optimizeOverdraw(const std::vector<uint32_t>& indices,
+                                       const std::vector<glm::vec3>& positions,
+                                       const std::vector<uint32_t>& hardClusters,
+                                       unsigned cacheSize, float threshold)
+{
+    const std::size_t triangleCount = indices.size() / 3;
+
+    if (triangleCount == 0 || hardClusters.empty() || positions.empty()) return indices;
+
+    // Split hard clusters further at points where ACMR is close to cluster's one
+    std::vector<uint32_t> clusters;
+    CacheSimulator cache{positions.size(), cacheSize};
+
+    for (std::size_t c = 0; c < hardClusters.size(); ++c) {
+        const std::size_t start = hardClusters[c];
+        const std::size_t end = c + 1 < hardClusters.size() ? hardClusters[c + 1] : triangleCount;
+        if (start >= end) continue;
+
+        cache.flush();
+        unsigned clusterMisses = 0;
+        for (std::size_t t = start; t < end; ++t)
+            clusterMisses += cache.triangleMisses(indices, t);
+
+        const float clusterThreshold = threshold * clusterMisses / float(end - start);
+
+        clusters.push_back(static_cast<uint32_t>(start));
+
+        cache.flush();
+        unsigned runningMisses    = 0;
+        unsigned runningTriangles = 0;
+        for (std::size_t t = start; t < end; ++t) {
+            runningMisses += cache.triangleMisses(indices, t);
+            ++runningTriangles;
+
+            if (t + 1 < end && float(runningMisses) / runningTriangles <= clusterThreshold) {
+                clusters.push_back(static_cast<uint32_t>(t + 1));
+                cache.flush();
+                runningMisses    = 0;
+                runningTriangles = 0;
+            }
+        }
+    }
+
+    glm::vec3 meshCentroid{0.0f};
+    for (const auto& p : positions)
+        meshCentroid += p;
+    meshCentroid /= float(positions.size());
+
+    // Clusters facing outwards are probable occluders so they should be drawn first
+    std::vector<float> sortKeys(clusters.size());
+
+    for (std::size_t c = 0; c < clusters.size(); ++c) {
+        const std::size_t start = clusters[c];
+        const std::size_t end   = c + 1 < clusters.size() ? clusters[c + 1] : triangleCount;
+
+        glm::vec3 centroid{0.0f};
+        glm::vec3 normal{0.0f};
+        float area = 0.0f;
+
+        for (std::size_t t = start; t < end; ++t) {
+            const glm::vec3& p0 = positions[indices[t * 3 + 0]];
+            const glm::vec3& p1 = positions[indices[t * 3 + 1]];
+            const glm::vec3& p2 = positions[indices[t * 3 + 2]];
+
+            const glm::vec3 n = glm::cross(p1 - p0, p2 - p0);
+            const float a     = glm::length(n);
+
+            centroid += (p0 + p1 + p2) * (a / 3.0f);
+            normal += n;
+            area += a;
+        }
+
+        if (area > 0.0f) centroid /= area;
+
+        const float normalLength = glm::length(normal);
+        if (normalLength > 0.0f) normal /= normalLength;
+
+        sortKeys[c] = glm::dot(centroid - meshCentroid, normal);
+    }
+
+    std::vector<uint32_t> order(clusters.size());
+    std::iota(std::begin(order), std::end(order), 0);
+    std::stable_sort(std::begin(order), std::end(order),
+                     [&sortKeys](uint32_t l, uint32_t r) { return sortKeys[l] > sortKeys[r]; });
+
+    std::vector<uint32_t> result;
+    result.reserve(indices.size());
+
+    for (auto c : order) {
+        const std::size_t start = clusters[c];
+        const std::size_t end   = c + 1 < clusters.size() ? clusters[c + 1] : triangleCount;
+        result.insert(std::end(result), std::cbegin(indices) + start * 3,
+                      std::cbegin(indices) + end * 3);
+    }
+
+    return result;
+}
+
+//------------------------------------------------------------------------------
+
+std::vector<uint32_t> optimizeVertexFetch(std::vector<uint32_t>& indices, std::size_t vertexCount,
+                                          std::size_t* newVertexCount)
+{
+    std::vector<uint32_t> remap(vertexCount, ~0u);
+    uint32_t next = 0;
+
+    for (auto& index : indices) {
+        if (remap[index] == ~0u) remap[index] = next++;
+        index = remap[index];
+    }
+
+    if (newVertexCount) *newVertexCount = next;
+
+    return remap;
+}
+
+//------------------------------------------------------------------------------
+
+OptimizationReport optimizeMesh(PrimitiveData& primitive)
+{
+    const unsigned cacheSize = 16;
+
+    OptimizationReport report;
+
+    if (!primitive.isIndexedTriangles() || primitive.indices.size() % 3 != 0) return report;
+
+    const std::size_t vertexCount = primitive.vertexCount();
+    auto& indices                 = primitive.indices;
+
+    if (std::any_of(std::cbegin(indices), std::cend(indices),
+                    [vertexCount](uint32_t i) { return i >= vertexCount; })) {
+        LOG_WARNING("Mesh optimization skipped: index out of range");
+        return report;
+    }
+
+    report.triangles = indices.size() / 3;
+    report.before    = analyzeVertexCache(indices, vertexCount, cacheSize);
+
+    std::vector<uint32_t> clusters;
+    indices = optimizeVertexCache(indices, vertexCount, cacheSize, &clusters);
+    indices = optimizeOverdraw(indices, primitive.positions(), clusters, cacheSize);
+
+    std::size_t newVertexCount = 0;
+    const auto remap           = optimizeVertexFetch(indices, vertexCount, &newVertexCount);
+    primitive.remapVertices(remap, newVertexCount);
+
+    report.after = analyzeVertexCache(indices, newVertexCount, cacheSize);
+
+    return report;
+}
+
+} // namespace loaders
@@ -0,0 +1,64 @@
+#ifndef LOADERS_MESHOPTIMIZER_H
+#define LOADERS_MESHOPTIMIZER_H
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace loaders {
+
+struct PrimitiveData;
+
+struct VertexCacheStats
+{
+    float acmr = 0.0f; //< Average cache miss ratio (misses per triangle)
+    float atvr = 0.0f; //< Average transform to vertex ratio (misses per referenced vertex)
+};
+
+/// Simulates FIFO post-transform cache of given size.
+VertexCacheStats analyzeVertexCache(const std::vector<uint32_t>& indices, std::size_t vertexCount,
+                                    unsigned cacheSize = 16);
+
+/**
+ * @brief Reorders triangles for post-transform vertex cache (Tipsify).
+ *
+ * Sander, Nehab, Barczak: Fast Triangle Reordering for Vertex Locality and Reduced Overdraw.
+ * If clusters is not null it receives index of first triangle of every cluster (hard
+ * boundaries where the algorithm had to jump to non-adjacent triangle).
+ */
+std::vector<uint32_t> optimizeVertexCache(const std::vector<uint32_t>& indices,
+                                          std::size_t vertexCount, unsigned cacheSize = 16,
+                                          std::vector<uint32_t>* clusters = nullptr);
+
+/**
+ * @brief Reorders clusters of cache optimized triangles so that probable occluders go first.
+ *
+ * threshold controls how much ACMR may degrade when clusters are split further.
+ */
+std::vector<uint32_t> optimizeOverdraw(const std::vector<uint32_t>& indices,
+                                       const std::vector<glm::vec3>& positions,
+                                       const std::vector<uint32_t>& clusters,
+                                       unsigned cacheSize = 16, float threshold = 1.05f);
+
+/**
+ * @brief Reorders vertices in order of first use and rewrites indices.
+ *
+ * Returns remap table: remap[oldIndex] = newIndex or ~0u for unreferenced vertices.
+ */
+std::vector<uint32_t> optimizeVertexFetch(std::vector<uint32_t>& indices, std::size_t vertexCount,
+                                          std::size_t* newVertexCount = nullptr);
+
+struct OptimizationReport
+{
+    VertexCacheStats before;
+    VertexCacheStats after;
+    std::size_t triangles = 0;
+};
+
+/// Runs all passes on indexed triangle list. Other primitives are left untouched.
+OptimizationReport optimizeMesh(PrimitiveData& primitive);
+
+} // namespace loaders
+
+#endif // LOADERS_MESHOPTIMIZER_H
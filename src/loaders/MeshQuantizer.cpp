@@ -0,0 +1,172 @@
+#include "MeshQuantizer.h"
+
+#include "PrimitiveData.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/packing.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace loaders {
+
+namespace {
+
+using Attribute = PrimitiveData::Attribute;
+
+template <typename T>
+T quantizeUnorm(float v)
+{
+    constexpr float max = std::numeric_limits<T>::max();
+    return static_cast<T>(std::clamp(v, 0.0f, 1.0f) * max + 0.5f);
+}
+
+template <typename T>
+T quantizeSnorm(float v)
+{
+    constexpr float max = std::numeric_limits<T>::max();
+    return static_cast<T>(std::round(std::clamp(v, -1.0f, 1.0f) * max));
+}
+
+/// Attribute of count zeroed elements
+template <typename T>
+AttributeData makeAttribute(unsigned count, unsigned size, GLenum type, bool normalized)
+{
+    AttributeData ans;
+    ans.count      = count;
+    ans.size       = size;
+    ans.type       = type;
+    ans.normalized = normalized;
+    ans.data.resize(std::size_t(count) * size * sizeof(T));
+    return ans;
+}
+
+std::size_t byteSize(const PrimitiveData& primitive)
+{
+    std::size_t bytes = 0;
+    for (const auto& attribute : primitive.attributes)
+        bytes += attribute.data.size();
+    return bytes;
+}
+
+//------------------------------------------------------------------------------
+
+AttributeData quantizePositions(const AttributeData& attribute, glm::vec3 offset, float scale)
+{
+    auto ans = makeAttribute<uint16_t>(attribute.count, 4, GL_UNSIGNED_SHORT, true);
+    auto out = ans.as<uint16_t>();
+
+    for (std::size_t i = 0; i < attribute.count; ++i) {
+        for (unsigned c = 0; c < 3; ++c) {
+            const float v  = (attribute.getFloat(i, c) - offset[c]) / scale;
+            out[i * 4 + c] = quantizeUnorm<uint16_t>(v);
+        }
+    }
+
+    return ans;
+}
+
+/// Normals and tangents. Tangent w (handedness) is kept as +-1.
+AttributeData quantizeDirections(const AttributeData& attribute)
+{
+    auto ans = makeAttribute<int8_t>(attribute.count, 4, GL_BYTE, true);
+    auto out = ans.as<int8_t>();
+
+    for (std::size_t i = 0; i < attribute.count; ++i) {
+        glm::vec3 v{attribute.getFloat(i, 0), attribute.getFloat(i, 1), attribute.getFloat(i, 2)};
+        const float length = glm::length(v);
+        if (length > 0.0f) v /= length;
+
+        for (unsigned c = 0; c < 3; ++c)
+            out[i * 4 + c] = quantizeSnorm<int8_t>(v[c]);
+        if (attribute.size == 4) out[i * 4 + 3] = attribute.getFloat(i, 3) < 0.0f ? -127 : 127;
+    }
+
+    return ans;
+}
+
+AttributeData quantizeTexCoords(const AttributeData& attribute)
+{
+    bool inUnitRange = true;
+    for (std::size_t i = 0; i < attribute.count && inUnitRange; ++i) {
+        for (unsigned c = 0; c < 2; ++c) {
+            const float v = attribute.getFloat(i, c);
+            inUnitRange   = inUnitRange && v >= 0.0f && v <= 1.0f;
+        }
+    }
+
+    // Tiled coordinates need range, half float keeps 11 bits of precision
+    auto ans = inUnitRange ? makeAttribute<uint16_t>(attribute.count, 2, GL_UNSIGNED_SHORT, true)
+                           : makeAttribute<uint16_t>(attribute.count, 2, GL_HALF_FLOAT, false);
+    auto out = ans.as<uint16_t>();
+
+    for (std::size_t i = 0; i < attribute.count; ++i) {
+        for (unsigned c = 0; c < 2; ++c) {
+            const float v  = attribute.getFloat(i, c);
+            out[i * 2 + c] = inUnitRange ? quantizeUnorm<uint16_t>(v) : glm::packHalf1x16(v);
+        }
+    }
+
+    return ans;
+}
+
+} // namespace
+
+//------------------------------------------------------------------------------
+
+QuantizationReport quantizeMesh(std::vector<PrimitiveData>& primitives)
+{
+    QuantizationReport report;
+
+    bool quantizePosition = !primitives.empty();
+    glm::vec3 minimum{std::numeric_limits<float>::max()};
+    glm::vec3 maximum{std::numeric_limits<float>::lowest()};
+
+    for (const auto& primitive : primitives) {
+        const auto& position = primitive.attributes[Attribute::Position];
+        if (position.type != GL_FLOAT || !primitive.targets.empty() ||
+            !primitive.attributes[Attribute::Joints_0].empty()) {
+            quantizePosition = false;
+            break;
+        }
+
+        for (const auto& p : primitive.positions()) {
+            minimum = glm::min(minimum, p);
+            maximum = glm::max(maximum, p);
+        }
+    }
+
+    // Uniform scale keeps normal matrix of the model view matrix valid
+    const glm::vec3 extent = maximum - minimum;
+    const float scale      = std::max({extent.x, extent.y, extent.z});
+    if (scale <= 0.0f) quantizePosition = false;
+
+    for (auto& primitive : primitives) {
+        report.bytesBefore += byteSize(primitive);
+
+        auto& attributes = primitive.attributes;
+
+        if (quantizePosition) {
+            attributes[Attribute::Position] =
+                quantizePositions(attributes[Attribute::Position], minimum, scale);
+            primitive.dequantization =
+                glm::scale(glm::translate(glm::mat4{1.0f}, minimum), glm::vec3{scale});
+        }
+
+        for (auto attr : {Attribute::Normal, Attribute::Tangent}) {
+            if (!attributes[attr].empty() && attributes[attr].type == GL_FLOAT)
+                attributes[attr] = quantizeDirections(attributes[attr]);
+        }
+
+        auto& texCoords = attributes[Attribute::TexCoord_0];
+        if (!texCoords.empty() && texCoords.type == GL_FLOAT)
+            texCoords = quantizeTexCoords(texCoords);
+
+        report.bytesAfter += byteSize(primitive);
+    }
+
+    return report;
+}
+
+} // namespace loaders
@@ -0,0 +1,30 @@
+#ifndef LOADERS_MESHQUANTIZER_H
+#define LOADERS_MESHQUANTIZER_H
+
+#include <cstddef>
+#include <vector>
+
+namespace loaders {
+
+struct PrimitiveData;
+
+struct QuantizationReport
+{
+    std::size_t bytesBefore = 0; //< Vertex attributes of quantized primitives
+    std::size_t bytesAfter  = 0;
+};
+
+/**
+ * @brief Stores vertex attributes of one mesh in the compact formats of KHR_mesh_quantization.
+ *
+ * Positions become 16-bit unorm inside the mesh bounding cube, PrimitiveData::dequantization
+ * maps them back and is the same for all primitives of the mesh. Normals and tangents become
+ * 8-bit snorm, texture coordinates 16-bit unorm (half float when outside [0, 1]). Components are
+ * padded to 4 bytes. Positions of skinned and morphed meshes stay float because dequantization
+ * is applied to the model view matrix. Attributes that are already integer are left untouched.
+ */
+QuantizationReport quantizeMesh(std::vector<PrimitiveData>& primitives);
+
+} // namespace loaders
+
+#endif // LOADERS_MESHQUANTIZER_H
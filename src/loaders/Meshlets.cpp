@@ -0,0 +1,114 @@
+#include "Meshlets.h"
+
+#include "PrimitiveData.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace loaders {
+
+/// Bounding sphere and normal cone, cone construction follows meshoptimizer
+static void computeBounds(gfx::Meshlet& meshlet, const std::vector<glm::vec3>& positions,
+                          const std::vector<uint32_t>& indices)
+{
+    const auto first = std::cbegin(indices) + meshlet.firstIndex;
+    const auto last  = first + meshlet.indexCount;
+
+    glm::vec3 minimum{std::numeric_limits<float>::max()};
+    glm::vec3 maximum{std::numeric_limits<float>::lowest()};
+    for (auto it = first; it != last; ++it) {
+        minimum = glm::min(minimum, positions[*it]);
+        maximum = glm::max(maximum, positions[*it]);
+    }
+
+    meshlet.center = (minimum + maximum) * 0.5f;
+    meshlet.radius = 0.0f;
+    for (auto it = first; it != last; ++it)
+        meshlet.radius = std::max(meshlet.radius, glm::distance(meshlet.center, positions[*it]));
+
+    // Per triangle, zero for degenerate ones
+    std::vector<glm::vec3> normals;
+    glm::vec3 axis{0.0f};
+    for (auto it = first; it != last; it += 3) {
+        const glm::vec3& p0 = positions[it[0]];
+        const glm::vec3 n   = glm::cross(positions[it[1]] - p0, positions[it[2]] - p0);
+        const float length  = glm::length(n);
+
+        normals.push_back(length > 0.0f ? n / length : glm::vec3{0.0f});
+        axis += normals.back();
+    }
+
+    meshlet.coneApex   = meshlet.center;
+    meshlet.coneCutoff = 1.0f;
+    if (glm::length(axis) <= 0.0f) return;
+
+    meshlet.coneAxis = glm::normalize(axis);
+
+    float minDot = 1.0f;
+    for (const auto& n : normals) {
+        if (n != glm::vec3{0.0f}) minDot = std::min(minDot, glm::dot(n, meshlet.coneAxis));
+    }
+
+    // Cone wider than ~84 degrees would hardly ever reject anything
+    if (minDot <= 0.1f) return;
+
+    // Apex is moved back so that no triangle plane passes behind it
+    float maxT = 0.0f;
+    for (std::size_t t = 0; t < normals.size(); ++t) {
+        const glm::vec3& n = normals[t];
+        if (n == glm::vec3{0.0f}) continue;
+
+        const glm::vec3& p0 = positions[first[t * 3]];
+
+        maxT = std::max(maxT, glm::dot(meshlet.center - p0, n) / glm::dot(meshlet.coneAxis, n));
+    }
+
+    meshlet.coneApex   = meshlet.center - meshlet.coneAxis * maxT;
+    meshlet.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+}
+
+//------------------------------------------------------------------------------
+
+std::vector<gfx::Meshlet> buildMeshlets(const PrimitiveData& primitive, std::size_t maxVertices,
+                                        std::size_t maxTriangles)
+{
+    if (!primitive.isIndexedTriangles()) return {};
+
+    const auto positions = primitive.positions();
+    const auto& indices  = primitive.indices;
+
+    std::vector<gfx::Meshlet> meshlets;
+    std::vector<uint32_t> lastMeshlet(positions.size(), ~0u); //< Meshlet that referenced vertex
+    std::size_t vertices = 0;
+
+    for (std::size_t i = 0; i + 2 < indices.size(); i += 3) {
+        const uint32_t a = indices[i], b = indices[i + 1], c = indices[i + 2];
+
+        const auto newVertices = [&](uint32_t id) {
+            return std::size_t(lastMeshlet[a] != id) + (lastMeshlet[b] != id && b != a) +
+                   (lastMeshlet[c] != id && c != a && c != b);
+        };
+
+        uint32_t id = static_cast<uint32_t>(meshlets.size()) - 1;
+        if (meshlets.empty() || vertices + newVertices(id) > maxVertices ||
+            meshlets.back().indexCount >= maxTriangles * 3) {
+            gfx::Meshlet meshlet;
+            meshlet.firstIndex = static_cast<uint32_t>(i);
+            meshlets.push_back(meshlet);
+            vertices = 0;
+            ++id;
+        }
+
+        vertices += newVertices(id);
+        lastMeshlet[a] = lastMeshlet[b] = lastMeshlet[c] = id;
+        meshlets.back().indexCount += 3;
+    }
+
+    for (auto& meshlet : meshlets)
+        computeBounds(meshlet, positions, indices);
+
+    return meshlets;
+}
+
+} // namespace loaders
@@ -0,0 +1,26 @@
+#ifndef LOADERS_MESHLETS_H
+#define LOADERS_MESHLETS_H
+
+#include "../gfx/Mesh.h"
+
+#include <vector>
+
+namespace loaders {
+
+struct PrimitiveData;
+
+/**
+ * @brief Splits indexed triangle list into meshlets for gfx::Primitive::cull.
+ *
+ * Triangles are taken in index buffer order, so meshlets are continuous ranges and vertex cache
+ * optimization is preserved. A meshlet ends when it would reference more than maxVertices
+ * vertices or hold more than maxTriangles triangles. Bounds use dequantized positions.
+ * Primitives that are not indexed triangle lists get no meshlets.
+ */
+std::vector<gfx::Meshlet> buildMeshlets(const PrimitiveData& primitive,
+                                        std::size_t maxVertices  = 64,
+                                        std::size_t maxTriangles = 124);
+
+} // namespace loaders
+
+#endif // LOADERS_MESHLETS_H
@@ -4,16 +4,15 @@
 
 #include <glm/glm.hpp>
 
-static inline glm::vec3 to_glmvec3(const std::vector<std::string>& args)
+void MtlLoader::command(std::string_view cmd, Args args)
 {
-    return glm::vec3(std::stof(args.at(0)), std::stof(args.at(1)), std::stof(args.at(2)));
-}
+    const auto to_glmvec3 = [](Args args) {
+        return glm::vec3(toFloat(args.at(0)), toFloat(args.at(1)), toFloat(args.at(2)));
+    };
 
-void MtlLoader::command(const std::string& cmd, const std::vector<std::string>& args)
-{
     if (cmd == "newmtl") {
         MaterialData mtl;
-        mtl.name = args.at(0);
+        mtl.name = std::string{args.at(0)};
         m_materials.push_back(mtl);
     } else if (cmd == "Ka") {
         MaterialData& mtl = m_materials.back();
@@ -26,7 +25,7 @@ void MtlLoader::command(const std::string& cmd, const std::vector<std::string>&
         mtl.specular      = to_glmvec3(args);
     } else if (cmd == "Ns") {
         MaterialData& mtl = m_materials.back();
-        mtl.shininess     = std::stof(args.at(0));
+        mtl.shininess     = toFloat(args.at(0));
     } else if (cmd == "map_Ka" || cmd == "map_Kd" || cmd == "map_Ks" || cmd == "map_Kn" ||
                cmd == "cube_Ka" || cmd == "cube_Kd" || cmd == "cube_Ks" || cmd == "cube_Kn") {
         MaterialData& mtl = m_materials.back();
@@ -37,11 +36,10 @@ void MtlLoader::command(const std::string& cmd, const std::vector<std::string>&
     }
 }
 
-TextureData MtlLoader::toTextureData(const std::string& /*cmd*/,
-                                     const std::vector<std::string>& args) const
+TextureData MtlLoader::toTextureData(std::string_view /*cmd*/, Args args) const
 {
     TextureData texData;
-    std::string currOpt;
+    std::string_view currOpt;
 
     for (std::size_t i = 0; i < args.size(); ++i) {
         if (args.at(i)[0] == '-') {
@@ -54,10 +52,10 @@ TextureData MtlLoader::toTextureData(const std::string& /*cmd*/,
         } else if (currOpt == "-cc") {
             texData.linearColor = args.at(i) != "on";
         } else {
-            texData.filename = args.at(i);
+            texData.filename = std::string{args.at(i)};
         }
 
-        currOpt = "";
+        currOpt = {};
     }
 
     texData.name = texData.filename;
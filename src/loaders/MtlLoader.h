@@ -12,10 +12,10 @@ class MtlLoader : public Loader
     std::vector<MaterialData> materials() const { return m_materials; }
 
   protected:
-    void command(const std::string& cmd, const std::vector<std::string>& args);
+    void command(std::string_view cmd, Args args) override;
 
   private:
-    TextureData toTextureData(const std::string& cmd, const std::vector<std::string>& args) const;
+    TextureData toTextureData(std::string_view cmd, Args args) const;
 
     std::vector<MaterialData> m_materials;
 };
@@ -1,193 +1,422 @@
 #include "ObjLoader.h"
 
-#include "../Util.h"
+#include "../Logger.h"
+#include "../ThreadPool.h"
+#include "../Vfs.h"
+#include "MeshOptimizer.h"
+#include "Parse.h"
+#include "PrimitiveData.h"
+#include "Tangents.h"
+
 #include <algorithm>
+#include <chrono>
+#include <limits>
 
 namespace loaders {
 
-std::vector<glm::vec3> ObjLoader::positions() const
+namespace {
+
+const int32_t noIndex = std::numeric_limits<int32_t>::min();
+
+// Zero based indices of position, texture coordinate and normal
+struct Corner
 {
-    if (!m_oglFaces.empty()) {
-        std::vector<glm::vec3> positions_a;
-        positions_a.reserve(m_oglVertices.size());
+    int32_t index[3] = {noIndex, noIndex, noIndex};
+    uint8_t relative = 0; //< Bit mask of indices relative to chunk start (negative in file)
 
-        for (const auto& v : m_oglVertices) {
-            positions_a.push_back(v.p);
-        }
-        return positions_a;
+    bool operator==(const Corner& other) const
+    {
+        return index[0] == other.index[0] && index[1] == other.index[1] &&
+               index[2] == other.index[2];
     }
+};
 
-    return m_positions;
-}
+struct Chunk
+{
+    std::string_view source;
+
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec3> normals;
+    std::vector<glm::vec2> texCoords;
+    std::vector<Corner> corners; //< Three per triangle
+};
 
 //------------------------------------------------------------------------------
 
-std::vector<glm::vec3> ObjLoader::normals() const
+[[noreturn]] void malformed(const char* first, const char* last)
+{
+    throw std::runtime_error{"Malformed OBJ line: " + std::string{first, last}};
+}
+
+/// Components after the required ones may be left out, they are 0 then
+template <typename Vec>
+Vec parseVector(const char* p, const char* eol, int required = Vec::length())
+{
+    Vec v{0.0f};
+    for (int i = 0; i < Vec::length(); ++i) {
+        const char* first = parse::skipSpaces(p, eol);
+        if (i >= required && first == eol) break;
+
+        p = parse::number(first, eol, v[i]);
+        if (!p) malformed(first, eol);
+    }
+    return v;
+}
+
+void parseFace(const char* p, const char* eol, Chunk& chunk, std::vector<Corner>& polygon)
 {
-    if (!m_oglFaces.empty()) {
-        std::vector<glm::vec3> normals_a;
-        normals_a.reserve(m_oglVertices.size());
+    const std::size_t counts[3] = {chunk.positions.size(), chunk.texCoords.size(),
+                                   chunk.normals.size()};
+    const char* line            = p;
+
+    polygon.clear();
+
+    for (p = parse::skipSpaces(p, eol); p != eol; p = parse::skipSpaces(p, eol)) {
+        Corner corner;
+
+        //    v/vt/vn
+        // f 44/61/61 56/62/62 62/63/63
+        for (int i = 0; i < 3 && p != eol && !parse::isSpace(*p); ++i) {
+            if (i > 0) {
+                if (*p != '/') malformed(line, eol);
+                ++p;
+                if (p == eol || *p == '/' || parse::isSpace(*p)) continue; // v//vn
+            }
 
-        for (const auto& v : m_oglVertices) {
-            normals_a.push_back(v.n);
+            int32_t value = 0;
+            p             = parse::number(p, eol, value);
+            if (!p || value == 0) malformed(line, eol);
+
+            if (value > 0) {
+                corner.index[i] = value - 1;
+            } else {
+                corner.index[i] = static_cast<int32_t>(counts[i]) + value;
+                corner.relative |= 1 << i;
+            }
         }
-        return normals_a;
+
+        polygon.push_back(corner);
     }
 
-    return m_normals;
+    if (polygon.size() < 3) malformed(line, eol);
+
+    // Triangle fan
+    for (std::size_t i = 1; i + 1 < polygon.size(); ++i) {
+        chunk.corners.push_back(polygon[0]);
+        chunk.corners.push_back(polygon[i]);
+        chunk.corners.push_back(polygon[i + 1]);
+    }
 }
 
-//------------------------------------------------------------------------------
+void parseChunk(Chunk& chunk)
+{
+    const char* first = chunk.source.data();
+    const char* last  = first + chunk.source.size();
+
+    std::vector<Corner> polygon;
+
+    while (first != last) {
+        const char* p   = parse::skipSpaces(first, last);
+        const char* eol = static_cast<const char*>(std::memchr(p, '\n', last - p));
+        if (!eol) eol = last;
+        first = eol == last ? last : eol + 1;
+
+        if (p == eol || *p == '#') continue;
+
+        const char* cmdEnd = p;
+        while (cmdEnd != eol && !parse::isSpace(*cmdEnd))
+            ++cmdEnd;
+
+        const std::string_view cmd{p, std::size_t(cmdEnd - p)};
+
+        if (cmd == "v") {
+            // v -42.209999 19.670004 38.799995
+            chunk.positions.push_back(parseVector<glm::vec3>(cmdEnd, eol));
+        } else if (cmd == "vn") {
+            // vn -0.002913 -0.974373 -0.224919
+            chunk.normals.push_back(parseVector<glm::vec3>(cmdEnd, eol));
+        } else if (cmd == "vt") {
+            // vt 0.622800 0.226700, v is optional
+            chunk.texCoords.push_back(parseVector<glm::vec2>(cmdEnd, eol, 1));
+        } else if (cmd == "f") {
+            parseFace(cmdEnd, eol, chunk, polygon);
+        }
+        // mtllib, usemtl, o, g and s are ignored
+    }
+}
 
-std::vector<unsigned short> ObjLoader::indices() const
+// Splits source at line boundaries
+std::vector<Chunk> splitSource(std::string_view source, std::size_t count)
 {
-    std::vector<unsigned short> indices_a;
+    std::vector<Chunk> chunks;
+
+    const char* first = source.data();
+    const char* last  = first + source.size();
 
-    if (m_oglFaces.empty()) return indices_a;
+    for (std::size_t i = 0; i < count && first != last; ++i) {
+        const char* end = i + 1 == count ? last : std::min(last, first + source.size() / count);
+        end             = end == last ? last : parse::skipLine(end, last);
 
-    indices_a.reserve(m_oglFaces.size() * 3);
+        Chunk chunk;
+        chunk.source = std::string_view{first, std::size_t(end - first)};
+        chunks.push_back(std::move(chunk));
 
-    for (const auto& f : m_oglFaces) {
-        indices_a.push_back(f.indices[0]);
-        indices_a.push_back(f.indices[1]);
-        indices_a.push_back(f.indices[2]);
+        first = end;
     }
-    return indices_a;
+
+    return chunks;
+}
+
+template <typename T>
+std::vector<T> concatenate(const std::vector<Chunk>& chunks, std::vector<T> Chunk::*member,
+                           std::vector<std::size_t>& offsets)
+{
+    std::size_t total = 0;
+    offsets.clear();
+    for (const auto& chunk : chunks) {
+        offsets.push_back(total);
+        total += (chunk.*member).size();
+    }
+
+    std::vector<T> ans;
+    ans.reserve(total);
+    for (const auto& chunk : chunks)
+        ans.insert(std::end(ans), std::cbegin(chunk.*member), std::cend(chunk.*member));
+
+    return ans;
+}
+
+} // namespace
+
+//==============================================================================
+
+ObjLoader::ObjLoader(Options options)
+    : m_options{options}
+{
 }
 
 //------------------------------------------------------------------------------
 
-std::vector<glm::vec2> ObjLoader::texCoords() const
+void ObjLoader::load(const std::filesystem::path& file)
 {
-    if (!m_oglFaces.empty()) {
-        std::vector<glm::vec2> texcoords_a;
-        texcoords_a.reserve(m_oglVertices.size());
+    const auto start = std::chrono::steady_clock::now();
 
-        for (const auto& v : m_oglVertices) {
-            texcoords_a.push_back(v.t);
-        }
-        return texcoords_a;
-    }
+    const FileData data = Vfs::global().read(file);
+    load(data.view());
 
-    return m_texCoords;
+    m_name = file.filename().string();
+
+    const std::chrono::duration<float, std::milli> time = std::chrono::steady_clock::now() - start;
+    LOG_DEBUG("Loaded {}: {} vertices, {} triangles in {:.1f} ms", file.string(), m_vertices.size(),
+              m_indices.size() / 3, time.count());
 }
 
 //------------------------------------------------------------------------------
 
-void ObjLoader::command(const std::string& cmd, const std::vector<std::string>& args)
-{
-    if (cmd == "mtllib") {
-        // loadMtlLib(args[0]);
-    } else if (cmd == "v") {
-        // v -42.209999 19.670004 38.799995
-        glm::vec3 v;
-        v.x = std::stof(args[0]);
-        v.y = std::stof(args[1]);
-        v.z = std::stof(args[2]);
-        m_positions.push_back(v);
-
-    } else if (cmd == "vn") {
-        // vn -0.002913 -0.974373 -0.224919
-        glm::vec3 n;
-        n.x = std::stof(args[0]);
-        n.y = std::stof(args[1]);
-        n.z = std::stof(args[2]);
-        m_normals.push_back(n);
-
-    } else if (cmd == "vt") {
-        // vt 0.622800 0.226700
-        glm::vec2 tc;
-        tc.s = std::stof(args[0]);
-        tc.t = std::stof(args[1]);
-        m_texCoords.push_back(tc);
-
-    } else if (cmd == "f") {
-        //    v/vt/vn
-        // f 44/61/61 56/62/62 62/63/63
-        Face f;
-        std::vector<std::string> elems;
+void ObjLoader::load(std::string_view source)
+{
+    const std::size_t minChunkSize = 1 << 20;
 
-        for (int i = 0; i < 3; ++i) {
-            elems.clear();
-            split(args[i], '/', elems);
-            f.posIndices[i] = std::stoi(elems[0]) - 1;
+    ThreadPool& pool = ThreadPool::global();
 
-            if (elems.size() > 1 && !elems[1].empty()) f.texIndices[i] = std::stoi(elems[1]) - 1;
+    std::size_t chunkCount = 1;
+    if (m_options.parallel)
+        chunkCount = std::clamp<std::size_t>(source.size() / minChunkSize, 1,
+                                             pool.threadCount() + 1);
 
-            if (elems.size() > 2 && !elems[2].empty()) f.normIndices[i] = std::stoi(elems[2]) - 1;
-        }
-        m_faces.push_back(f);
-
-        // Quads are not supported, so one more triangle needs to be created
-        if (args.size() > 3) {
-            Face f2;
-            elems.clear();
-            split(args[3], '/', elems);
-
-            f2.posIndices[0] = f.posIndices[2];
-            f2.posIndices[1] = std::stoi(elems[0]) - 1;
-            f2.posIndices[2] = f.posIndices[0];
-
-            if (elems.size() > 1 && !elems[1].empty()) {
-                f2.texIndices[0] = f.texIndices[2];
-                f2.texIndices[1] = std::stoi(elems[1]) - 1;
-                f2.texIndices[2] = f.texIndices[0];
+    std::vector<Chunk> chunks = splitSource(source, chunkCount);
+
+    pool.parallelFor(chunks.size(), 1, [&chunks](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i)
+            parseChunk(chunks[i]);
+    });
+
+    std::vector<std::size_t> offsets[3];
+    const auto positions = concatenate(chunks, &Chunk::positions, offsets[0]);
+    const auto texCoords = concatenate(chunks, &Chunk::texCoords, offsets[1]);
+    const auto normals   = concatenate(chunks, &Chunk::normals, offsets[2]);
+
+    std::vector<std::size_t> cornerOffsets;
+    std::vector<Corner> corners = concatenate(chunks, &Chunk::corners, cornerOffsets);
+    chunks.clear();
+
+    const std::size_t counts[3] = {positions.size(), texCoords.size(), normals.size()};
+
+    // Relative indices are resolved against the beginning of their chunk
+    pool.parallelFor(cornerOffsets.size(), 1, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t c = begin; c < end; ++c) {
+            const std::size_t cornersEnd =
+                c + 1 < cornerOffsets.size() ? cornerOffsets[c + 1] : corners.size();
+
+            for (std::size_t k = cornerOffsets[c]; k < cornersEnd; ++k) {
+                Corner& corner = corners[k];
+                for (int i = 0; i < 3; ++i) {
+                    if (corner.relative & (1 << i)) corner.index[i] += int32_t(offsets[i][c]);
+                }
             }
+        }
+    });
 
-            if (elems.size() > 2 && !elems[2].empty()) {
-                f2.normIndices[0] = f.normIndices[2];
-                f2.normIndices[1] = std::stoi(elems[2]) - 1;
-                f2.normIndices[2] = f.normIndices[0];
+    // Weld vertices with equal (v, vt, vn). Position index is the hash, vertices sharing it are
+    // chained so lookup compares only a few candidates.
+    const uint32_t noVertex = ~0u;
+
+    std::vector<uint32_t> buckets(positions.size(), noVertex);
+    std::vector<uint32_t> chain;
+    std::vector<Corner> keys;
+    chain.reserve(positions.size());
+    keys.reserve(positions.size());
+
+    m_vertices.clear();
+    m_vertices.reserve(positions.size());
+    m_indices.clear();
+    m_indices.reserve(corners.size());
+
+    for (const Corner& corner : corners) {
+        for (int i = 0; i < 3; ++i) {
+            const int32_t index = corner.index[i];
+            if (index == noIndex && i > 0) continue;
+            if (index < 0 || std::size_t(index) >= counts[i]) {
+                throw std::out_of_range{"OBJ face index out of range: " +
+                                        std::to_string(index + 1)};
             }
+        }
+
+        uint32_t& bucket = buckets[corner.index[0]];
+
+        uint32_t vertex = bucket;
+        while (vertex != noVertex && !(keys[vertex] == corner))
+            vertex = chain[vertex];
+
+        if (vertex == noVertex) {
+            vertex = static_cast<uint32_t>(m_vertices.size());
+            keys.push_back(corner);
+            chain.push_back(bucket);
+            bucket = vertex;
 
-            m_faces.push_back(f2);
+            OpenGlVertex vert;
+            vert.p = positions[corner.index[0]];
+            if (corner.index[1] != noIndex) vert.t = texCoords[corner.index[1]];
+            if (corner.index[2] != noIndex) vert.n = normals[corner.index[2]];
+            m_vertices.push_back(vert);
         }
+
+        m_indices.push_back(vertex);
     }
+
+    m_hasNormals   = !normals.empty();
+    m_hasTexCoords = !texCoords.empty();
+
+    if (m_options.optimize && !m_indices.empty()) optimize();
 }
 
 //------------------------------------------------------------------------------
 
-void ObjLoader::fileLoaded()
-{
-    if (!m_faces.empty()) {
-        m_oglVertices.reserve(m_faces.size() / 3);
-        m_oglFaces.reserve(m_faces.size());
-
-        for (const Face& f : m_faces) {
-            OpenGlFace face;
-            for (int i = 0; i < 3; ++i) {
-                OpenGlVertex vert;
-                vert.p = m_positions[f.posIndices[i]];
-                vert.n =
-                    !m_normals.empty() ? m_normals[f.normIndices[i]] : glm::vec3{0.0f, 0.0f, 0.0f};
-                vert.t =
-                    !m_texCoords.empty() ? m_texCoords[f.texIndices[i]] : glm::vec2{0.0f, 0.0f};
-
-                const auto& it =
-                    std::find(std::cbegin(m_oglVertices), std::cend(m_oglVertices), vert);
-                if (it != std::cend(m_oglVertices)) {
-                    face.indices[i] = std::distance(cbegin(m_oglVertices), it);
-                } else {
-                    m_oglVertices.push_back(vert);
-                    face.indices[i] = m_oglVertices.size() - 1;
-                }
-            }
-            m_oglFaces.push_back(face);
-        }
+std::vector<glm::vec3> ObjLoader::positions() const
+{
+    std::vector<glm::vec3> positions_a;
+    positions_a.reserve(m_vertices.size());
+
+    for (const auto& v : m_vertices) {
+        positions_a.push_back(v.p);
+    }
+    return positions_a;
+}
+
+//------------------------------------------------------------------------------
+
+std::vector<glm::vec3> ObjLoader::normals() const
+{
+    std::vector<glm::vec3> normals_a;
+    if (!m_hasNormals) return normals_a;
+
+    normals_a.reserve(m_vertices.size());
 
-        m_faces.clear();
-        m_positions.clear();
-        m_normals.clear();
-        m_texCoords.clear();
+    for (const auto& v : m_vertices) {
+        normals_a.push_back(v.n);
     }
+    return normals_a;
+}
+
+//------------------------------------------------------------------------------
+
+std::vector<glm::vec2> ObjLoader::texCoords() const
+{
+    std::vector<glm::vec2> texcoords_a;
+    if (!m_hasTexCoords) return texcoords_a;
+
+    texcoords_a.reserve(m_vertices.size());
+
+    for (const auto& v : m_vertices) {
+        texcoords_a.push_back(v.t);
+    }
+    return texcoords_a;
+}
+
+//------------------------------------------------------------------------------
+
+void ObjLoader::optimize()
+{
+    const std::vector<glm::vec3> positions = this->positions();
+
+    const VertexCacheStats before = analyzeVertexCache(m_indices, m_vertices.size());
+
+    std::vector<uint32_t> clusters;
+    m_indices = optimizeVertexCache(m_indices, m_vertices.size(), 16, &clusters);
+    m_indices = optimizeOverdraw(m_indices, positions, clusters);
+
+    std::size_t vertexCount = 0;
+    const auto remap        = optimizeVertexFetch(m_indices, m_vertices.size(), &vertexCount);
+
+    std::vector<OpenGlVertex> vertices(vertexCount);
+    for (std::size_t i = 0; i < m_vertices.size(); ++i) {
+        if (remap[i] != ~0u) vertices[remap[i]] = m_vertices[i];
+    }
+    m_vertices = std::move(vertices);
+
+    const VertexCacheStats after = analyzeVertexCache(m_indices, m_vertices.size());
+    LOG_DEBUG("Mesh optimization: {} triangles, ACMR {:.3f} -> {:.3f}, ATVR {:.3f} -> {:.3f}",
+              m_indices.size() / 3, before.acmr, after.acmr, before.atvr, after.atvr);
 }
 
 //------------------------------------------------------------------------------
 
 std::shared_ptr<gfx::Model> ObjLoader::model() const
 {
+    using Attribute = PrimitiveData::Attribute;
+
     auto model = std::make_shared<gfx::Model>();
 
+    if (m_vertices.empty()) return model;
+
+    PrimitiveData data;
+    data.mode    = m_primitive;
+    data.indices = m_indices;
+
+    data.attributes[Attribute::Position] = AttributeData::fromVector(positions(), 3);
+    if (m_hasNormals) data.attributes[Attribute::Normal] = AttributeData::fromVector(normals(), 3);
+    if (m_hasTexCoords)
+        data.attributes[Attribute::TexCoord_0] = AttributeData::fromVector(texCoords(), 2);
+
+    data.attributes[Attribute::Tangent] = calculateTangents(data);
+
+    std::vector<gfx::Primitive> primitives;
+    primitives.push_back(data.upload());
+
+    auto mesh  = std::make_shared<gfx::Mesh>(std::move(primitives));
+    mesh->name = m_name;
+    model->m_meshes.push_back(mesh);
+
+    gfx::Node node;
+    node.setMesh(0);
+    node.name = m_name;
+    model->m_nodes.push_back(node);
+    for (auto& n : model->m_nodes)
+        n.setModel(model.get());
+
+    model->m_scenes = {{0}};
+    model->name     = m_name;
+
     return model;
 }
 
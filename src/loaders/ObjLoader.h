@@ -1,64 +1,66 @@
 #ifndef OBJLOADER_H
 #define OBJLOADER_H
 
-#include "Loader.h"
-
 #include "../gfx/Model.h"
 
 #include <GL/glew.h>
 #include <glm/glm.hpp>
 
+#include <cstdint>
+#include <filesystem>
+#include <string_view>
+
 namespace loaders {
 
-class ObjLoader final : public Loader
+/**
+ * @brief Wavefront OBJ loader.
+ *
+ * File is memory mapped and parsed in chunks on ThreadPool::global(). Polygons are
+ * triangulated as fans, vertices with equal (v, vt, vn) triples are welded.
+ */
+class ObjLoader final
 {
-    struct Face
-    {
-        unsigned short posIndices[3];
-        unsigned short normIndices[3];
-        unsigned short texIndices[3];
-    };
-
     struct OpenGlVertex
     {
         glm::vec3 p{};
         glm::vec3 n{};
         glm::vec2 t{};
-
-        bool operator==(const OpenGlVertex& other) const
-        {
-            return p == other.p && n == other.n && t == other.t;
-        }
     };
 
-    struct OpenGlFace
+  public:
+    struct Options
     {
-        unsigned indices[3];
+        bool parallel = true; //< Parse large files in chunks on thread pool
+        bool optimize = true; //< Reorder indices and vertices for GPU caches
     };
 
-  public:
+    ObjLoader() = default;
+    explicit ObjLoader(Options options);
+
+    void load(const std::filesystem::path& file);
+    void load(std::string_view source);
+
     std::shared_ptr<gfx::Model> model() const;
 
     std::vector<glm::vec3> positions() const;
     std::vector<glm::vec3> normals() const;
-    std::vector<unsigned short> indices() const;
+    std::vector<uint32_t> indices() const { return m_indices; }
     std::vector<glm::vec2> texCoords() const;
     int primitive() const { return m_primitive; }
 
-  protected:
-    void command(const std::string& cmd, const std::vector<std::string>& args) override;
-    void fileLoaded() override;
-
   private:
+    void optimize();
+
+    Options m_options;
+
     GLenum m_primitive = GL_TRIANGLES; //< triangles by deafult
+    bool m_hasNormals   = false;
+    bool m_hasTexCoords = false;
 
-    std::vector<glm::vec3> m_positions;
-    std::vector<Face> m_faces;
-    std::vector<glm::vec3> m_normals;
-    std::vector<glm::vec2> m_texCoords;
+    std::vector<OpenGlVertex> m_vertices;
+    std::vector<uint32_t> m_indices;
 
-    std::vector<OpenGlVertex> m_oglVertices;
-    std::vector<OpenGlFace> m_oglFaces;
+    std::string m_name;
 };
 
 } // namespace loaders
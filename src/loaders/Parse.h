@@ -0,0 +1,71 @@
+#ifndef LOADERS_PARSE_H
+#define LOADERS_PARSE_H
+
+#include <algorithm>
+#include <charconv>
+#include <cstdlib>
+#include <cstring>
+#include <string_view>
+#include <system_error>
+
+namespace loaders {
+
+/// Helpers for parsing text files without allocations. They do not skip leading whitespace.
+namespace parse {
+
+inline bool isSpace(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+inline const char* skipSpaces(const char* first, const char* last)
+{
+    while (first != last && isSpace(*first))
+        ++first;
+    return first;
+}
+
+inline const char* skipLine(const char* first, const char* last)
+{
+    const void* eol = std::memchr(first, '\n', last - first);
+    return eol ? static_cast<const char*>(eol) + 1 : last;
+}
+
+/// Returns pointer past the parsed number or nullptr on error
+template <typename T>
+const char* number(const char* first, const char* last, T& value)
+{
+    if (first != last && *first == '+') ++first;
+
+    const auto result = std::from_chars(first, last, value);
+    return result.ec == std::errc{} ? result.ptr : nullptr;
+}
+
+#if !defined(__cpp_lib_to_chars)
+// Standard library without floating point from_chars
+template <>
+inline const char* number<float>(const char* first, const char* last, float& value)
+{
+    char buffer[64];
+    const std::size_t len = std::min<std::size_t>(last - first, sizeof(buffer) - 1);
+    std::memcpy(buffer, first, len);
+    buffer[len] = '\0';
+
+    char* end = nullptr;
+    value     = std::strtof(buffer, &end);
+    return end == buffer ? nullptr : first + (end - buffer);
+}
+#endif
+
+inline const char* number(std::string_view str, float& value)
+{
+    return number(str.data(), str.data() + str.size(), value);
+}
+
+inline const char* number(std::string_view str, int& value)
+{
+    return number(str.data(), str.data() + str.size(), value);
+}
+
+} // namespace parse
+
+} // namespace loaders
+
+#endif // LOADERS_PARSE_H
@@ -0,0 +1,231 @@
+#include "PrimitiveData.h"
+
+#include <glm/gtc/packing.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace loaders {
+
+std::size_t AttributeData::componentSize() const
+{
+    switch (type) {
+    case GL_BYTE:
+    case GL_UNSIGNED_BYTE: return 1;
+    case GL_SHORT:
+    case GL_UNSIGNED_SHORT:
+    case GL_HALF_FLOAT: return 2;
+    default: return 4;
+    }
+}
+
+//------------------------------------------------------------------------------
+
+float AttributeData::getFloat(std::size_t element, unsigned component) const
+{
+    const uint8_t* ptr = data.data() + element * elementSize() + component * componentSize();
+
+    const auto read = [ptr](auto value) {
+        std::memcpy(&value, ptr, sizeof(value));
+        return value;
+    };
+
+    switch (type) {
+    case GL_BYTE: {
+        float v = read(int8_t{});
+        return normalized ? std::max(v / 127.0f, -1.0f) : v;
+    }
+    case GL_UNSIGNED_BYTE: {
+        float v = read(uint8_t{});
+        return normalized ? v / 255.0f : v;
+    }
+    case GL_SHORT: {
+        float v = read(int16_t{});
+        return normalized ? std::max(v / 32767.0f, -1.0f) : v;
+    }
+    case GL_UNSIGNED_SHORT: {
+        float v = read(uint16_t{});
+        return normalized ? v / 65535.0f : v;
+    }
+    case GL_HALF_FLOAT: return glm::unpackHalf1x16(read(uint16_t{}));
+    case GL_UNSIGNED_INT: return static_cast<float>(read(uint32_t{}));
+    case GL_INT: return static_cast<float>(read(int32_t{}));
+    default: return read(float{});
+    }
+}
+
+//==============================================================================
+
+template <typename Vec>
+static std::vector<Vec> toVectors(const AttributeData& attribute)
+{
+    const unsigned size = std::min<unsigned>(attribute.size, Vec::length());
+
+    std::vector<Vec> ans(attribute.count, Vec{0.0f});
+    for (std::size_t i = 0; i < ans.size(); ++i)
+        for (unsigned c = 0; c < size; ++c)
+            ans[i][c] = attribute.getFloat(i, c);
+
+    return ans;
+}
+
+std::vector<glm::vec3> PrimitiveData::positions() const
+{
+    auto ans = toVectors<glm::vec3>(attributes[Attribute::Position]);
+    if (dequantization != glm::mat4{1.0f}) {
+        for (auto& p : ans)
+            p = glm::vec3{dequantization * glm::vec4{p, 1.0f}};
+    }
+    return ans;
+}
+
+std::vector<glm::vec3> PrimitiveData::normals() const
+{
+    return toVectors<glm::vec3>(attributes[Attribute::Normal]);
+}
+
+std::vector<glm::vec2> PrimitiveData::texCoords() const
+{
+    return toVectors<glm::vec2>(attributes[Attribute::TexCoord_0]);
+}
+
+//------------------------------------------------------------------------------
+
+float PrimitiveData::uvDensity() const
+{
+    if (!isIndexedTriangles() || attributes[Attribute::TexCoord_0].empty()) return 0.0f;
+
+    const auto& p = positions();
+    const auto& t = texCoords();
+
+    double surfaceArea = 0.0;
+    double uvArea      = 0.0;
+    for (std::size_t i = 0; i + 2 < indices.size(); i += 3) {
+        const uint32_t a = indices[i], b = indices[i + 1], c = indices[i + 2];
+
+        surfaceArea += glm::length(glm::cross(p[b] - p[a], p[c] - p[a]));
+
+        const glm::vec2 e1 = t[b] - t[a];
+        const glm::vec2 e2 = t[c] - t[a];
+        uvArea += std::abs(e1.x * e2.y - e1.y * e2.x);
+    }
+
+    if (surfaceArea <= 0.0 || uvArea <= 0.0) return 0.0f;
+    return static_cast<float>(std::sqrt(uvArea / surfaceArea));
+}
+
+//------------------------------------------------------------------------------
+
+static void remapAttribute(AttributeData& attribute, const std::vector<uint32_t>& remap,
+                           std::size_t newVertexCount)
+{
+    if (attribute.empty()) return;
+
+    const std::size_t elementSize = attribute.elementSize();
+    std::vector<uint8_t> remapped(newVertexCount * elementSize);
+
+    for (std::size_t i = 0; i < attribute.count && i < remap.size(); ++i) {
+        if (remap[i] == ~0u) continue;
+        std::memcpy(&remapped[remap[i] * elementSize], &attribute.data[i * elementSize],
+                    elementSize);
+    }
+
+    attribute.data  = std::move(remapped);
+    attribute.count = static_cast<unsigned>(newVertexCount);
+}
+
+void PrimitiveData::remapVertices(const std::vector<uint32_t>& remap, std::size_t newVertexCount)
+{
+    for (auto& attribute : attributes)
+        remapAttribute(attribute, remap, newVertexCount);
+
+    for (auto& target : targets)
+        for (auto& attribute : target)
+            remapAttribute(attribute, remap, newVertexCount);
+}
+
+//------------------------------------------------------------------------------
+
+gfx::Primitive PrimitiveData::upload() const
+{
+    gfx::Primitive::Attributes accessors{};
+    for (std::size_t i = 0; i < attributes.size(); ++i) {
+        accessors[i] = uploadAttribute(attributes[i], i == Attribute::Position);
+    }
+
+    std::vector<gfx::Primitive::MorphTarget> morphTargets;
+    for (const auto& target : targets) {
+        gfx::Primitive::MorphTarget morphTarget{};
+        for (std::size_t i = 0; i < target.size(); ++i) {
+            morphTarget[i] = uploadAttribute(target[i]);
+        }
+        morphTargets.push_back(morphTarget);
+    }
+
+    gfx::Primitive primitive{accessors, uploadIndices(indices, vertexCount()), mode, morphTargets};
+    primitive.setDequantization(dequantization);
+    primitive.setMeshlets(meshlets);
+    primitive.setUvDensity(uvDensity());
+    return primitive;
+}
+
+//------------------------------------------------------------------------------
+
+gfx::Accessor uploadAttribute(const AttributeData& attribute, bool calculateMinMax)
+{
+    gfx::Accessor accessor;
+
+    if (attribute.empty()) return accessor;
+
+    accessor.buffer = std::make_shared<gfx::Buffer>();
+    accessor.buffer->loadData(attribute.data.data(), attribute.data.size());
+    accessor.count      = attribute.count;
+    accessor.size       = attribute.size;
+    accessor.type       = attribute.type;
+    accessor.normalized = attribute.normalized;
+
+    if (calculateMinMax) {
+        for (unsigned c = 0; c < attribute.size; ++c) {
+            accessor.min[c] = std::numeric_limits<float>::max();
+            accessor.max[c] = std::numeric_limits<float>::lowest();
+        }
+
+        for (std::size_t i = 0; i < attribute.count; ++i) {
+            for (unsigned c = 0; c < attribute.size; ++c) {
+                const float v   = attribute.getFloat(i, c);
+                accessor.min[c] = std::min(accessor.min[c], v);
+                accessor.max[c] = std::max(accessor.max[c], v);
+            }
+        }
+    }
+
+    return accessor;
+}
+
+//------------------------------------------------------------------------------
+
+gfx::Accessor uploadIndices(const std::vector<uint32_t>& indices, std::size_t vertexCount)
+{
+    gfx::Accessor accessor;
+
+    if (indices.empty()) return accessor;
+
+    accessor.buffer = std::make_shared<gfx::Buffer>();
+    accessor.count  = static_cast<unsigned>(indices.size());
+    accessor.size   = 1;
+
+    if (vertexCount <= std::numeric_limits<uint16_t>::max()) {
+        std::vector<uint16_t> shortIndices{std::cbegin(indices), std::cend(indices)};
+        accessor.buffer->loadData(shortIndices.data(), shortIndices.size() * sizeof(uint16_t));
+        accessor.type = GL_UNSIGNED_SHORT;
+    } else {
+        accessor.buffer->loadData(indices.data(), indices.size() * sizeof(uint32_t));
+        accessor.type = GL_UNSIGNED_INT;
+    }
+
+    return accessor;
+}
+
+} // namespace loaders
@@ -0,0 +1,108 @@
+#ifndef LOADERS_PRIMITIVEDATA_H
+#define LOADERS_PRIMITIVEDATA_H
+
+#include "../gfx/Mesh.h"
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace loaders {
+
+/**
+ * @brief CPU side copy of one vertex attribute.
+ *
+ * Elements are tightly packed, so element i starts at i * elementSize().
+ */
+struct AttributeData final
+{
+    std::vector<uint8_t> data;
+    unsigned count  = 0;        //< Number of elements (not bytes!)
+    unsigned size   = 4;        //< Number of components per element
+    GLenum type     = GL_FLOAT; //< Component type
+    bool normalized = false;
+
+    bool empty() const { return count == 0; }
+    std::size_t componentSize() const;
+    std::size_t elementSize() const { return componentSize() * size; }
+
+    /// Returns component converted to float. Normalized integers are mapped to [0,1] or [-1,1].
+    float getFloat(std::size_t element, unsigned component) const;
+
+    template <typename T>
+    const T* as() const
+    {
+        return reinterpret_cast<const T*>(data.data());
+    }
+
+    template <typename T>
+    T* as()
+    {
+        return reinterpret_cast<T*>(data.data());
+    }
+
+    /// Copies count elements of T (one T is one element).
+    template <typename T>
+    static AttributeData fromVector(const std::vector<T>& elements, unsigned size,
+                                    GLenum type = GL_FLOAT)
+    {
+        AttributeData ans;
+        ans.count = static_cast<unsigned>(elements.size());
+        ans.size  = size;
+        ans.type  = type;
+        ans.data.resize(elements.size() * sizeof(T));
+        std::copy_n(reinterpret_cast<const uint8_t*>(elements.data()), ans.data.size(),
+                    ans.data.data());
+        return ans;
+    }
+};
+
+//------------------------------------------------------------------------------
+
+/**
+ * @brief CPU side copy of gfx::Primitive.
+ *
+ * Loaders fill it, import time passes (optimization etc.) modify it and upload() moves it to GPU.
+ */
+struct PrimitiveData final
+{
+    using Attribute   = gfx::Accessor::Attribute;
+    using Attributes  = std::array<AttributeData, Attribute::Size>;
+    using MorphTarget = std::array<AttributeData, 3>; // positions, normals, tangents
+
+    Attributes attributes;
+    std::vector<uint32_t> indices;
+    GLenum mode = GL_TRIANGLES;
+    std::vector<MorphTarget> targets;
+    glm::mat4 dequantization{1.0f}; //< Maps stored positions to model space, see quantizeMesh
+    std::vector<gfx::Meshlet> meshlets;
+
+    std::size_t vertexCount() const { return attributes[Attribute::Position].count; }
+    bool isIndexedTriangles() const { return mode == GL_TRIANGLES && !indices.empty(); }
+
+    /// Model space positions (dequantized)
+    std::vector<glm::vec3> positions() const;
+    std::vector<glm::vec3> normals() const;
+    std::vector<glm::vec2> texCoords() const;
+
+    /// Texture coordinate units per model space unit, sqrt of UV area to surface area ratio.
+    /// 0 for primitives without texture coordinates or triangles.
+    float uvDensity() const;
+
+    /// Reorders vertices of every attribute and morph target. remap[oldIndex] = newIndex, unused
+    /// vertices are marked with ~0u and dropped. Indices are not touched.
+    void remapVertices(const std::vector<uint32_t>& remap, std::size_t newVertexCount);
+
+    /// Creates GPU buffers for attributes and indices
+    gfx::Primitive upload() const;
+};
+
+gfx::Accessor uploadAttribute(const AttributeData& attribute, bool calculateMinMax = false);
+gfx::Accessor uploadIndices(const std::vector<uint32_t>& indices, std::size_t vertexCount);
+
+} // namespace loaders
+
+#endif // LOADERS_PRIMITIVEDATA_H
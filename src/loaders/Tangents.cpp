@@ -0,0 +1,145 @@
+#include "Tangents.h"
+
+#include "../ThreadPool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric> // partial_sum
+
+namespace loaders {
+
+namespace {
+
+const std::size_t grainSize = 4096;
+
+float cornerAngle(const glm::vec3& p, const glm::vec3& a, const glm::vec3& b)
+{
+    const glm::vec3 e0 = a - p;
+    const glm::vec3 e1 = b - p;
+
+    const float len = glm::length(e0) * glm::length(e1);
+    if (len <= 0.0f) return 0.0f;
+
+    return std::acos(std::min(std::max(glm::dot(e0, e1) / len, -1.0f), 1.0f));
+}
+
+glm::vec3 projectOnPlane(const glm::vec3& v, const glm::vec3& n)
+{
+    const glm::vec3 p = v - n * glm::dot(n, v);
+    const float len   = glm::length(p);
+    return len > 1e-20f ? p / len : glm::vec3{0.0f};
+}
+
+// Any unit vector perpendicular to n
+glm::vec3 perpendicular(const glm::vec3& n)
+{
+    const glm::vec3 axis = std::abs(n.x) < 0.9f ? glm::vec3{1.0f, 0.0f, 0.0f}
+                                                : glm::vec3{0.0f, 1.0f, 0.0f};
+    const glm::vec3 p    = glm::cross(n, axis);
+    const float len      = glm::length(p);
+    return len > 0.0f ? p / len : glm::vec3{1.0f, 0.0f, 0.0f};
+}
+
+} // namespace
+
+//------------------------------------------------------------------------------
+
+AttributeData calculateTangents(const PrimitiveData& primitive)
+{
+    using Attribute = PrimitiveData::Attribute;
+
+    const auto& attributes = primitive.attributes;
+    if (!primitive.isIndexedTriangles() || attributes[Attribute::Normal].empty() ||
+        attributes[Attribute::TexCoord_0].empty())
+        return {};
+
+    const auto positions = primitive.positions();
+    const auto normals   = primitive.normals();
+    const auto texCoords = primitive.texCoords();
+    const auto& indices  = primitive.indices;
+
+    const std::size_t vertexCount   = positions.size();
+    const std::size_t triangleCount = indices.size() / 3;
+
+    if (normals.size() != vertexCount || texCoords.size() != vertexCount) return {};
+
+    if (std::any_of(std::cbegin(indices), std::cend(indices),
+                    [vertexCount](uint32_t i) { return i >= vertexCount; }))
+        return {};
+
+    // Weighted tangent and bitangent contributed by every triangle corner
+    std::vector<glm::vec3> cornerTangents(triangleCount * 3);
+    std::vector<glm::vec3> cornerBitangents(triangleCount * 3);
+
+    ThreadPool& pool = ThreadPool::global();
+
+    pool.parallelFor(triangleCount, grainSize, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t t = begin; t < end; ++t) {
+            const uint32_t* tri = &indices[t * 3];
+
+            const glm::vec3 dPos1 = positions[tri[1]] - positions[tri[0]];
+            const glm::vec3 dPos2 = positions[tri[2]] - positions[tri[0]];
+            const glm::vec2 dST1  = texCoords[tri[1]] - texCoords[tri[0]];
+            const glm::vec2 dST2  = texCoords[tri[2]] - texCoords[tri[0]];
+
+            const float det = dST1.x * dST2.y - dST1.y * dST2.x;
+
+            // Degenerate texture mapping contributes nothing
+            if (std::abs(det) < 1e-20f) continue;
+
+            const float r             = 1.0f / det;
+            const glm::vec3 tangent   = (dPos1 * dST2.y - dPos2 * dST1.y) * r;
+            const glm::vec3 bitangent = (dPos2 * dST1.x - dPos1 * dST2.x) * r;
+
+            for (int j = 0; j < 3; ++j) {
+                const uint32_t v = tri[j];
+                const float w    = cornerAngle(positions[v], positions[tri[(j + 1) % 3]],
+                                            positions[tri[(j + 2) % 3]]);
+
+                cornerTangents[t * 3 + j]   = projectOnPlane(tangent, normals[v]) * w;
+                cornerBitangents[t * 3 + j] = projectOnPlane(bitangent, normals[v]) * w;
+            }
+        }
+    });
+
+    // Vertex -> corners adjacency, so vertices can be processed in parallel without races
+    std::vector<uint32_t> offsets(vertexCount + 1, 0);
+    for (auto index : indices)
+        ++offsets[index + 1];
+    std::partial_sum(std::begin(offsets), std::end(offsets), std::begin(offsets));
+
+    std::vector<uint32_t> corners(indices.size());
+    {
+        std::vector<uint32_t> cursor{std::cbegin(offsets), std::cend(offsets) - 1};
+        for (std::size_t i = 0; i < indices.size(); ++i)
+            corners[cursor[indices[i]]++] = static_cast<uint32_t>(i);
+    }
+
+    std::vector<glm::vec4> tangents(vertexCount);
+
+    pool.parallelFor(vertexCount, grainSize, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t v = begin; v < end; ++v) {
+            glm::vec3 t{0.0f};
+            glm::vec3 b{0.0f};
+            for (uint32_t i = offsets[v]; i < offsets[v + 1]; ++i) {
+                t += cornerTangents[corners[i]];
+                b += cornerBitangents[corners[i]];
+            }
+
+            const glm::vec3& n = normals[v];
+
+            // Gram-Schmidt orthogonalize
+            glm::vec3 tangent = projectOnPlane(t, n);
+            if (tangent == glm::vec3{0.0f}) tangent = perpendicular(n);
+
+            // Calculate handedness
+            const float w = glm::dot(glm::cross(n, tangent), b) < 0.0f ? -1.0f : 1.0f;
+
+            tangents[v] = glm::vec4{tangent, w};
+        }
+    });
+
+    return AttributeData::fromVector(tangents, 4);
+}
+
+} // namespace loaders
@@ -0,0 +1,23 @@
+#ifndef LOADERS_TANGENTS_H
+#define LOADERS_TANGENTS_H
+
+#include "PrimitiveData.h"
+
+namespace loaders {
+
+/**
+ * @brief Calculates per vertex tangents (vec4, w is bitangent sign) in MikkTSpace convention.
+ *
+ * Face tangents are projected onto tangent plane of every corner's normal and accumulated with
+ * corner angle weights, then orthogonalized against the normal. Bitangent is
+ * cross(normal, tangent.xyz) * tangent.w as required by glTF. Work is split across
+ * ThreadPool::global() for large meshes.
+ *
+ * Returns empty attribute if primitive is not indexed triangle list or lacks positions,
+ * normals or texture coordinates.
+ */
+AttributeData calculateTangents(const PrimitiveData& primitive);
+
+} // namespace loaders
+
+#endif // LOADERS_TANGENTS_H
@@ -0,0 +1,34 @@
+#include "TriangleMesh.h"
+
+#include "GltfLoader.h"
+#include "ObjLoader.h"
+
+#include <stdexcept>
+
+namespace loaders {
+
+TriangleMesh loadTriangleMesh(const std::filesystem::path& file)
+{
+    const auto extension = file.extension();
+
+    if (extension == ".gltf") return loadGltfTriangles(file);
+
+    if (extension == ".obj") {
+        ObjLoader::Options options;
+        options.optimize = false;
+
+        ObjLoader loader{options};
+        loader.load(file);
+        if (loader.primitive() != GL_TRIANGLES)
+            throw std::runtime_error{"Not a triangle mesh: " + file.string()};
+
+        TriangleMesh mesh;
+        mesh.positions = loader.positions();
+        mesh.indices   = loader.indices();
+        return mesh;
+    }
+
+    throw std::runtime_error{"Unsupported mesh file: " + file.string()};
+}
+
+} // namespace loaders
@@ -0,0 +1,30 @@
+#ifndef LOADERS_TRIANGLEMESH_H
+#define LOADERS_TRIANGLEMESH_H
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+namespace loaders {
+
+/// Triangle list sharing one vertex array, positions in model space
+struct TriangleMesh final
+{
+    std::vector<glm::vec3> positions;
+    std::vector<uint32_t> indices;
+
+    std::size_t triangleCount() const { return indices.size() / 3; }
+};
+
+/**
+ * @brief Reads triangles of glTF or OBJ file on CPU, no GL objects are created.
+ *
+ * Used by collision shapes. Throws std::runtime_error for other file types.
+ */
+TriangleMesh loadTriangleMesh(const std::filesystem::path& file);
+
+} // namespace loaders
+
+#endif // LOADERS_TRIANGLEMESH_H
@@ -3,6 +3,7 @@
 #include "GameLogic.h"
 #include "Logger.h"
 #include "Settings.h"
+#include "Vfs.h"
 #include "config.h"
 
 #include <CLI/CLI.hpp>
@@ -54,6 +55,29 @@ void setupCli(CLI::App& app, Settings& s)
     app.add_option("--shadersFolder", s.shadersFolder, "Path to shaders code")
         ->check(CLI::ExistingDirectory)
         ->required();
+    app.add_option("--cacheFolder", s.cacheFolder, "Path to cooked assets cache");
+    app.add_option("--packFile", s.packFile, "Archive with data folder contents")
+        ->check(CLI::ExistingFile);
+    app.add_flag("--textureStreaming", s.textureStreaming, "Load texture mips on demand");
+    app.add_flag("--quantizeMeshes", s.quantizeMeshes, "Compact vertex formats for glTF meshes");
+    app.add_option("--gpuMemoryBudget", s.gpuMemoryBudget, "Texture and buffer memory limit in MB",
+                   true);
+    app.add_option("--physicsTickRate", s.physicsTickRate, "Physics steps per second", true)
+        ->check(CLI::Range(10.0f, 1000.0f));
+    app.add_option("--physicsMaxSubSteps", s.physicsMaxSubSteps, "Physics steps per frame", true)
+        ->check(CLI::Range(1, 32));
+    app.add_option("--physicsThreads", s.physicsThreads, "Physics worker threads, 0 disables",
+                   true)
+        ->check(CLI::Range(0, 64));
+    app.add_option("--physicsActiveRadius", s.physicsActiveRadius,
+                   "Full rate physics distance from cameras and players, 0 disables regions", true)
+        ->check(CLI::Range(0.0f, 100000.0f));
+    app.add_option("--physicsReducedRadius", s.physicsReducedRadius,
+                   "Reduced rate physics distance, not above active radius disables it", true)
+        ->check(CLI::Range(0.0f, 100000.0f));
+    app.add_option("--physicsReducedRate", s.physicsReducedRate, "Ticks per reduced rate step",
+                   true)
+        ->check(CLI::Range(2, 60));
     app.add_set("--logLevel", s.logLevel, {"trace", "debug", "info", "warning", "error", "fatal"});
 }
 
@@ -69,6 +93,8 @@ int main(int ac, char** av)
     initLogger(settings.logLevel);
 
     try {
+        if (!settings.packFile.empty()) Vfs::global().mount(settings.packFile, settings.dataFolder);
+
         Engine engine;
         auto resourcesMgr =
             std::make_shared<ResourcesMgr>(settings.dataFolder, settings.shadersFolder);
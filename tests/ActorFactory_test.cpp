@@ -0,0 +1,78 @@
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE ActorFactoryTest
+#include <boost/test/unit_test.hpp>
+
+#include "ConsoleLogger.h"
+
+#include <ActorFactory.h>
+
+#include <nlohmann/json.hpp>
+
+BOOST_GLOBAL_FIXTURE(ConsoleLogger);
+
+using nlohmann::json;
+using Ph = PhysicsComponent;
+
+static std::shared_ptr<PhysicsComponent> physicsOf(ActorFactory& factory, const json& node)
+{
+    auto actor = factory.create(node);
+    auto ph    = actor->getComponent<PhysicsComponent>(ComponentId::Physics).lock();
+    BOOST_REQUIRE(ph);
+    return ph;
+}
+
+BOOST_AUTO_TEST_CASE(Layers_test)
+{
+    ActorFactory factory;
+    const auto ph = physicsOf(factory, json::parse(R"({
+        "physics": {"shape": "box:1:1:1", "mass": 1, "layer": "debris",
+                    "mask": " static \t character  "}
+    })"));
+
+    BOOST_CHECK_EQUAL(ph->layer, Ph::Debris);
+    BOOST_CHECK_EQUAL(ph->mask, Ph::Static | Ph::Character);
+}
+
+BOOST_AUTO_TEST_CASE(DefaultLayers_test)
+{
+    ActorFactory factory;
+
+    // Layer and mask are picked by PhysicsSystem from mass
+    auto ph = physicsOf(factory, json::parse(R"({"physics": {"shape": "box:1:1:1"}})"));
+    BOOST_CHECK_EQUAL(ph->layer, 0);
+    BOOST_CHECK_EQUAL(ph->mask, 0);
+
+    ph = physicsOf(factory, json::parse(R"({"physics": {"layer": "", "mask": "all"}})"));
+    BOOST_CHECK_EQUAL(ph->layer, 0);
+    BOOST_CHECK_EQUAL(ph->mask, Ph::AllLayers);
+}
+
+BOOST_AUTO_TEST_CASE(Prototype_test)
+{
+    ActorFactory factory;
+    factory.registerPrototype(json::parse(R"({
+        "name": "sensor",
+        "physics": {"shape": "box:2:2:2", "layer": "trigger", "mask": "character"}
+    })"));
+
+    auto ph = physicsOf(factory, json::parse(R"({
+        "prototype": "sensor", "physics": {}
+    })"));
+    BOOST_CHECK_EQUAL(ph->layer, Ph::Trigger);
+    BOOST_CHECK_EQUAL(ph->mask, Ph::Character);
+
+    ph = physicsOf(factory, json::parse(R"({
+        "prototype": "sensor", "physics": {"mask": "character projectile"}
+    })"));
+    BOOST_CHECK_EQUAL(ph->layer, Ph::Trigger);
+    BOOST_CHECK_EQUAL(ph->mask, Ph::Character | Ph::Projectile);
+}
+
+BOOST_AUTO_TEST_CASE(UnknownLayer_test)
+{
+    ActorFactory factory;
+    BOOST_CHECK_THROW(factory.create(json::parse(R"({"physics": {"layer": "ghost"}})")),
+                      std::runtime_error);
+    BOOST_CHECK_THROW(factory.create(json::parse(R"({"physics": {"mask": "static Debris"}})")),
+                      std::runtime_error);
+}
@@ -0,0 +1,13 @@
+#ifndef TESTS_CONSOLELOGGER_H
+#define TESTS_CONSOLELOGGER_H
+
+#include <spdlog/sinks/stdout_color_sinks.h>
+#include <spdlog/spdlog.h>
+
+/// Engine code logs to "console" logger, use with BOOST_GLOBAL_FIXTURE
+struct ConsoleLogger
+{
+    ConsoleLogger() { spdlog::stdout_color_mt("console")->set_level(spdlog::level::warn); }
+};
+
+#endif // TESTS_CONSOLELOGGER_H
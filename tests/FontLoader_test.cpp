@@ -0,0 +1,163 @@
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE FontLoaderTest
+#include <boost/test/unit_test.hpp>
+
+#include "ConsoleLogger.h"
+
+#include <FontLoader.h>
+
+#include <type_traits>
+
+BOOST_GLOBAL_FIXTURE(ConsoleLogger);
+
+/// Builds binary BMFont file
+class BinaryFont
+{
+  public:
+    template <typename T>
+    static void put(std::string& out, T value)
+    {
+        const auto bits = static_cast<std::make_unsigned_t<T>>(value);
+        for (std::size_t i = 0; i < sizeof(T); ++i)
+            out += char((bits >> (8 * i)) & 0xff);
+    }
+
+    static std::string info(int16_t fontSize, const std::string& face)
+    {
+        std::string body;
+        put(body, fontSize);
+        body.append(12, '\0'); // bitField to outline
+        return body + face + '\0';
+    }
+
+    static std::string common(uint16_t lineHeight, uint16_t scaleW, uint16_t scaleH)
+    {
+        std::string body;
+        for (uint16_t value : {lineHeight, uint16_t(0), scaleW, scaleH, uint16_t(1)})
+            put(body, value);
+        body.append(5, '\0'); // bitField and channels
+        return body;
+    }
+
+    static std::string glyph(uint32_t id, int16_t xadvance)
+    {
+        std::string body;
+        put(body, id);
+        body.append(12, '\0'); // x to yoffset
+        put(body, xadvance);
+        body.append(2, '\0'); // page and chnl
+        return body;
+    }
+
+    static std::string kerning(uint32_t first, uint32_t second, int16_t amount)
+    {
+        std::string body;
+        put(body, first);
+        put(body, second);
+        put(body, amount);
+        return body;
+    }
+
+    void block(uint8_t type, const std::string& body)
+    {
+        m_data += char(type);
+        put(m_data, uint32_t(body.size()));
+        m_data += body;
+    }
+
+    const std::string& data() const { return m_data; }
+
+  private:
+    std::string m_data{"BMF\3"};
+};
+
+//------------------------------------------------------------------------------
+
+BOOST_AUTO_TEST_CASE(Text_test)
+{
+    const std::string source = R"==(
+info face="Times New Roman" size=32 bold=0 italic=0 charset="" unicode=1
+common lineHeight=36 base=29 scaleW=256 scaleH=128 pages=1 packed=0
+page id=0 file="times.png"
+chars count=2
+char id=65 x=1 y=2 width=20 height=22 xoffset=-1 yoffset=7 xadvance=19 page=0 chnl=15
+char id=8364 x=30 y=2 width=18 height=22 xoffset=0 yoffset=7 xadvance=17 page=0 chnl=15
+kernings count=1
+kerning first=65 second=86 amount=-2
+)==";
+
+    FontLoader ldr;
+    ldr.loadFromMemory(source);
+    const gfx::Font font = ldr.getFont();
+
+    BOOST_CHECK_EQUAL(font.getLineHeight(), 36u);
+    BOOST_CHECK_EQUAL(font.getScaleW(), 256u);
+    BOOST_CHECK_EQUAL(font.getScaleH(), 128u);
+    BOOST_CHECK(font.getTexturesFilenames() == std::vector<std::string>{"times.png"});
+
+    BOOST_CHECK_EQUAL(font.charsCount(), 2u);
+    BOOST_CHECK_EQUAL(font.getChar('A').width, 20);
+    BOOST_CHECK_EQUAL(font.getChar('A').xoffset, -1);
+    BOOST_CHECK_EQUAL(font.getChar(uint32_t(8364)).xadvance, 17);
+    BOOST_CHECK_EQUAL(font.getChar('B').xadvance, 0);
+
+    BOOST_CHECK_EQUAL(font.kerningsCount(), 1u);
+    BOOST_CHECK_EQUAL(font.getKerning('A', 'V'), -2);
+    BOOST_CHECK_EQUAL(font.getKerning('V', 'A'), 0);
+}
+
+BOOST_AUTO_TEST_CASE(Binary_test)
+{
+    BinaryFont bmf;
+    bmf.block(1, BinaryFont::info(-32, "Arial"));
+    bmf.block(2, BinaryFont::common(36, 512, 256));
+    bmf.block(3, std::string{"arial_0.png\0arial_1.png\0", 24});
+    bmf.block(4, BinaryFont::glyph('A', 19) + BinaryFont::glyph(0x1F600, 40));
+    bmf.block(5, BinaryFont::kerning('A', 'V', -3));
+
+    FontLoader ldr;
+    ldr.loadFromMemory(bmf.data());
+    const gfx::Font font = ldr.getFont();
+
+    BOOST_CHECK_EQUAL(font.getLineHeight(), 36u);
+    BOOST_CHECK_EQUAL(font.getScaleW(), 512u);
+    BOOST_CHECK((font.getTexturesFilenames() ==
+                 std::vector<std::string>{"arial_0.png", "arial_1.png"}));
+
+    BOOST_CHECK_EQUAL(font.charsCount(), 2u);
+    BOOST_CHECK_EQUAL(font.getChar('A').xadvance, 19);
+    BOOST_CHECK_EQUAL(font.getChar(uint32_t(0x1F600)).xadvance, 40);
+    BOOST_CHECK_EQUAL(font.getKerning('A', 'V'), -3);
+}
+
+BOOST_AUTO_TEST_CASE(RepeatedGlyph_test)
+{
+    BinaryFont bmf;
+    bmf.block(4, BinaryFont::glyph('A', 10) + BinaryFont::glyph('A', 12) +
+                     BinaryFont::glyph(0x10000, 5) + BinaryFont::glyph(0x10000, 6));
+
+    FontLoader ldr;
+    ldr.loadFromMemory(bmf.data());
+    const gfx::Font font = ldr.getFont();
+
+    // The last entry wins, each id is counted once
+    BOOST_CHECK_EQUAL(font.charsCount(), 2u);
+    BOOST_CHECK_EQUAL(font.getChar('A').xadvance, 12);
+    BOOST_CHECK_EQUAL(font.getChar(uint32_t(0x10000)).xadvance, 6);
+}
+
+BOOST_AUTO_TEST_CASE(BinaryErrors_test)
+{
+    FontLoader ldr;
+
+    BOOST_CHECK_THROW(ldr.loadFromMemory(std::string{"BMF\2"}), std::runtime_error);
+
+    BinaryFont truncated;
+    truncated.block(4, BinaryFont::glyph('A', 10));
+    const std::string data = truncated.data();
+    BOOST_CHECK_THROW(ldr.loadFromMemory(data.substr(0, data.size() - 1)), std::runtime_error);
+
+    BinaryFont shortInfo;
+    shortInfo.block(1, std::string(4, '\0'));
+    BOOST_CHECK_THROW(ldr.loadFromMemory(shortInfo.data()), std::runtime_error);
+}
@@ -0,0 +1,85 @@
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE HandleTest
+#include <boost/test/unit_test.hpp>
+
+#include <Handle.h>
+
+#include <string>
+
+BOOST_AUTO_TEST_CASE(Null_test)
+{
+    HandlePool<std::string> pool;
+    Handle<std::string> handle;
+
+    BOOST_CHECK(handle.isNull());
+    BOOST_CHECK(!handle);
+    BOOST_CHECK(pool.get(handle) == nullptr);
+    BOOST_CHECK(!pool.getShared(handle));
+}
+
+BOOST_AUTO_TEST_CASE(AddGet_test)
+{
+    HandlePool<std::string> pool;
+    auto a = pool.add(std::make_shared<std::string>("a"));
+    auto b = pool.add(std::make_shared<std::string>("b"));
+
+    BOOST_CHECK(a && b);
+    BOOST_CHECK(a != b);
+    BOOST_CHECK_EQUAL(*pool.get(a), "a");
+    BOOST_CHECK_EQUAL(*pool.getShared(b), "b");
+    BOOST_CHECK_EQUAL(pool.size(), 2u);
+}
+
+BOOST_AUTO_TEST_CASE(StaleHandle_test)
+{
+    HandlePool<std::string> pool;
+    auto a = pool.add(std::make_shared<std::string>("a"));
+    pool.remove(a);
+
+    BOOST_CHECK(pool.get(a) == nullptr);
+    BOOST_CHECK_EQUAL(pool.size(), 0u);
+
+    // Slot is reused with new generation, old handle does not see the new object
+    auto b = pool.add(std::make_shared<std::string>("b"));
+    BOOST_CHECK_EQUAL(b.index(), a.index());
+    BOOST_CHECK(b.generation() != a.generation());
+    BOOST_CHECK(pool.get(a) == nullptr);
+    BOOST_CHECK_EQUAL(*pool.get(b), "b");
+
+    // Removing through stale handle does nothing
+    pool.remove(a);
+    BOOST_CHECK_EQUAL(*pool.get(b), "b");
+}
+
+BOOST_AUTO_TEST_CASE(Replace_test)
+{
+    HandlePool<std::string> pool;
+    auto a = pool.add(std::make_shared<std::string>("a"));
+
+    BOOST_CHECK(pool.replace(a, std::make_shared<std::string>("a2")));
+    BOOST_CHECK_EQUAL(*pool.get(a), "a2");
+    BOOST_CHECK_EQUAL(pool.size(), 1u);
+
+    pool.remove(a);
+    BOOST_CHECK(!pool.replace(a, std::make_shared<std::string>("a3")));
+    BOOST_CHECK(!pool.replace(Handle<std::string>{}, std::make_shared<std::string>("a4")));
+    BOOST_CHECK_EQUAL(pool.size(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(ForEach_test)
+{
+    HandlePool<std::string> pool;
+    auto a = pool.add(std::make_shared<std::string>("a"));
+    auto b = pool.add(std::make_shared<std::string>("b"));
+    pool.add(std::make_shared<std::string>("c"));
+    pool.remove(b);
+
+    std::string visited;
+    pool.forEach([&](Handle<std::string> handle, const std::shared_ptr<std::string>& object) {
+        BOOST_CHECK(pool.get(handle) == object.get());
+        visited += *object;
+    });
+
+    BOOST_CHECK_EQUAL(visited, "ac");
+    BOOST_CHECK_EQUAL(*pool.get(a), "a");
+}
@@ -0,0 +1,115 @@
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE MeshQuantizerTest
+#include <boost/test/unit_test.hpp>
+
+#include <MeshQuantizer.h>
+#include <PrimitiveData.h>
+
+using loaders::AttributeData;
+using loaders::PrimitiveData;
+using Attribute = PrimitiveData::Attribute;
+
+static PrimitiveData makePrimitive(const std::vector<glm::vec3>& positions)
+{
+    PrimitiveData primitive;
+    primitive.attributes[Attribute::Position] = AttributeData::fromVector(positions, 3);
+    return primitive;
+}
+
+BOOST_AUTO_TEST_CASE(Positions_test)
+{
+    const std::vector<glm::vec3> a = {{-1.0f, 2.0f, 3.0f}, {4.0f, -5.0f, 0.5f}};
+    const std::vector<glm::vec3> b = {{0.0f, 0.0f, 0.0f}, {1.25f, 1.5f, 6.0f}};
+
+    std::vector<PrimitiveData> primitives{makePrimitive(a), makePrimitive(b)};
+    const auto report = loaders::quantizeMesh(primitives);
+
+    BOOST_CHECK_EQUAL(report.bytesBefore, 4 * sizeof(glm::vec3));
+    BOOST_CHECK_EQUAL(report.bytesAfter, 4 * 4 * sizeof(uint16_t));
+
+    // Mesh bounding cube edge is 7, one step is 7 / 65535
+    const float tolerance = 7.0f / 65535.0f;
+    const std::vector<glm::vec3>* sources[] = {&a, &b};
+    for (std::size_t p = 0; p < primitives.size(); ++p) {
+        const auto& position = primitives[p].attributes[Attribute::Position];
+        BOOST_CHECK_EQUAL(position.type, GLenum(GL_UNSIGNED_SHORT));
+        BOOST_CHECK(position.normalized);
+        BOOST_CHECK(primitives[p].dequantization == primitives[0].dequantization);
+
+        const auto positions = primitives[p].positions();
+        BOOST_REQUIRE_EQUAL(positions.size(), sources[p]->size());
+        for (std::size_t i = 0; i < positions.size(); ++i)
+            BOOST_CHECK_SMALL(glm::length(positions[i] - (*sources[p])[i]), tolerance);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(Directions_test)
+{
+    PrimitiveData primitive = makePrimitive({{0, 0, 0}, {1, 1, 1}});
+    primitive.attributes[Attribute::Normal] =
+        AttributeData::fromVector(std::vector<glm::vec3>{{0, 0, 2}, {0.6f, -0.8f, 0}}, 3);
+    primitive.attributes[Attribute::Tangent] =
+        AttributeData::fromVector(std::vector<glm::vec4>{{1, 0, 0, -1}, {0, 1, 0, 1}}, 4);
+
+    std::vector<PrimitiveData> primitives{primitive};
+    loaders::quantizeMesh(primitives);
+
+    const auto& normal = primitives[0].attributes[Attribute::Normal];
+    BOOST_CHECK_EQUAL(normal.type, GLenum(GL_BYTE));
+    BOOST_CHECK(normal.normalized);
+
+    // Normals are unit length after quantization
+    const auto normals = primitives[0].normals();
+    BOOST_CHECK_SMALL(glm::length(normals[0] - glm::vec3(0, 0, 1)), 1.0f / 127);
+    BOOST_CHECK_SMALL(glm::length(normals[1] - glm::vec3(0.6f, -0.8f, 0)), 1.0f / 127);
+
+    // Handedness is kept
+    const auto& tangent = primitives[0].attributes[Attribute::Tangent];
+    BOOST_CHECK_EQUAL(tangent.getFloat(0, 3), -1.0f);
+    BOOST_CHECK_EQUAL(tangent.getFloat(1, 3), 1.0f);
+}
+
+BOOST_AUTO_TEST_CASE(TexCoords_test)
+{
+    PrimitiveData unit = makePrimitive({{0, 0, 0}, {1, 1, 1}});
+    unit.attributes[Attribute::TexCoord_0] =
+        AttributeData::fromVector(std::vector<glm::vec2>{{0, 1}, {0.25f, 0.5f}}, 2);
+
+    PrimitiveData tiled = unit;
+    tiled.attributes[Attribute::TexCoord_0] =
+        AttributeData::fromVector(std::vector<glm::vec2>{{0, 4}, {-1.5f, 0.5f}}, 2);
+
+    std::vector<PrimitiveData> primitives{unit, tiled};
+    loaders::quantizeMesh(primitives);
+
+    const auto& unitCoords = primitives[0].attributes[Attribute::TexCoord_0];
+    BOOST_CHECK_EQUAL(unitCoords.type, GLenum(GL_UNSIGNED_SHORT));
+    BOOST_CHECK_SMALL(glm::length(primitives[0].texCoords()[1] - glm::vec2(0.25f, 0.5f)),
+                      1.0f / 65535);
+
+    // Tiled coordinates become half floats, these values are exact
+    const auto& tiledCoords = primitives[1].attributes[Attribute::TexCoord_0];
+    BOOST_CHECK_EQUAL(tiledCoords.type, GLenum(GL_HALF_FLOAT));
+    BOOST_CHECK(primitives[1].texCoords()[1] == glm::vec2(-1.5f, 0.5f));
+}
+
+BOOST_AUTO_TEST_CASE(KeepsFloatPositions_test)
+{
+    // Skinned mesh
+    PrimitiveData skinned = makePrimitive({{0, 0, 0}, {1, 1, 1}});
+    // One element is four joint indices
+    skinned.attributes[Attribute::Joints_0] =
+        AttributeData::fromVector(std::vector<uint16_t>(8, 0), 4, GL_UNSIGNED_SHORT);
+    skinned.attributes[Attribute::Joints_0].count = 2;
+
+    std::vector<PrimitiveData> primitives{skinned};
+    loaders::quantizeMesh(primitives);
+    BOOST_CHECK_EQUAL(primitives[0].attributes[Attribute::Position].type, GLenum(GL_FLOAT));
+    BOOST_CHECK(primitives[0].dequantization == glm::mat4{1.0f});
+
+    // Zero extent
+    primitives = {makePrimitive({{2, 2, 2}, {2, 2, 2}})};
+    loaders::quantizeMesh(primitives);
+    BOOST_CHECK_EQUAL(primitives[0].attributes[Attribute::Position].type, GLenum(GL_FLOAT));
+    BOOST_CHECK(primitives[0].positions()[0] == glm::vec3(2, 2, 2));
+}
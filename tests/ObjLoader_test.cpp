@@ -0,0 +1,101 @@
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE ObjLoaderTest
+#include <boost/test/unit_test.hpp>
+
+#include "ConsoleLogger.h"
+
+#include <ObjLoader.h>
+
+BOOST_GLOBAL_FIXTURE(ConsoleLogger);
+
+using loaders::ObjLoader;
+
+// Keeps vertices in file order
+static ObjLoader::Options plainOptions()
+{
+    ObjLoader::Options options;
+    options.parallel = false;
+    options.optimize = false;
+    return options;
+}
+
+BOOST_AUTO_TEST_CASE(Triangle_test)
+{
+    ObjLoader ldr{plainOptions()};
+    ldr.load(std::string_view{"v 1 2 3\n"
+                              "v +1.5 -2.5e1 0.25\r\n"
+                              "v\t0 0\t1\n"
+                              "vt 0.5 0.75\n"
+                              "vn 0 0 1\n"
+                              "# comment\n"
+                              "f 1/1/1 2/1/1 3/1/1\n"});
+
+    const auto positions = ldr.positions();
+    BOOST_REQUIRE_EQUAL(positions.size(), 3u);
+    BOOST_CHECK(positions[0] == glm::vec3(1.0f, 2.0f, 3.0f));
+    BOOST_CHECK(positions[1] == glm::vec3(1.5f, -25.0f, 0.25f));
+    BOOST_CHECK(positions[2] == glm::vec3(0.0f, 0.0f, 1.0f));
+
+    BOOST_CHECK(ldr.texCoords().at(1) == glm::vec2(0.5f, 0.75f));
+    BOOST_CHECK(ldr.normals().at(2) == glm::vec3(0.0f, 0.0f, 1.0f));
+    BOOST_CHECK(ldr.indices() == (std::vector<uint32_t>{0, 1, 2}));
+}
+
+BOOST_AUTO_TEST_CASE(TexCoordWithoutV_test)
+{
+    ObjLoader ldr{plainOptions()};
+    ldr.load(std::string_view{"v 0 0 0\nv 1 0 0\nv 0 1 0\n"
+                              "vt 0.25\n"
+                              "f 1/1 2/1 3/1\n"});
+
+    BOOST_CHECK(ldr.texCoords().at(0) == glm::vec2(0.25f, 0.0f));
+}
+
+BOOST_AUTO_TEST_CASE(QuadIsFan_test)
+{
+    ObjLoader ldr{plainOptions()};
+    ldr.load(std::string_view{"v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\n"
+                              "f 1 2 3 4\n"});
+
+    BOOST_CHECK(ldr.indices() == (std::vector<uint32_t>{0, 1, 2, 0, 2, 3}));
+    BOOST_CHECK(ldr.texCoords().empty());
+    BOOST_CHECK(ldr.normals().empty());
+}
+
+BOOST_AUTO_TEST_CASE(RelativeIndices_test)
+{
+    ObjLoader ldr{plainOptions()};
+    ldr.load(std::string_view{"v 0 0 0\nv 1 0 0\nv 0 1 0\n"
+                              "vn 0 0 1\n"
+                              "f -3//-1 -2//-1 -1//-1\n"});
+
+    BOOST_CHECK(ldr.indices() == (std::vector<uint32_t>{0, 1, 2}));
+    BOOST_CHECK(ldr.positions().at(1) == glm::vec3(1.0f, 0.0f, 0.0f));
+    BOOST_CHECK(ldr.normals().at(0) == glm::vec3(0.0f, 0.0f, 1.0f));
+}
+
+BOOST_AUTO_TEST_CASE(WeldsEqualVertices_test)
+{
+    ObjLoader ldr{plainOptions()};
+    ldr.load(std::string_view{"v 0 0 0\nv 1 0 0\nv 0 1 0\nv 1 1 0\n"
+                              "vt 0 0\nvt 1 1\n"
+                              "f 1/1 2/1 3/1\n"
+                              "f 2/1 4/1 3/1\n"
+                              "f 1/2 2/1 3/1\n"});
+
+    // Only (v, vt) pairs not seen before add vertices
+    BOOST_CHECK_EQUAL(ldr.positions().size(), 5u);
+    BOOST_CHECK(ldr.indices() == (std::vector<uint32_t>{0, 1, 2, 1, 3, 2, 4, 1, 2}));
+}
+
+BOOST_AUTO_TEST_CASE(Malformed_test)
+{
+    ObjLoader ldr{plainOptions()};
+
+    BOOST_CHECK_THROW(ldr.load(std::string_view{"v 1 2\n"}), std::runtime_error);
+    BOOST_CHECK_THROW(ldr.load(std::string_view{"v 1 x 3\n"}), std::runtime_error);
+    BOOST_CHECK_THROW(ldr.load(std::string_view{"vt\n"}), std::runtime_error);
+    BOOST_CHECK_THROW(ldr.load(std::string_view{"v 0 0 0\nf 1 1\n"}), std::runtime_error);
+    BOOST_CHECK_THROW(ldr.load(std::string_view{"v 0 0 0\nf 1 0 1\n"}), std::runtime_error);
+    BOOST_CHECK_THROW(ldr.load(std::string_view{"v 0 0 0\nf 1 1 2\n"}), std::out_of_range);
+}
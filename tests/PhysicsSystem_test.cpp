@@ -0,0 +1,165 @@
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE PhysicsSystemTest
+#include <boost/test/unit_test.hpp>
+
+#include "ConsoleLogger.h"
+
+#include <PhysicsSystem.h>
+
+#include <cstring>
+#include <deque>
+
+BOOST_GLOBAL_FIXTURE(ConsoleLogger);
+
+/// Components outlive the system, it keeps pointers to them
+struct Scene
+{
+    explicit Scene(const PhysicsSystem::Options& options = {})
+        : physics{options}
+    {
+    }
+
+    void add(int id, const std::string& shape, float mass, const glm::vec3& translation,
+             int layer = 0)
+    {
+        auto& tr       = transformations.emplace_back();
+        tr.translation = translation;
+
+        auto& ph = components.emplace_back();
+        ph.shape = shape;
+        ph.mass  = mass;
+        ph.layer = layer;
+
+        physics.addActor(id, &tr, &ph);
+    }
+
+    void run(int ticks)
+    {
+        for (int i = 0; i < ticks; ++i)
+            physics.update(physics.fixedTimeStep());
+    }
+
+    glm::vec3 translation(int i) const { return transformations.at(i).translation; }
+
+    std::deque<TransformationComponent> transformations;
+    std::deque<PhysicsComponent> components;
+    PhysicsSystem physics;
+};
+
+static bool hasMessage(const std::runtime_error& e, const std::string& message)
+{
+    return e.what() == message;
+}
+
+#define CHECK_RESTORE_THROWS(scene, state, message)                                                \
+    BOOST_CHECK_EXCEPTION((scene).physics.restoreState(state), std::runtime_error,                 \
+                          [](const std::runtime_error& e) { return hasMessage(e, message); })
+
+/// Static ground far below two joined boxes
+static void addFallingBoxes(Scene& scene)
+{
+    scene.add(1, "box:10:1:10", 0.0f, {0.0f, -50.0f, 0.0f});
+    scene.add(2, "box:1:1:1", 1.0f, {0.0f, 5.0f, 0.0f});
+    scene.add(3, "box:0.5:0.5:0.5", 2.0f, {4.0f, 8.0f, 0.0f});
+    scene.physics.addBallJoint(2, 3, {2.0f, 6.5f, 0.0f});
+}
+
+BOOST_AUTO_TEST_CASE(RoundTrip_test)
+{
+    Scene scene;
+    addFallingBoxes(scene);
+    scene.run(10);
+
+    const auto state = scene.physics.saveState();
+    scene.run(20);
+    const glm::vec3 expected[] = {scene.translation(1), scene.translation(2)};
+
+    scene.physics.restoreState(state);
+    BOOST_CHECK(scene.physics.saveState() == state);
+
+    // Bodies fall freely, nothing lost in the state changes the outcome
+    scene.run(20);
+    BOOST_CHECK(scene.translation(1) == expected[0]);
+    BOOST_CHECK(scene.translation(2) == expected[1]);
+    BOOST_CHECK(scene.translation(0) == glm::vec3(0.0f, -50.0f, 0.0f));
+}
+
+BOOST_AUTO_TEST_CASE(Regions_test)
+{
+    PhysicsSystem::Options options;
+    options.activeRadius  = 10.0f;
+    options.reducedRadius = 50.0f;
+
+    Scene scene{options};
+    scene.add(1, "box:1:1:1", 1.0f, {0.0f, 0.0f, 0.0f});
+    scene.add(2, "box:1:1:1", 1.0f, {30.0f, 0.0f, 0.0f});
+    scene.add(3, "box:1:1:1", 1.0f, {100.0f, 0.0f, 0.0f});
+    scene.physics.setRegionCenters({glm::vec3{}});
+    scene.run(20);
+
+    const auto state = scene.physics.saveState();
+
+    // All bodies are frozen far from the center, restore brings back their regions
+    scene.physics.setRegionCenters({glm::vec3{1000.0f, 0.0f, 0.0f}});
+    scene.run(40);
+    BOOST_CHECK(scene.physics.saveState() != state);
+
+    scene.physics.setRegionCenters({glm::vec3{}});
+    scene.physics.restoreState(state);
+    BOOST_CHECK(scene.physics.saveState() == state);
+}
+
+BOOST_AUTO_TEST_CASE(InvalidState_test)
+{
+    Scene scene;
+    addFallingBoxes(scene);
+    scene.run(5);
+    const auto state = scene.physics.saveState();
+
+    auto trailing = state;
+    trailing.push_back(0);
+    CHECK_RESTORE_THROWS(scene, trailing, "Physics state has trailing data");
+
+    const std::vector<uint8_t> truncated(state.begin(), state.end() - 1);
+    CHECK_RESTORE_THROWS(scene, truncated, "Physics state is truncated");
+
+    auto badMagic = state;
+    badMagic[0]   = 'X';
+    CHECK_RESTORE_THROWS(scene, badMagic, "Not a physics state");
+
+    // Header is 6 words, region follows actor id of the first body
+    auto badRegion          = state;
+    const int32_t region    = 7;
+    const std::size_t field = 6 * sizeof(uint32_t) + sizeof(int32_t);
+    std::memcpy(badRegion.data() + field, &region, sizeof(region));
+    CHECK_RESTORE_THROWS(scene, badRegion, "Physics state regions do not match");
+
+    // Rejected states are not applied
+    BOOST_CHECK(scene.physics.saveState() == state);
+
+    scene.add(4, "box:1:1:1", 1.0f, {-4.0f, 5.0f, 0.0f});
+    CHECK_RESTORE_THROWS(scene, state, "Physics state actors do not match");
+}
+
+BOOST_AUTO_TEST_CASE(Layers_test)
+{
+    using Ph = PhysicsComponent;
+
+    // Boxes dropped on resting ones, debris falls through debris to the ground
+    Scene scene;
+    scene.add(1, "box:10:1:10", 0.0f, {0.0f, 0.0f, 0.0f});
+    scene.add(2, "box:1:1:1", 1.0f, {-4.0f, 2.0f, 0.0f});
+    scene.add(3, "box:1:1:1", 1.0f, {-4.0f, 5.0f, 0.0f});
+    scene.add(4, "box:1:1:1", 1.0f, {4.0f, 2.0f, 0.0f}, Ph::Debris);
+    scene.add(5, "box:1:1:1", 1.0f, {4.0f, 5.0f, 0.0f}, Ph::Debris);
+    scene.run(120);
+
+    BOOST_CHECK_CLOSE(scene.translation(1).y, 2.0f, 5.0f);
+    BOOST_CHECK_CLOSE(scene.translation(2).y, 4.0f, 5.0f);
+    BOOST_CHECK_CLOSE(scene.translation(3).y, 2.0f, 5.0f);
+    BOOST_CHECK_CLOSE(scene.translation(4).y, 2.0f, 5.0f);
+
+    BOOST_CHECK_THROW(scene.add(6, "box:1:1:1", 1.0f, {}, Ph::Debris | Ph::Character),
+                      std::runtime_error);
+    BOOST_CHECK_THROW(scene.add(7, "box:1:1:1", 1.0f, {}, Ph::AllLayers + 1), std::runtime_error);
+}
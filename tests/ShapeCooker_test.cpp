@@ -0,0 +1,132 @@
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE ShapeCookerTest
+#include <boost/test/unit_test.hpp>
+
+#include "ConsoleLogger.h"
+
+#include <ShapeCooker.h>
+
+#include <btBulletDynamicsCommon.h>
+
+#include <cstring>
+#include <fstream>
+
+BOOST_GLOBAL_FIXTURE(ConsoleLogger);
+
+namespace fs = std::filesystem;
+
+/// Data and cache folders in temp directory, a quad of two triangles in data folder
+struct CookerFixture
+{
+    CookerFixture()
+    {
+        fs::remove_all(root);
+        fs::create_directories(root / "data");
+        std::ofstream{root / "data" / "quad.obj"} << "v 0 0 0\nv 2 0 0\nv 2 0 3\nv 0 0 3\n"
+                                                     "f 1 2 3\nf 1 3 4\n";
+    }
+    ~CookerFixture() { fs::remove_all(root); }
+
+    /// The only cache entry
+    fs::path entry() const
+    {
+        std::vector<fs::path> entries;
+        for (const auto& item : fs::directory_iterator{root / "cache"})
+            entries.push_back(item.path());
+        BOOST_REQUIRE_EQUAL(entries.size(), 1u);
+        return entries.front();
+    }
+
+    std::vector<char> readEntry() const
+    {
+        std::ifstream in{entry(), std::ios::binary};
+        return {std::istreambuf_iterator<char>{in}, {}};
+    }
+
+    void writeEntry(const std::vector<char>& data) const
+    {
+        std::ofstream{entry(), std::ios::binary | std::ios::trunc}.write(data.data(), data.size());
+    }
+
+    ShapeCooker cooker() const { return ShapeCooker{root / "data", root / "cache", 32}; }
+
+    const fs::path root = fs::temp_directory_path() / "nbd-3dge-shapecooker-test";
+};
+
+/// Triangles found by BVH query over the whole shape
+static int triangleCount(const btBvhTriangleMeshShape& shape)
+{
+    struct Counter : btTriangleCallback
+    {
+        void processTriangle(btVector3*, int, int) override { ++count; }
+        int count = 0;
+    } counter;
+
+    const btVector3 extent{100.0f, 100.0f, 100.0f};
+    shape.processAllTriangles(&counter, -extent, extent);
+    return counter.count;
+}
+
+static void checkQuad(const btBvhTriangleMeshShape& shape)
+{
+    btVector3 min, max;
+    shape.getAabb(btTransform::getIdentity(), min, max);
+
+    const btScalar margin = shape.getMargin();
+    BOOST_CHECK_SMALL(min.x() + margin, 1e-4f);
+    BOOST_CHECK_CLOSE(max.x() - margin, 2.0f, 1e-3f);
+    BOOST_CHECK_CLOSE(max.z() - margin, 3.0f, 1e-3f);
+    BOOST_CHECK_EQUAL(triangleCount(shape), 2);
+}
+
+BOOST_FIXTURE_TEST_CASE(CookedAndCached_test, CookerFixture)
+{
+    const auto cooker = this->cooker();
+
+    const auto cooked = cooker.triangleMesh("quad.obj");
+    BOOST_REQUIRE(cooked);
+    checkQuad(*cooked);
+    const auto entryData = readEntry();
+
+    const auto cached = cooker.triangleMesh("quad.obj");
+    BOOST_REQUIRE(cached);
+    checkQuad(*cached);
+    BOOST_CHECK(readEntry() == entryData);
+}
+
+BOOST_FIXTURE_TEST_CASE(InvalidEntry_test, CookerFixture)
+{
+    const auto cooker = this->cooker();
+    cooker.triangleMesh("quad.obj");
+    const auto valid = readEntry();
+
+    uint32_t vertexCount;
+    std::memcpy(&vertexCount, valid.data(), sizeof(vertexCount));
+    const std::size_t firstIndex = 4 * sizeof(uint32_t) + vertexCount * sizeof(btScalar);
+
+    auto truncated = valid;
+    truncated.pop_back();
+    auto trailing = valid;
+    trailing.push_back(0);
+    auto badIndex = valid;
+    const int outOfRange = 4;
+    std::memcpy(badIndex.data() + firstIndex, &outOfRange, sizeof(outOfRange));
+    auto negativeIndex = valid;
+    const int negative = -1;
+    std::memcpy(negativeIndex.data() + firstIndex, &negative, sizeof(negative));
+    const std::vector<char> headerOnly(valid.begin(), valid.begin() + 8);
+
+    for (const auto& invalid : {truncated, trailing, badIndex, negativeIndex, headerOnly}) {
+        writeEntry(invalid);
+
+        const auto shape = cooker.triangleMesh("quad.obj");
+        BOOST_REQUIRE(shape);
+        checkQuad(*shape);
+        BOOST_CHECK(readEntry() == valid);
+    }
+}
+
+BOOST_FIXTURE_TEST_CASE(MissingFile_test, CookerFixture)
+{
+    BOOST_CHECK_THROW(cooker().triangleMesh("missing.obj"), std::runtime_error);
+}
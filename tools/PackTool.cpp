@@ -0,0 +1,84 @@
+// Packs data folder into one archive read by Vfs.
+//
+// Usage: PackTool <dataFolder> <output.pack> [--store]
+
+#include "MappedFile.h"
+#include "PackFile.h"
+
+#include <CLI/CLI.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// Formats that do not get smaller. KTX textures are stored too, mip streaming reads their levels
+// straight from the mapping instead of keeping the whole inflated file.
+const std::set<std::string> StoredExtensions = {".png", ".jpg", ".jpeg", ".ogg",  ".mp3",
+                                                ".zip", ".pack", ".ktx", ".ktx2"};
+
+bool worthCompressing(const fs::path& file)
+{
+    std::string ext = file.extension().string();
+    std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+    return StoredExtensions.count(ext) == 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    CLI::App app{"Packs data folder into an archive"};
+
+    std::string dataFolder;
+    std::string output;
+    bool store = false;
+
+    app.add_option("dataFolder", dataFolder, "Folder to pack")
+        ->check(CLI::ExistingDirectory)
+        ->required();
+    app.add_option("output", output, "Pack file")->required();
+    app.add_flag("--store", store, "Do not compress");
+    CLI11_PARSE(app, argc, argv);
+
+    const auto start = std::chrono::steady_clock::now();
+
+    // Sorted, so packs built from the same data are identical
+    std::vector<fs::path> files;
+    for (const auto& entry : fs::recursive_directory_iterator{dataFolder}) {
+        // Skip previously built packs
+        if (!entry.is_regular_file() || entry.path().extension() == ".pack") continue;
+        files.push_back(entry.path());
+    }
+    std::sort(files.begin(), files.end());
+
+    try {
+        PackWriter writer{output};
+        uint64_t bytes = 0;
+
+        for (const auto& file : files) {
+            const MappedFile mappedFile{file};
+            const std::string path = file.lexically_relative(dataFolder).generic_string();
+
+            writer.add(path, mappedFile.view(), !store && worthCompressing(file));
+            bytes += mappedFile.size();
+        }
+        writer.finish();
+
+        const std::chrono::duration<double> time = std::chrono::steady_clock::now() - start;
+        std::printf("%zu files, %.1f MB -> %.1f MB in %.1f s\n", files.size(), bytes / 1e6,
+                    writer.storedBytes() / 1e6, time.count());
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+
+    return 0;
+}
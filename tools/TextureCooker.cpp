@@ -0,0 +1,441 @@
+// Cooks PNG, JPG and TGA images in data folder to mipmapped, block compressed KTX files.
+//
+// Texture roles are taken from glTF materials: base color and emissive are sRGB color, normal
+// maps go to BC5, other maps are linear data. Images not used by any glTF are treated as color,
+// heightmaps are stored uncompressed without mips. Unchanged inputs are skipped using manifest
+// with hashes of inputs and settings.
+//
+// Usage: TextureCooker <dataFolder> [--bc7] [--force]
+
+#include "AssetCache.h"
+#include "MappedFile.h"
+#include "ThreadPool.h"
+
+#include <CLI/CLI.hpp>
+#include <nlohmann/json.hpp>
+#include <spdlog/sinks/stdout_color_sinks.h>
+#include <spdlog/spdlog.h>
+
+#define STB_IMAGE_IMPLEMENTATION
+#define STBI_ONLY_PNG
+#define STBI_ONLY_JPEG
+#define STBI_ONLY_TGA
+#include <stb_image.h>
+
+#define STB_DXT_IMPLEMENTATION
+#include <stb_dxt.h>
+
+#include <bc7enc.h>
+
+#if defined(__clang__)
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wunused-parameter"
+#pragma clang diagnostic ignored "-Wignored-qualifiers"
+#endif
+#include <gli/gli.hpp>
+#if defined(__clang__)
+#pragma clang diagnostic pop
+#endif
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+const char* const ManifestName = "texture-cooker.manifest";
+const int Version              = 1; //< Change when output for the same input changes
+
+enum class Role { Color, Normal, Data, Raw };
+
+const char* roleName(Role role)
+{
+    switch (role) {
+    case Role::Color: return "color";
+    case Role::Normal: return "normal";
+    case Role::Data: return "data";
+    case Role::Raw: return "raw";
+    }
+    return "";
+}
+
+struct Image
+{
+    int width  = 0;
+    int height = 0;
+    std::vector<uint8_t> rgba;
+
+    const uint8_t* pixel(int x, int y) const
+    {
+        x = std::min(x, width - 1);
+        y = std::min(y, height - 1);
+        return &rgba[(std::size_t(y) * width + x) * 4];
+    }
+};
+
+//------------------------------------------------------------------------------
+
+/// Roles of images referenced by glTF materials
+void collectRoles(const fs::path& gltfFile, std::map<fs::path, Role>& roles)
+{
+    const MappedFile file{gltfFile};
+    const auto json = nlohmann::json::parse(file.data(), file.data() + file.size());
+
+    const auto images   = json.value("images", nlohmann::json::array());
+    const auto textures = json.value("textures", nlohmann::json::array());
+
+    const auto add = [&](const nlohmann::json& textureInfo, Role role) {
+        if (!textureInfo.is_object()) return;
+        const auto& texture = textures.at(textureInfo.at("index").get<std::size_t>());
+        const auto& image   = images.at(texture.at("source").get<std::size_t>());
+        if (!image.count("uri")) return;
+
+        const auto path = (gltfFile.parent_path() / image.at("uri").get<std::string>())
+                              .lexically_normal();
+        // Color wins if image has many roles, it is the most visible one
+        auto it = roles.find(path);
+        if (it == roles.end() || role == Role::Color) roles[path] = role;
+    };
+
+    for (const auto& material : json.value("materials", nlohmann::json::array())) {
+        const auto pbr = material.value("pbrMetallicRoughness", nlohmann::json::object());
+        add(pbr.value("baseColorTexture", nlohmann::json{}), Role::Color);
+        add(pbr.value("metallicRoughnessTexture", nlohmann::json{}), Role::Data);
+        add(material.value("emissiveTexture", nlohmann::json{}), Role::Color);
+        add(material.value("normalTexture", nlohmann::json{}), Role::Normal);
+        add(material.value("occlusionTexture", nlohmann::json{}), Role::Data);
+    }
+}
+
+//------------------------------------------------------------------------------
+
+float srgbToLinear(uint8_t c)
+{
+    static const auto table = [] {
+        std::array<float, 256> t;
+        for (int i = 0; i < 256; ++i) {
+            const float v = i / 255.0f;
+            t[i] = v <= 0.04045f ? v / 12.92f : std::pow((v + 0.055f) / 1.055f, 2.4f);
+        }
+        return t;
+    }();
+    return table[c];
+}
+
+uint8_t linearToSrgb(float v)
+{
+    v = std::clamp(v, 0.0f, 1.0f);
+    v = v <= 0.0031308f ? v * 12.92f : 1.055f * std::pow(v, 1.0f / 2.4f) - 0.055f;
+    return static_cast<uint8_t>(v * 255.0f + 0.5f);
+}
+
+uint8_t toByte(float v) { return static_cast<uint8_t>(std::clamp(v, 0.0f, 1.0f) * 255.0f + 0.5f); }
+
+/**
+ * @brief Next mip level with 2x2 box filter (edges clamped for odd sizes).
+ *
+ * Color is averaged in linear space weighted by alpha, so transparent texels do not darken
+ * edges. Normals are renormalized.
+ */
+Image downsample(const Image& src, Role role)
+{
+    Image dst;
+    dst.width  = std::max(1, src.width / 2);
+    dst.height = std::max(1, src.height / 2);
+    dst.rgba.resize(std::size_t(dst.width) * dst.height * 4);
+
+    for (int y = 0; y < dst.height; ++y) {
+        for (int x = 0; x < dst.width; ++x) {
+            const uint8_t* p[4] = {src.pixel(2 * x, 2 * y), src.pixel(2 * x + 1, 2 * y),
+                                   src.pixel(2 * x, 2 * y + 1), src.pixel(2 * x + 1, 2 * y + 1)};
+            uint8_t* out = &dst.rgba[(std::size_t(y) * dst.width + x) * 4];
+
+            float sum[4] = {};
+            if (role == Role::Color) {
+                float alpha = 0.0f;
+                for (auto s : p) {
+                    const float a = s[3] / 255.0f;
+                    for (int c = 0; c < 3; ++c)
+                        sum[c] += srgbToLinear(s[c]) * a;
+                    alpha += a;
+                }
+                for (int c = 0; c < 3; ++c)
+                    out[c] = linearToSrgb(alpha > 0.0f ? sum[c] / alpha : 0.0f);
+                out[3] = toByte(alpha / 4.0f);
+            } else {
+                for (auto s : p) {
+                    for (int c = 0; c < 4; ++c)
+                        sum[c] += s[c] / 255.0f;
+                }
+                if (role == Role::Normal) {
+                    float n[3];
+                    for (int c = 0; c < 3; ++c)
+                        n[c] = sum[c] / 2.0f - 1.0f; // average of [-1, 1]
+                    const float len = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+                    for (int c = 0; c < 3; ++c)
+                        out[c] = toByte(len > 0.0f ? n[c] / len * 0.5f + 0.5f : 0.5f);
+                    out[3] = 255;
+                } else {
+                    for (int c = 0; c < 4; ++c)
+                        out[c] = toByte(sum[c] / 4.0f);
+                }
+            }
+        }
+    }
+    return dst;
+}
+
+//------------------------------------------------------------------------------
+
+gli::format chooseFormat(Role role, bool hasAlpha, bool bc7)
+{
+    switch (role) {
+    case Role::Raw: return gli::FORMAT_RGBA8_UNORM_PACK8;
+    case Role::Normal: return gli::FORMAT_RG_ATI2N_UNORM_BLOCK16;
+    case Role::Data:
+        return bc7 ? gli::FORMAT_RGBA_BP_UNORM_BLOCK16 : gli::FORMAT_RGB_DXT1_UNORM_BLOCK8;
+    case Role::Color:
+        if (bc7) return gli::FORMAT_RGBA_BP_UNORM_BLOCK16;
+        return hasAlpha ? gli::FORMAT_RGBA_DXT5_UNORM_BLOCK16 : gli::FORMAT_RGB_DXT1_UNORM_BLOCK8;
+    }
+    return gli::FORMAT_UNDEFINED;
+}
+
+/// Compresses image to dst, blocks rows are encoded in parallel
+void encode(const Image& image, gli::format format, Role role, uint8_t* dst)
+{
+    if (format == gli::FORMAT_RGBA8_UNORM_PACK8) {
+        std::memcpy(dst, image.rgba.data(), image.rgba.size());
+        return;
+    }
+
+    const int blocksX        = (image.width + 3) / 4;
+    const int blocksY        = (image.height + 3) / 4;
+    const std::size_t stride = gli::block_size(format);
+
+    bc7enc_compress_block_params bc7Params;
+    bc7enc_compress_block_params_init(&bc7Params);
+    if (role != Role::Color) bc7enc_compress_block_params_init_linear_weights(&bc7Params);
+
+    ThreadPool::global().parallelFor(blocksY, 1, [&](std::size_t begin, std::size_t end) {
+        uint8_t rgba[16 * 4];
+        uint8_t rg[16 * 2];
+
+        for (std::size_t by = begin; by < end; ++by) {
+            for (int bx = 0; bx < blocksX; ++bx) {
+                for (int i = 0; i < 16; ++i) {
+                    const uint8_t* p = image.pixel(bx * 4 + i % 4, int(by) * 4 + i / 4);
+                    std::memcpy(&rgba[i * 4], p, 4);
+                    rg[i * 2]     = p[0];
+                    rg[i * 2 + 1] = p[1];
+                }
+
+                uint8_t* block = dst + (by * blocksX + bx) * stride;
+                switch (format) {
+                case gli::FORMAT_RGB_DXT1_UNORM_BLOCK8:
+                    stb_compress_dxt_block(block, rgba, 0, STB_DXT_HIGHQUAL);
+                    break;
+                case gli::FORMAT_RGBA_DXT5_UNORM_BLOCK16:
+                    stb_compress_dxt_block(block, rgba, 1, STB_DXT_HIGHQUAL);
+                    break;
+                case gli::FORMAT_RG_ATI2N_UNORM_BLOCK16: stb_compress_bc5_block(block, rg); break;
+                default: bc7enc_compress_block(block, rgba, &bc7Params); break;
+                }
+            }
+        }
+    });
+}
+
+//------------------------------------------------------------------------------
+
+class Manifest final
+{
+  public:
+    explicit Manifest(fs::path file)
+        : m_file{std::move(file)}
+    {
+        std::ifstream in{m_file};
+        uint64_t hash;
+        std::string path;
+        while (in >> std::hex >> hash && std::getline(in >> std::ws, path))
+            m_entries[path] = hash;
+    }
+
+    bool upToDate(const std::string& path, uint64_t hash) const
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        auto it = m_entries.find(path);
+        return it != m_entries.end() && it->second == hash;
+    }
+
+    void set(const std::string& path, uint64_t hash)
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        m_entries[path] = hash;
+    }
+
+    void save() const
+    {
+        std::ofstream out{m_file};
+        for (const auto& e : m_entries)
+            out << std::hex << e.second << ' ' << e.first << '\n';
+    }
+
+  private:
+    fs::path m_file;
+    std::map<std::string, uint64_t> m_entries; //< Output path -> hash of input and settings
+    mutable std::mutex m_mutex;
+};
+
+//------------------------------------------------------------------------------
+
+struct Options
+{
+    bool bc7   = false;
+    bool force = false;
+};
+
+enum class Result { Cooked, Skipped, Failed };
+
+Result cook(const fs::path& input, Role role, const Options& options, Manifest& manifest,
+            const fs::path& dataFolder)
+{
+    const fs::path output    = fs::path{input}.replace_extension(".ktx");
+    const std::string outKey = output.lexically_relative(dataFolder).generic_string();
+
+    try {
+        const MappedFile file{input};
+
+        AssetCache::Hasher hasher{"TextureCooker"};
+        hasher.add(std::size_t(Version)).add(std::size_t(role)).add(std::size_t(options.bc7));
+        hasher.add(file.data(), file.size());
+
+        if (!options.force && fs::exists(output) && manifest.upToDate(outKey, hasher.value()))
+            return Result::Skipped;
+
+        Image image;
+        int channels    = 0;
+        stbi_uc* pixels = stbi_load_from_memory(reinterpret_cast<const stbi_uc*>(file.data()),
+                                                int(file.size()), &image.width, &image.height,
+                                                &channels, 4);
+        if (!pixels) throw std::runtime_error{stbi_failure_reason()};
+        image.rgba.assign(pixels, pixels + std::size_t(image.width) * image.height * 4);
+        stbi_image_free(pixels);
+
+        bool hasAlpha = false;
+        for (std::size_t i = 3; i < image.rgba.size() && !hasAlpha; i += 4)
+            hasAlpha = image.rgba[i] != 255;
+
+        const gli::format format = chooseFormat(role, hasAlpha, options.bc7);
+        const int levels =
+            role == Role::Raw ? 1 : 1 + int(std::log2(std::max(image.width, image.height)));
+
+        const int width  = image.width;
+        const int height = image.height;
+        gli::texture2d texture{format, gli::extent2d{width, height}, std::size_t(levels)};
+
+        for (int level = 0; level < levels; ++level) {
+            if (level > 0) image = downsample(image, role);
+            encode(image, format, role, texture.data<uint8_t>(0, 0, level));
+        }
+
+        // Readers never see half written file
+        const fs::path tmp = fs::path{output}.concat(".tmp");
+        if (!gli::save_ktx(texture, tmp.string())) throw std::runtime_error{"Unable to write"};
+        fs::rename(tmp, output);
+
+        manifest.set(outKey, hasher.value());
+        std::printf("%s: %dx%d %s, %d levels\n", outKey.c_str(), width, height, roleName(role),
+                    levels);
+        return Result::Cooked;
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "%s: %s\n", input.string().c_str(), e.what());
+        return Result::Failed;
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    CLI::App app{"Cooks images to mipmapped, block compressed KTX textures"};
+
+    std::string dataFolder;
+    Options options;
+
+    app.add_option("dataFolder", dataFolder, "Folder with images and glTF files")
+        ->check(CLI::ExistingDirectory)
+        ->required();
+    app.add_flag("--bc7", options.bc7, "BC7 instead of BC1/BC3 for color and data");
+    app.add_flag("--force", options.force, "Cook all images, ignore manifest");
+    CLI11_PARSE(app, argc, argv);
+
+    spdlog::stdout_color_mt("console");
+    bc7enc_compress_block_init();
+
+    const auto start = std::chrono::steady_clock::now();
+
+    std::vector<fs::path> images;
+    std::map<fs::path, Role> roles;
+
+    for (const auto& entry : fs::recursive_directory_iterator{dataFolder}) {
+        if (!entry.is_regular_file()) continue;
+
+        std::string ext = entry.path().extension().string();
+        std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+
+        if (ext == ".png" || ext == ".jpg" || ext == ".jpeg" || ext == ".tga") {
+            images.push_back(entry.path().lexically_normal());
+        } else if (ext == ".gltf") {
+            try {
+                collectRoles(entry.path(), roles);
+            } catch (const std::exception& e) {
+                std::fprintf(stderr, "%s: %s\n", entry.path().string().c_str(), e.what());
+            }
+        }
+    }
+    std::sort(images.begin(), images.end());
+
+    Manifest manifest{fs::path{dataFolder} / ManifestName};
+    std::atomic<int> results[3] = {};
+
+    // Images are cooked in parallel and blocks of each image too
+    ThreadPool::global().parallelFor(images.size(), 1, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) {
+            const auto& image = images[i];
+
+            Role role = Role::Color;
+            auto it   = roles.find(image);
+            if (it != roles.end())
+                role = it->second;
+            else if (image.filename().string().find("heightmap") != std::string::npos)
+                role = Role::Raw;
+
+            ++results[int(cook(image, role, options, manifest, dataFolder))];
+        }
+    });
+
+    manifest.save();
+
+    const std::chrono::duration<double> time = std::chrono::steady_clock::now() - start;
+    std::printf("%d cooked, %d up to date, %d failed in %.1f s on %u threads\n",
+                results[int(Result::Cooked)].load(), results[int(Result::Skipped)].load(),
+                results[int(Result::Failed)].load(), time.count(),
+                ThreadPool::global().threadCount() + 1);
+
+    spdlog::drop_all();
+
+    return results[int(Result::Failed)] == 0 ? 0 : 1;
+}